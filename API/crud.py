@@ -1,4 +1,5 @@
 import logging
+import unicodedata
 from typing import Optional
 from typing import List
 from passlib.context import CryptContext
@@ -6,12 +7,14 @@ from sqlalchemy.orm import Session
 from sqlalchemy.exc import IntegrityError, DatabaseError, SQLAlchemyError
 from sqlalchemy.sql import text
 from fastapi import HTTPException
-from models import TaiKhoan, GiaoDich, ThanhToan, TriggerLog, KhachHang, QuanLy, QuanTri, GiaMu
+from models import TaiKhoan, GiaoDich, ThanhToan, TriggerLog, KhachHang, QuanLy, QuanTri, GiaMu, YeuCauDaXuLy
 from schemas import (
        TaiKhoanCreate, GiaoDichCreate, KhachHangCreate, KhachHangUpdate, QuanLyCreate, QuanLyUpdate,
        QuanTriCreate, QuanTriUpdate, LoginRequest, Token, GiaMuCreate, GiaMuUpdate, PasswordUpdateRequest,
-       ThanhToanBase, TriggerLog, GiaoDichMuTapCreate, GiaoDichMuNuocCreate, GiaoDichTSCDRCCreate
+       ThanhToanBase, TriggerLog, GiaoDichMuTapCreate, GiaoDichMuNuocCreate, GiaoDichTSCDRCCreate,
+       GiaoDichBatchItem, GiaoDichDayDuCreate, KhoaPhan
    )
+from pydantic import ValidationError
 import jwt
 from datetime import datetime, timedelta, date
 from dotenv import load_dotenv
@@ -505,6 +508,24 @@ def get_khachhang_info(db: Session, ten_dang_nhap: str):
         logger.error(f"Unexpected error while fetching KhachHang info: {str(e)}")
         raise HTTPException(status_code=500, detail="Internal Server Error")
 
+def _ten_hien_thi(ho_va_ten: str) -> str:
+    """Tên không dấu, tối đa 31 ký tự, cho màn hình trạm cân (font ST7735 chỉ có ASCII)."""
+    ten = unicodedata.normalize("NFD", ho_va_ten.replace("Đ", "D").replace("đ", "d"))
+    return "".join(c for c in ten if ord(c) < 128)[:31]
+
+def get_khachhang_by_rfid(db: Session, rfid: str):
+    logger.info(f"Fetching KhachHang by RFID: {rfid}")
+    khachhang = db.query(KhachHang).filter(KhachHang.RFID == rfid).first()
+    if not khachhang:
+        logger.warning(f"RFID {rfid} not found")
+        raise HTTPException(status_code=404, detail="RFID not found")
+    ho_va_ten = khachhang.HoVaTen if khachhang.HoVaTen else ""
+    return {
+        "RFID": rfid,
+        "HoVaTen": ho_va_ten,
+        "TenHienThi": _ten_hien_thi(ho_va_ten)
+    }
+
 def update_khachhang_info(db: Session, khachhang_update: KhachHangUpdate):
     logger.info(f"Updating KhachHang info for TenDangNhap: {khachhang_update.ten_dang_nhap}")
     if khachhang_update.CongTy and not db.query(QuanLy).filter(QuanLy.CongTy == khachhang_update.CongTy).first():
@@ -1149,10 +1170,39 @@ def delete_khach_hang_by_id_khachhang(db: Session, khachhang_id: int):
         logger.error(f"Unexpected error: {str(e)}")
         raise HTTPException(status_code=500, detail="Internal Server Error")
 
+# Chống trùng theo khoá (MaCan, SoThuTu) của trạm cân: tra bằng khoá chính của YeuCauDaXuLy.
+# Bản ghi khoá được thêm vào cùng transaction với thay đổi GiaoDich, nên hoặc cả hai cùng được lưu
+# hoặc không cái nào; hai request trùng chạy song song thì request sau vấp khoá chính và bị rollback.
+def get_yeu_cau_da_xu_ly(db: Session, ma_can: Optional[str], so_thu_tu: Optional[int]):
+    if ma_can is None or so_thu_tu is None:
+        return None
+    return db.query(YeuCauDaXuLy).filter(
+        YeuCauDaXuLy.MaCan == ma_can,
+        YeuCauDaXuLy.SoThuTu == so_thu_tu
+    ).first()
+
+def _get_giaodich_da_xu_ly(db: Session, giaodich):
+    yeu_cau = get_yeu_cau_da_xu_ly(db, giaodich.MaCan, giaodich.SoThuTu)
+    if yeu_cau is None:
+        return None
+    logger.info(f"Duplicate request {giaodich.MaCan}#{giaodich.SoThuTu}, returning GiaoDich {yeu_cau.IDGiaoDich}")
+    return get_giaodich(db, yeu_cau.IDGiaoDich)
+
+def _add_yeu_cau_da_xu_ly(db: Session, giaodich, loai_can: int, db_giaodich: GiaoDich):
+    if giaodich.MaCan is None or giaodich.SoThuTu is None:
+        return
+    if db_giaodich.IDGiaoDich is None:
+        db.flush()
+    db.add(YeuCauDaXuLy(MaCan=giaodich.MaCan, SoThuTu=giaodich.SoThuTu, LoaiCan=loai_can,
+                        IDGiaoDich=db_giaodich.IDGiaoDich, ThoiGianXuLy=datetime.utcnow()))
+
 # Add these functions to crud.py
 # Replace the create_giaodich_mu_tap function
 def create_giaodich_mu_tap(db: Session, giaodich: GiaoDichMuTapCreate):
     logger.info(f"Creating GiaoDich MuTap with RFID: {giaodich.RFID}")
+    da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+    if da_xu_ly is not None:
+        return da_xu_ly
     khach_hang = db.query(KhachHang).filter(KhachHang.RFID == giaodich.RFID).first()
     if not khach_hang:
         logger.warning(f"RFID {giaodich.RFID} not found")
@@ -1175,12 +1225,16 @@ def create_giaodich_mu_tap(db: Session, giaodich: GiaoDichMuTapCreate):
     db_giaodich = GiaoDich(**giao_dich_dict)
     try:
         db.add(db_giaodich)
+        _add_yeu_cau_da_xu_ly(db, giaodich, 1, db_giaodich)
         db.commit()
         db.refresh(db_giaodich)
         logger.info(f"Created GiaoDich MuTap with ID: {db_giaodich.IDGiaoDich}")
         return db_giaodich
     except SQLAlchemyError as e:
         db.rollback()
+        da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+        if da_xu_ly is not None:
+            return da_xu_ly
         error_msg = str(e)
         if "GiaoDich already exists" in error_msg:
             logger.warning(f"GiaoDich already exists for RFID {giaodich.RFID}")
@@ -1193,6 +1247,9 @@ def create_giaodich_mu_tap(db: Session, giaodich: GiaoDichMuTapCreate):
 
 def update_giaodich_mu_nuoc(db: Session, giaodich: GiaoDichMuNuocCreate):
     logger.info(f"Updating GiaoDich MuNuoc with RFID: {giaodich.RFID}")
+    da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+    if da_xu_ly is not None:
+        return da_xu_ly
     khach_hang = db.query(KhachHang).filter(KhachHang.RFID == giaodich.RFID).first()
     if not khach_hang:
         logger.warning(f"RFID {giaodich.RFID} not found")
@@ -1211,17 +1268,24 @@ def update_giaodich_mu_nuoc(db: Session, giaodich: GiaoDichMuNuocCreate):
 
     db_giaodich.MuNuoc = giaodich.KhoiLuongMuNuoc
     try:
+        _add_yeu_cau_da_xu_ly(db, giaodich, 2, db_giaodich)
         db.commit()
         db.refresh(db_giaodich)
         logger.info(f"Updated GiaoDich MuNuoc with ID: {db_giaodich.IDGiaoDich}")
         return db_giaodich
     except SQLAlchemyError as e:
         db.rollback()
+        da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+        if da_xu_ly is not None:
+            return da_xu_ly
         logger.error(f"Unexpected error: {str(e)}")
         raise HTTPException(status_code=500, detail="Internal Server Error")
 
 def update_giaodich_tsc_drc(db: Session, giaodich: GiaoDichTSCDRCCreate):
     logger.info(f"Updating GiaoDich TSC/DRC with RFID: {giaodich.RFID}")
+    da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+    if da_xu_ly is not None:
+        return da_xu_ly
     khach_hang = db.query(KhachHang).filter(KhachHang.RFID == giaodich.RFID).first()
     if not khach_hang:
         logger.warning(f"RFID {giaodich.RFID} not found")
@@ -1240,11 +1304,134 @@ def update_giaodich_tsc_drc(db: Session, giaodich: GiaoDichTSCDRCCreate):
     db_giaodich.TSC = giaodich.TSC
     db_giaodich.DRC = giaodich.DRC
     try:
+        _add_yeu_cau_da_xu_ly(db, giaodich, 3, db_giaodich)
         db.commit()
         db.refresh(db_giaodich)
         logger.info(f"Updated GiaoDich TSC/DRC with ID: {db_giaodich.IDGiaoDich}")
         return db_giaodich
     except SQLAlchemyError as e:
         db.rollback()
+        da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+        if da_xu_ly is not None:
+            return da_xu_ly
         logger.error(f"Unexpected error: {str(e)}")
-        raise HTTPException(status_code=500, detail="Internal Server Error")
\ No newline at end of file
+        raise HTTPException(status_code=500, detail="Internal Server Error")
+
+# Giao dịch đủ ba phần do Gateway ghép: một transaction thay cho ba request mủ tạp/mủ nước/TSC.
+# Vẫn INSERT với mủ tạp rồi UPDATE phần còn lại như ba request riêng, để TongTien do cùng trigger
+# UPDATE tính như trước (trigger INSERT dùng công thức khác); hai câu lệnh chung một lần commit.
+def create_giaodich_day_du(db: Session, giaodich: GiaoDichDayDuCreate):
+    logger.info(f"Creating complete GiaoDich with RFID: {giaodich.RFID}")
+    # Kiểm tra khoá của từng phần: đã áp dụng đủ thì trả kết quả cũ, mới áp dụng một số phần
+    # (trước đó được gửi lẻ) thì chỉ áp dụng các phần còn thiếu, như khi Gateway gửi từng phần
+    cac_phan = list(giaodich.CacPhan) or [giaodich]
+    phan_thieu = [phan for phan in cac_phan if _get_giaodich_da_xu_ly(db, phan) is None]
+    if not phan_thieu:
+        return _get_giaodich_da_xu_ly(db, cac_phan[-1])
+    if len(phan_thieu) < len(cac_phan):
+        return _ap_dung_phan_thieu(db, giaodich, phan_thieu)
+    khach_hang = db.query(KhachHang).filter(KhachHang.RFID == giaodich.RFID).first()
+    if not khach_hang:
+        logger.warning(f"RFID {giaodich.RFID} not found")
+        raise HTTPException(status_code=400, detail="RFID not found")
+
+    current_time = datetime.utcnow()
+    cong_ty = khach_hang.CongTy
+    db_giaodich = GiaoDich(
+        IDKhachHang=khach_hang.IDKhachHang,
+        NgayGiaoDich=current_time.date(),
+        ThoiGianGiaoDich=current_time.time(),
+        CongTy=cong_ty,
+        MuTap=giaodich.KhoiLuongMuTap,
+        DRC=0.0,
+        MuNuoc=0.0,
+        TSC=0.0
+    )
+    try:
+        db.add(db_giaodich)
+        db.flush()
+        db_giaodich.MuNuoc = giaodich.KhoiLuongMuNuoc
+        db_giaodich.TSC = giaodich.TSC
+        db_giaodich.DRC = giaodich.DRC
+        db.flush()
+        if giaodich.CacPhan:
+            for phan in giaodich.CacPhan:
+                _add_yeu_cau_da_xu_ly(db, phan, phan.LoaiCan, db_giaodich)
+        else:
+            _add_yeu_cau_da_xu_ly(db, giaodich, 1, db_giaodich)
+        db.commit()
+        db.refresh(db_giaodich)
+        logger.info(f"Created complete GiaoDich with ID: {db_giaodich.IDGiaoDich}")
+        return db_giaodich
+    except SQLAlchemyError as e:
+        db.rollback()
+        da_xu_ly = _get_giaodich_da_xu_ly(db, giaodich)
+        if da_xu_ly is not None:
+            return da_xu_ly
+        error_msg = str(e)
+        if "GiaoDich already exists" in error_msg:
+            logger.warning(f"GiaoDich already exists for RFID {giaodich.RFID}")
+            raise HTTPException(status_code=400, detail="GiaoDich already exists for this time")
+        if "No previous GiaMu found" in error_msg:
+            logger.warning(f"No previous GiaMu found for CongTy {cong_ty}")
+            raise HTTPException(status_code=400, detail=f"No previous GiaMu found for CongTy {cong_ty} to create new price")
+        logger.error(f"Unexpected error: {error_msg}")
+        raise HTTPException(status_code=500, detail=f"Database error: {error_msg}")
+
+def _ap_dung_phan_thieu(db: Session, giaodich: GiaoDichDayDuCreate, phan_thieu: List[KhoaPhan]):
+    db_giaodich = None
+    for phan in phan_thieu:
+        khoa = {"MaCan": phan.MaCan, "SoThuTu": phan.SoThuTu}
+        if phan.LoaiCan == 1:
+            db_giaodich = create_giaodich_mu_tap(db, GiaoDichMuTapCreate(
+                RFID=giaodich.RFID, KhoiLuongMuTap=giaodich.KhoiLuongMuTap, **khoa))
+        elif phan.LoaiCan == 2:
+            db_giaodich = update_giaodich_mu_nuoc(db, GiaoDichMuNuocCreate(
+                RFID=giaodich.RFID, KhoiLuongMuNuoc=giaodich.KhoiLuongMuNuoc, **khoa))
+        else:
+            db_giaodich = update_giaodich_tsc_drc(db, GiaoDichTSCDRCCreate(
+                RFID=giaodich.RFID, TSC=giaodich.TSC, DRC=giaodich.DRC, **khoa))
+    return db_giaodich
+
+def process_giaodich_batch(db: Session, items: List[GiaoDichBatchItem]):
+    """Xử lý lần lượt từng phần tử theo đúng thứ tự gửi lên; lỗi của một phần tử không làm hỏng các phần tử khác."""
+    logger.info(f"Processing GiaoDich batch with {len(items)} items")
+    results = []
+    for index, item in enumerate(items):
+        try:
+            # Gateway gửi lại lần cân server đã áp dụng (mất phản hồi): trả kết quả cũ.
+            # Giao dịch ghép (LoaiCan 0) do create_giaodich_day_du kiểm tra khoá của từng phần.
+            yeu_cau = get_yeu_cau_da_xu_ly(db, item.MaCan, item.SoThuTu) if item.LoaiCan != 0 else None
+            if yeu_cau is not None:
+                results.append({"ViTri": index, "TrangThai": 200, "ChiTiet": "Already applied",
+                                "IDGiaoDich": yeu_cau.IDGiaoDich})
+                continue
+            khoa = {"MaCan": item.MaCan, "SoThuTu": item.SoThuTu}
+            if item.LoaiCan == 0:
+                db_giaodich = create_giaodich_day_du(db, GiaoDichDayDuCreate(
+                    RFID=item.RFID, KhoiLuongMuTap=item.KhoiLuongMuTap, KhoiLuongMuNuoc=item.KhoiLuongMuNuoc,
+                    TSC=item.TSC, DRC=item.DRC, CacPhan=item.CacPhan or [], **khoa))
+                status_code = 201
+            elif item.LoaiCan == 1:
+                db_giaodich = create_giaodich_mu_tap(db, GiaoDichMuTapCreate(
+                    RFID=item.RFID, KhoiLuongMuTap=item.KhoiLuongMuTap, **khoa))
+                status_code = 201
+            elif item.LoaiCan == 2:
+                db_giaodich = update_giaodich_mu_nuoc(db, GiaoDichMuNuocCreate(
+                    RFID=item.RFID, KhoiLuongMuNuoc=item.KhoiLuongMuNuoc, **khoa))
+                status_code = 200
+            else:
+                db_giaodich = update_giaodich_tsc_drc(db, GiaoDichTSCDRCCreate(
+                    RFID=item.RFID, TSC=item.TSC, DRC=item.DRC, **khoa))
+                status_code = 200
+            results.append({"ViTri": index, "TrangThai": status_code, "IDGiaoDich": db_giaodich.IDGiaoDich})
+        except ValidationError as e:
+            logger.warning(f"Batch item {index} invalid: {str(e)}")
+            results.append({"ViTri": index, "TrangThai": 422, "ChiTiet": str(e)})
+        except HTTPException as e:
+            results.append({"ViTri": index, "TrangThai": e.status_code, "ChiTiet": str(e.detail)})
+        except Exception as e:
+            db.rollback()
+            logger.error(f"Unexpected error in batch item {index}: {str(e)}")
+            results.append({"ViTri": index, "TrangThai": 500, "ChiTiet": "Internal Server Error"})
+    return results
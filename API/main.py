@@ -13,6 +13,7 @@ from schemas import (
     GiaMu as GiaMuSchema, PasswordResetRequest
 )
 from schemas import GiaoDichMuTapCreate, GiaoDichMuNuocCreate, GiaoDichTSCDRCCreate, GiaoDich
+from schemas import GiaoDichBatchRequest, GiaoDichBatchResponse, GiaoDichDayDuCreate
 import crud
 from datetime import date
 from pydantic import BaseModel
@@ -243,6 +244,11 @@ def get_khachhang_info(ten_dang_nhap: str, db: Session = Depends(get_db)):
     """Retrieve KhachHang information (HoVaTen, SoDienThoai, Gmail, CongTy, SoTaiKhoan, NganHang, RFID) by TenDangNhap."""
     return crud.get_khachhang_info(db, ten_dang_nhap)
 
+@app.get("/khachhang/by-rfid/{rfid}", summary="Get KhachHang display name by RFID")
+def get_khachhang_by_rfid(rfid: str, db: Session = Depends(get_db)):
+    """Retrieve HoVaTen and an ASCII display name (TenHienThi) for the scale screens by RFID (hex UID)."""
+    return crud.get_khachhang_by_rfid(db, rfid)
+
 @app.get("/khachhang/", response_model=List[KhachHangSchema], summary="Get list of KhachHang")
 def read_khachhangs(cong_ty: Optional[str] = None, skip: int = 0, limit: int = 100, db: Session = Depends(get_db)):
     """Retrieve a paginated list of KhachHang, optionally filtered by CongTy."""
@@ -514,4 +520,44 @@ def update_giaodich_tsc_drc(giaodich: GiaoDichTSCDRCCreate, db: Session = Depend
         raise e
     except Exception as e:
         logger.error(f"Unexpected error: {str(e)}")
-        raise HTTPException(status_code=500, detail="Internal Server Error")
\ No newline at end of file
+        raise HTTPException(status_code=500, detail="Internal Server Error")
+
+@app.post("/giaodich/day-du/", response_model=GiaoDich, summary="Create a complete GiaoDich (MuTap, MuNuoc and TSC/DRC) in one write")
+def create_giaodich_day_du(giaodich: GiaoDichDayDuCreate, db: Session = Depends(get_db)):
+    """Create a GiaoDich assembled by the Gateway from the three scale readings using RFID."""
+    logger.info(f"Received request to create complete GiaoDich for RFID: {giaodich.RFID}")
+    try:
+        db_giaodich = crud.create_giaodich_day_du(db, giaodich)
+        return {
+            "IDGiaoDich": db_giaodich.IDGiaoDich,
+            "IDKhachHang": db_giaodich.IDKhachHang,
+            "NgayGiaoDich": db_giaodich.NgayGiaoDich,
+            "ThoiGianGiaoDich": db_giaodich.ThoiGianGiaoDich.strftime("%H:%M:%S"),
+            "CongTy": db_giaodich.CongTy,
+            "KhoiLuongMuNuoc": float(db_giaodich.MuNuoc) if db_giaodich.MuNuoc is not None else 0.0,
+            "DoMuNuoc": float(db_giaodich.TSC) if db_giaodich.TSC is not None else 0.0,
+            "KhoiLuongMuTap": float(db_giaodich.MuTap) if db_giaodich.MuTap is not None else 0.0,
+            "DoMuTap": float(db_giaodich.DRC) if db_giaodich.DRC is not None else 0.0,
+            "MuNuoc": float(db_giaodich.MuNuoc) if db_giaodich.MuNuoc is not None else 0.0,
+            "TSC": float(db_giaodich.TSC) if db_giaodich.TSC is not None else 0.0,
+            "GiaMuNuoc": float(db_giaodich.GiaMuNuoc) if db_giaodich.GiaMuNuoc is not None else 0.0,
+            "MuTap": float(db_giaodich.MuTap) if db_giaodich.MuTap is not None else 0.0,
+            "DRC": float(db_giaodich.DRC) if db_giaodich.DRC is not None else 0.0,
+            "GiaMuTap": float(db_giaodich.GiaMuTap) if db_giaodich.GiaMuTap is not None else 0.0,
+            "TongTien": float(db_giaodich.TongTien) if db_giaodich.TongTien is not None else 0.0
+        }
+    except HTTPException as e:
+        raise e
+    except Exception as e:
+        logger.error(f"Unexpected error: {str(e)}")
+        raise HTTPException(status_code=500, detail="Internal Server Error")
+
+@app.post("/giaodich/batch/", response_model=GiaoDichBatchResponse, summary="Apply several MuTap/MuNuoc/TSC-DRC readings in one request")
+def process_giaodich_batch(batch: GiaoDichBatchRequest, db: Session = Depends(get_db)):
+    """Apply readings from the Gateway in order and return one result per item."""
+    logger.info(f"Received GiaoDich batch with {len(batch.DanhSach)} items")
+    try:
+        return {"KetQua": crud.process_giaodich_batch(db, batch.DanhSach)}
+    except Exception as e:
+        logger.error(f"Unexpected error: {str(e)}")
+        raise HTTPException(status_code=500, detail="Internal Server Error")
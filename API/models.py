@@ -1,5 +1,6 @@
 from sqlalchemy import Column, Integer, String, Date, Enum, Float, ForeignKey, DateTime, DECIMAL, Time, ForeignKeyConstraint
 from sqlalchemy.orm import relationship
+from sqlalchemy.dialects.mysql import INTEGER
 from database import Base
 import enum
 import datetime  # Import đầy đủ module datetime
@@ -130,6 +131,16 @@ class ThanhToan(Base):
         {'mysql_unique': ['IDKhachHang', 'Thang']},  # Ràng buộc UNIQUE trên (IDKhachHang, Thang)
     )
 
+# YeuCauDaXuLy model: khoá chống trùng (MaCan, SoThuTu) của các lần cân đã áp dụng
+class YeuCauDaXuLy(Base):
+    __tablename__ = "YeuCauDaXuLy"
+
+    MaCan = Column(String(17), primary_key=True)
+    SoThuTu = Column(INTEGER(unsigned=True), primary_key=True, autoincrement=False)
+    LoaiCan = Column(Integer, nullable=False)
+    IDGiaoDich = Column(Integer, ForeignKey("GiaoDich.IDGiaoDich", ondelete="CASCADE"), nullable=False)
+    ThoiGianXuLy = Column(DateTime, default=datetime.datetime.utcnow)
+
 # TriggerLog model
 class TriggerLog(Base):
     __tablename__ = "TriggerLog"
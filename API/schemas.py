@@ -188,8 +188,33 @@ class PasswordUpdateRequest(BaseModel):
 class PasswordResetRequest(BaseModel):
     new_password: str
 
+# Khoá chống trùng do trạm cân sinh ra: MAC trạm cân + số thứ tự lần cân.
+# Không bắt buộc; gửi lại cùng khoá thì server trả kết quả cũ thay vì áp dụng lần nữa.
+class KhoaChongTrung(BaseModel):
+    MaCan: Optional[str] = None
+    SoThuTu: Optional[int] = None
+
+    @validator('MaCan')
+    def check_ma_can(cls, v):
+        if v is not None:
+            parts = v.split(':')
+            if len(parts) != 6 or any(len(p) != 2 for p in parts):
+                raise ValueError('MaCan must be a MAC address like AA:BB:CC:DD:EE:FF')
+            try:
+                [int(p, 16) for p in parts]
+            except ValueError:
+                raise ValueError('MaCan must be a MAC address like AA:BB:CC:DD:EE:FF')
+            return v.upper()
+        return v
+
+    @validator('SoThuTu')
+    def check_so_thu_tu(cls, v):
+        if v is not None and not (0 <= v <= 0xFFFFFFFF):
+            raise ValueError('SoThuTu must be an unsigned 32-bit integer')
+        return v
+
 # Add these at the end of schemas.py
-class GiaoDichMuTapCreate(BaseModel):
+class GiaoDichMuTapCreate(KhoaChongTrung):
     RFID: str
     KhoiLuongMuTap: float
 
@@ -205,7 +230,7 @@ class GiaoDichMuTapCreate(BaseModel):
             raise ValueError('RFID cannot be empty')
         return v
 
-class GiaoDichMuNuocCreate(BaseModel):
+class GiaoDichMuNuocCreate(KhoaChongTrung):
     RFID: str
     KhoiLuongMuNuoc: float
 
@@ -221,7 +246,7 @@ class GiaoDichMuNuocCreate(BaseModel):
             raise ValueError('RFID cannot be empty')
         return v
 
-class GiaoDichTSCDRCCreate(BaseModel):
+class GiaoDichTSCDRCCreate(KhoaChongTrung):
     RFID: str
     TSC: float
     DRC: float
@@ -236,4 +261,66 @@ class GiaoDichTSCDRCCreate(BaseModel):
     def check_rfid(cls, v):
         if not v:
             raise ValueError('RFID cannot be empty')
-        return v
\ No newline at end of file
+        return v
+
+# Khoá chống trùng của một lần cân nằm trong giao dịch do Gateway ghép
+class KhoaPhan(KhoaChongTrung):
+    LoaiCan: int
+
+# Giao dịch đủ ba phần do Gateway ghép (mủ tạp + mủ nước + TSC/DRC), ghi một lần.
+# MaCan/SoThuTu là khoá của lần cân mủ tạp; CacPhan là khoá của từng lần cân đã ghép.
+class GiaoDichDayDuCreate(KhoaChongTrung):
+    RFID: str
+    KhoiLuongMuTap: float
+    KhoiLuongMuNuoc: float
+    TSC: float
+    DRC: float
+    CacPhan: List[KhoaPhan] = []
+
+    @validator('KhoiLuongMuTap', 'KhoiLuongMuNuoc', 'TSC', 'DRC')
+    def check_gia_tri(cls, v):
+        if v <= 0:
+            raise ValueError('KhoiLuongMuTap, KhoiLuongMuNuoc, TSC and DRC must be greater than 0')
+        return v
+
+    @validator('RFID')
+    def check_rfid(cls, v):
+        if not v:
+            raise ValueError('RFID cannot be empty')
+        return v
+
+# Gửi nhiều giao dịch trong một request (dùng cho Gateway)
+class GiaoDichBatchItem(KhoaChongTrung):
+    LoaiCan: int  # 0: đủ ba phần (Gateway ghép), 1: mủ tạp, 2: mủ nước, 3: TSC/DRC
+    RFID: str
+    KhoiLuongMuTap: Optional[float] = None
+    KhoiLuongMuNuoc: Optional[float] = None
+    TSC: Optional[float] = None
+    DRC: Optional[float] = None
+    CacPhan: Optional[List[KhoaPhan]] = None  # chỉ với LoaiCan 0
+
+    @validator('LoaiCan')
+    def check_loai_can(cls, v):
+        if v not in (0, 1, 2, 3):
+            raise ValueError('LoaiCan must be 0, 1, 2 or 3')
+        return v
+
+class GiaoDichBatchRequest(BaseModel):
+    DanhSach: List[GiaoDichBatchItem]
+
+    @validator('DanhSach')
+    def check_danh_sach(cls, v):
+        if not v:
+            raise ValueError('DanhSach cannot be empty')
+        if len(v) > 100:
+            raise ValueError('DanhSach cannot contain more than 100 items')
+        return v
+
+class GiaoDichBatchResult(BaseModel):
+    ViTri: int
+    TrangThai: int
+    ChiTiet: Optional[str] = None
+    IDGiaoDich: Optional[int] = None
+
+class GiaoDichBatchResponse(BaseModel):
+    KetQua: List[GiaoDichBatchResult]
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522.h>
+#include "CardSession.h"
+#include "CustomerCache.h"
+#include "Log2Histogram.h"
+
+// Một lần chạm thẻ đã đọc xong, CardReaderTask gửi cho loop()
+typedef struct {
+  uint8_t doDaiUid;
+  uint8_t uid[10];
+  char ten[CustomerCache::kDoDaiTen];  // rỗng nếu cache và blockTen đều không có
+  bool hoiGateway;                     // tên chưa có hoặc cần làm mới: loop() hỏi gateway
+  char khoiKhac[17];                   // nội dung blockKhac, rỗng nếu không đọc
+  uint32_t chamLuc;                    // millis() lúc phát hiện thẻ
+} the_moi;
+
+// Task riêng dò thẻ RFID cho trạm cân, thay cho PICC_IsNewCardPresent() trong loop(): thẻ được
+// phát hiện, đọc (tên qua CustomerCache, blockKhac nếu có) và bíp ngay cả khi loop() còn đang
+// cân hoặc hiển thị lần trước; lần chạm thẻ chờ trong hàng đợi cho tới khi loop() lấy bằng next().
+//
+// Sau khi đọc, task giữ phiên thẻ mở để loop() ghi thêm (write()) cho tới release(); chỉ sau đó thẻ
+// mới được cho ngủ và task quay lại dò thẻ mới. MFRC522 dùng chung bus SPI với TFT: mọi thao tác
+// với đầu đọc giữ spi (mutex của sketch).
+class CardReaderTask {
+public:
+  typedef void (*Callback)();
+
+  CardReaderTask(MFRC522& rfid, CardSession& phien, CustomerCache& khachHang, uint8_t blockTen)
+    : rfid_(rfid), phien_(phien), khachHang_(khachHang), blockTen_(blockTen) {}
+
+  // bip: gọi khi đọc xong thẻ (trong task này, phải ngắn); blockKhac < 0: chỉ đọc tên
+  bool begin(SemaphoreHandle_t spi, Callback bip, int blockKhac = -1, UBaseType_t uuTien = 2, BaseType_t core = 1) {
+    spi_ = spi;
+    bip_ = bip;
+    blockKhac_ = blockKhac;
+    hangDoiThe_ = xQueueCreate(1, sizeof(the_moi));
+    hangDoiLenh_ = xQueueCreate(2, sizeof(lenh_the));
+    ketQua_ = xQueueCreate(1, sizeof(bool));
+    if (!hangDoiThe_ || !hangDoiLenh_ || !ketQua_) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "the", 4096, this, uuTien, NULL, core) == pdPASS;
+  }
+
+  // Lần chạm thẻ kế tiếp, chờ tối đa cho tick
+  bool next(the_moi& ra, TickType_t cho) { return xQueueReceive(hangDoiThe_, &ra, cho) == pdTRUE; }
+
+  // Ghi một block vào thẻ đang giữ và chờ kết quả (thẻ phải còn trên đầu đọc)
+  bool write(uint8_t block, const uint8_t duLieu[16], TickType_t cho = pdMS_TO_TICKS(1000)) {
+    lenh_the l;
+    l.ketThuc = false;
+    l.block = block;
+    memcpy(l.duLieu, duLieu, 16);
+    xQueueReset(ketQua_);
+    if (xQueueSend(hangDoiLenh_, &l, cho) != pdTRUE) return false;
+    bool ok = false;
+    return xQueueReceive(ketQua_, &ok, cho) == pdTRUE && ok;
+  }
+
+  // Xong việc với thẻ lấy từ next(): cho thẻ ngủ, dò thẻ tiếp theo
+  void release() {
+    lenh_the l;
+    l.ketThuc = true;
+    xQueueSend(hangDoiLenh_, &l, portMAX_DELAY);
+  }
+
+  // Chạm thẻ -> đọc xong và bíp (ms)
+  const Log2Histogram& tapToBeepMs() const { return tgChamThe_; }
+
+private:
+  static const uint32_t kChuKyDo = 50;  // ms giữa hai lần dò thẻ
+
+  typedef struct {
+    bool ketThuc;
+    uint8_t block;
+    uint8_t duLieu[16];
+  } lenh_the;
+
+  static void taskEntry(void* thamSo) { static_cast<CardReaderTask*>(thamSo)->chay(); }
+
+  void chay() {
+    the_moi t;
+    for (;;) {
+      xSemaphoreTake(spi_, portMAX_DELAY);
+      bool coThe = rfid_.PICC_IsNewCardPresent() && rfid_.PICC_ReadCardSerial();
+      if (!coThe) {
+        xSemaphoreGive(spi_);
+        vTaskDelay(pdMS_TO_TICKS(kChuKyDo));
+        continue;
+      }
+
+      t.chamLuc = millis();
+      t.doDaiUid = rfid_.uid.size;
+      memcpy(t.uid, rfid_.uid.uidByte, t.doDaiUid);
+      t.khoiKhac[0] = '\0';
+      // Chỉ đọc blockTen khi cache chưa biết thẻ này
+      bool daBiet = khachHang_.lookup(t.uid, t.doDaiUid, t.ten, t.hoiGateway);
+      phien_.begin();
+      if (!daBiet) phien_.readText(blockTen_, t.ten);
+      if (blockKhac_ >= 0) phien_.readText(blockKhac_, t.khoiKhac);
+      xSemaphoreGive(spi_);
+
+      if (bip_) bip_();
+      tgChamThe_.record(millis() - t.chamLuc);
+      Serial.printf("Chạm thẻ -> bíp: %lu ms (trung vị %lu ms), xác thực %lu lần\n", millis() - t.chamLuc,
+                    (unsigned long)tgChamThe_.percentile(50), (unsigned long)phien_.authCount());
+      // Thẻ mới có tên trên thẻ: ghi một ô cache (thẻ đã biết thì lookup() không ghi flash)
+      if (!daBiet && t.ten[0]) khachHang_.put(t.uid, t.doDaiUid, t.ten, false);
+      Serial.printf("Cache tên: trúng %lu, trượt %lu, hỏi gateway %lu, ghi flash %lu\n",
+                    (unsigned long)khachHang_.hitCount(), (unsigned long)khachHang_.missCount(),
+                    (unsigned long)khachHang_.requestCount(), (unsigned long)khachHang_.flashWrites());
+
+      xQueueReset(hangDoiLenh_);
+      xQueueSend(hangDoiThe_, &t, portMAX_DELAY);
+      giuThe();
+    }
+  }
+
+  // Thực hiện lệnh ghi của loop() cho tới release()
+  void giuThe() {
+    lenh_the l;
+    for (;;) {
+      xQueueReceive(hangDoiLenh_, &l, portMAX_DELAY);
+      xSemaphoreTake(spi_, portMAX_DELAY);
+      if (l.ketThuc) {
+        phien_.end();
+        Serial.printf("Phiên thẻ: xác thực %lu lần, đọc %lu block, ghi %lu block\n",
+                      (unsigned long)phien_.authCount(), (unsigned long)phien_.readCount(),
+                      (unsigned long)phien_.writeCount());
+        xSemaphoreGive(spi_);
+        return;
+      }
+      bool ok = phien_.write(l.block, l.duLieu) && phien_.commit();
+      xSemaphoreGive(spi_);
+      xQueueSend(ketQua_, &ok, 0);
+    }
+  }
+
+  MFRC522& rfid_;
+  CardSession& phien_;
+  CustomerCache& khachHang_;
+  uint8_t blockTen_;
+  int blockKhac_ = -1;
+  SemaphoreHandle_t spi_ = NULL;
+  Callback bip_ = nullptr;
+  QueueHandle_t hangDoiThe_ = NULL;
+  QueueHandle_t hangDoiLenh_ = NULL;
+  QueueHandle_t ketQua_ = NULL;
+  Log2Histogram tgChamThe_;
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MFRC522.h>
+
+// Một lần chạm thẻ MIFARE Classic, thay cho readBlock()/writeBlock() xác thực lại ở mỗi lần gọi.
+//
+// Thẻ chỉ giữ trạng thái xác thực cho một sector: phiên nhớ sector đang mở và chỉ gọi
+// PCD_Authenticate khi chuyển sang sector khác. Block đã đọc được giữ trong cache nên đọc lại
+// không tốn giao dịch SPI/RF; write() chỉ ghi vào cache, commit() ghi các block đã đổi xuống thẻ
+// theo thứ tự sector (mỗi sector xác thực một lần) và bỏ qua block ghi trùng nội dung đang có.
+class CardSession {
+public:
+  static const uint8_t kSoBlockCache = 8;
+
+  CardSession(MFRC522& rfid, MFRC522::MIFARE_Key& key) : rfid_(rfid), key_(key) {}
+
+  // Bắt đầu phiên cho thẻ vừa PICC_ReadCardSerial()
+  void begin() {
+    soCache_ = 0;
+    sectorDangMo_ = -1;
+    soLanXacThuc_ = 0;
+    soLanDoc_ = 0;
+    soLanGhi_ = 0;
+  }
+
+  // Đọc 16 byte của block (từ cache nếu đã đọc trong phiên)
+  bool read(uint8_t block, uint8_t ra[16]) {
+    int i = timCache(block);
+    if (i < 0) {
+      if (!moSector(block / 4)) return false;
+      byte buf[18];
+      byte doDai = sizeof(buf);
+      MFRC522::StatusCode trangThai = rfid_.MIFARE_Read(block, buf, &doDai);
+      if (trangThai != MFRC522::STATUS_OK) {
+        Serial.printf("Đọc block %u thất bại: %s\n", block, MFRC522::GetStatusCodeName(trangThai));
+        sectorDangMo_ = -1;
+        return false;
+      }
+      soLanDoc_++;
+      i = themCache(block, buf, false);
+      if (i < 0) {
+        memcpy(ra, buf, 16);
+        return true;
+      }
+    }
+    memcpy(ra, cache_[i].duLieu, 16);
+    return true;
+  }
+
+  // Đọc block dạng chuỗi (dừng ở '\0', tối đa 16 ký tự); lỗi thì trả chuỗi rỗng
+  bool readText(uint8_t block, char ra[17]) {
+    uint8_t buf[16];
+    ra[0] = '\0';
+    if (!read(block, buf)) return false;
+    memcpy(ra, buf, 16);
+    ra[16] = '\0';
+    return true;
+  }
+
+  // Đặt nội dung block, ghi xuống thẻ khi commit(). Không cho ghi block 0 và block trailer.
+  bool write(uint8_t block, const uint8_t duLieu[16]) {
+    if (block == 0 || (block + 1) % 4 == 0) {
+      Serial.println("Lỗi: Không ghi vào block 0 hoặc block trailer.");
+      return false;
+    }
+    int i = timCache(block);
+    if (i >= 0) {
+      if (memcmp(cache_[i].duLieu, duLieu, 16) == 0) return true;  // thẻ đã có nội dung này
+      memcpy(cache_[i].duLieu, duLieu, 16);
+      cache_[i].choGhi = true;
+      return true;
+    }
+    return themCache(block, duLieu, true) >= 0;
+  }
+
+  // Ghi mọi block đang chờ, sector đang mở trước rồi tới các sector còn lại
+  bool commit() {
+    bool ok = true;
+    for (;;) {
+      int chon = -1;
+      for (uint8_t i = 0; i < soCache_; i++) {
+        if (!cache_[i].choGhi) continue;
+        if (cache_[i].block / 4 == sectorDangMo_) {
+          chon = i;
+          break;
+        }
+        if (chon < 0 || cache_[i].block < cache_[chon].block) chon = i;
+      }
+      if (chon < 0) break;
+
+      khoi_the& k = cache_[chon];
+      k.choGhi = false;
+      if (!moSector(k.block / 4)) {
+        ok = false;
+        continue;
+      }
+      MFRC522::StatusCode trangThai = rfid_.MIFARE_Write(k.block, k.duLieu, 16);
+      if (trangThai != MFRC522::STATUS_OK) {
+        Serial.printf("Ghi block %u thất bại: %s\n", k.block, MFRC522::GetStatusCodeName(trangThai));
+        sectorDangMo_ = -1;
+        k.block = 0xFF;  // nội dung trên thẻ không còn chắc chắn: bỏ khỏi cache
+        ok = false;
+        continue;
+      }
+      soLanGhi_++;
+    }
+    return ok;
+  }
+
+  // Kết thúc phiên: cho thẻ ngủ và tắt mã hoá
+  void end() {
+    rfid_.PICC_HaltA();
+    rfid_.PCD_StopCrypto1();
+    sectorDangMo_ = -1;
+  }
+
+  // Số giao dịch với thẻ trong phiên hiện tại
+  uint32_t authCount() const { return soLanXacThuc_; }
+  uint32_t readCount() const { return soLanDoc_; }
+  uint32_t writeCount() const { return soLanGhi_; }
+
+private:
+  struct khoi_the {
+    uint8_t block;
+    bool choGhi;
+    uint8_t duLieu[16];
+  };
+
+  bool moSector(int sector) {
+    if (sector == sectorDangMo_) return true;
+    MFRC522::StatusCode trangThai =
+      rfid_.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, sector * 4 + 3, &key_, &rfid_.uid);
+    soLanXacThuc_++;
+    if (trangThai != MFRC522::STATUS_OK) {
+      Serial.printf("Xác thực sector %d thất bại: %s\n", sector, MFRC522::GetStatusCodeName(trangThai));
+      sectorDangMo_ = -1;
+      return false;
+    }
+    sectorDangMo_ = sector;
+    return true;
+  }
+
+  int timCache(uint8_t block) const {
+    for (uint8_t i = 0; i < soCache_; i++)
+      if (cache_[i].block == block) return i;
+    return -1;
+  }
+
+  // Thêm vào cache; đầy thì thay block không chờ ghi, không còn chỗ thì trả -1
+  int themCache(uint8_t block, const uint8_t duLieu[16], bool choGhi) {
+    int i = -1;
+    if (soCache_ < kSoBlockCache) i = soCache_++;
+    else
+      for (uint8_t j = 0; j < soCache_ && i < 0; j++)
+        if (!cache_[j].choGhi) i = j;
+    if (i < 0) return -1;
+    cache_[i].block = block;
+    cache_[i].choGhi = choGhi;
+    memcpy(cache_[i].duLieu, duLieu, 16);
+    return i;
+  }
+
+  MFRC522& rfid_;
+  MFRC522::MIFARE_Key& key_;
+  khoi_the cache_[kSoBlockCache];
+  uint8_t soCache_ = 0;
+  int sectorDangMo_ = -1;
+
+  uint32_t soLanXacThuc_ = 0;
+  uint32_t soLanDoc_ = 0;
+  uint32_t soLanGhi_ = 0;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "EspNowFrame.h"
+
+// Tên khách hàng theo UID thẻ, lưu trên flash (NVS "khachhang", mỗi ô một khoá "m0".."m47") của trạm
+// cân để hiện tên ngay khi chạm thẻ mà không phải xác thực và đọc blockName; thẻ chưa ghi tên vẫn hiện
+// được tên.
+//
+// Cache nhỏ, thay mục ít dùng gần đây nhất (LRU). Thứ tự dùng chỉ giữ trong RAM và được lưu cùng lần
+// ghi ô đó kế tiếp. Chạm thẻ đã có trong cache không ghi flash; thẻ mới (tên đọc từ thẻ) hay tên gateway
+// trả về khác tên đang lưu thì ghi đúng một ô (~50 byte), không ghi lại cả bảng. Gateway trả về đúng tên
+// đang có thì chỉ cập nhật lần khởi động trong RAM: bản trên flash cũ hơn chỉ làm lần khởi động sau hỏi lại.
+// Tên lấy lười từ gateway: thẻ chưa có trong cache, hoặc tên chưa làm mới trong lần khởi động này,
+// thì gửi khung requestFrame() (KHUNG_HOI_TEN); khung KHUNG_TEN trả về được onFrame() (task WiFi)
+// đưa vào hàng đợi và poll() (loop) ghi vào cache. lookup() chạy trong task đọc thẻ nên các hàm
+// đụng tới muc_ giữ khoa_.
+class CustomerCache {
+public:
+  static const uint8_t kSoMuc = 48;
+  static const size_t kDoDaiTen = sizeof(khung_ten::ten);
+
+  // lanKhoiDong: số lần khởi động của trạm, tên lấy trong lần khởi động trước sẽ được làm mới
+  bool begin(uint16_t lanKhoiDong) {
+    lanKhoiDong_ = lanKhoiDong;
+    hangDoi_ = xQueueCreate(4, sizeof(khung_ten));
+    khoa_ = xSemaphoreCreateMutex();
+    Preferences prefs;
+    prefs.begin("khachhang", false);
+    if (prefs.isKey("ds") && prefs.getBytes("ds", muc_, sizeof(muc_)) == sizeof(muc_)) {
+      // Bản cũ lưu cả bảng trong khoá "ds": chuyển sang mỗi ô một khoá
+      for (uint8_t i = 0; i < kSoMuc; i++) ghiO(prefs, i);
+      prefs.remove("ds");
+    } else {
+      for (uint8_t i = 0; i < kSoMuc; i++) {
+        char khoa[5];
+        if (prefs.getBytes(tenKhoa(i, khoa), &muc_[i], sizeof(muc_[i])) != sizeof(muc_[i]))
+          memset(&muc_[i], 0, sizeof(muc_[i]));  // ô trống hoặc khác phiên bản
+      }
+    }
+    prefs.end();
+    for (uint8_t i = 0; i < kSoMuc; i++) {
+      muc_[i].ten[kDoDaiTen - 1] = '\0';
+      if (muc_[i].lanDung > demDung_) demDung_ = muc_[i].lanDung;
+    }
+    return hangDoi_ != NULL && khoa_ != NULL;
+  }
+
+  // Tên đã biết của thẻ; canLamMoi = true nếu nên hỏi lại gateway
+  bool lookup(const uint8_t* uid, uint8_t doDaiUid, char ten[kDoDaiTen], bool& canLamMoi) {
+    xSemaphoreTake(khoa_, portMAX_DELAY);
+    int i = tim(uid, doDaiUid);
+    if (i < 0) {
+      soLanTruot_++;
+      xSemaphoreGive(khoa_);
+      ten[0] = '\0';
+      canLamMoi = true;
+      return false;
+    }
+    soLanTrung_++;
+    muc_[i].lanDung = ++demDung_;
+    strcpy(ten, muc_[i].ten);
+    canLamMoi = muc_[i].lanKhoiDong != lanKhoiDong_;
+    xSemaphoreGive(khoa_);
+    return true;
+  }
+
+  // Ghi tên cho thẻ. tuGateway = false với tên đọc từ thẻ (vẫn hỏi gateway ở lần sau)
+  void put(const uint8_t* uid, uint8_t doDaiUid, const char* ten, bool tuGateway) {
+    uint16_t lanKhoiDong = tuGateway ? lanKhoiDong_ : 0;
+    xSemaphoreTake(khoa_, portMAX_DELAY);
+    int i = tim(uid, doDaiUid);
+    // Cùng tên, cùng nguồn (thẻ/gateway): không ghi flash, chỉ đánh dấu đã làm mới trong lần khởi động này
+    if (i >= 0 && strncmp(muc_[i].ten, ten, kDoDaiTen - 1) == 0 && (muc_[i].lanKhoiDong != 0) == tuGateway) {
+      muc_[i].lanKhoiDong = lanKhoiDong;
+      xSemaphoreGive(khoa_);
+      return;
+    }
+    if (i < 0) i = chonMucThay();
+    muc_[i].doDaiUid = doDaiUid;
+    memcpy(muc_[i].uid, uid, doDaiUid);
+    snprintf(muc_[i].ten, kDoDaiTen, "%s", ten);
+    muc_[i].lanKhoiDong = lanKhoiDong;
+    muc_[i].lanDung = ++demDung_;
+    luu(i);
+    xSemaphoreGive(khoa_);
+  }
+
+  // Gateway báo server không có khách hàng mang thẻ này: bỏ tên đã lấy từ gateway,
+  // tên đọc từ thẻ thì giữ lại
+  void remove(const uint8_t* uid, uint8_t doDaiUid) {
+    xSemaphoreTake(khoa_, portMAX_DELAY);
+    int i = tim(uid, doDaiUid);
+    if (i >= 0 && muc_[i].lanKhoiDong != 0) {
+      memset(&muc_[i], 0, sizeof(muc_[i]));
+      luu(i);
+    }
+    xSemaphoreGive(khoa_);
+  }
+
+  // Khung KHUNG_HOI_TEN để gửi tới gateway (qua RadioTask), không chờ trả lời
+  khung_ten requestFrame(uint8_t loaiCan, const uint8_t* uid, uint8_t doDaiUid) {
+    khung_ten k = {};
+    k.loaiCan = loaiCan;
+    k.doDaiUid = doDaiUid;
+    memcpy(k.uid, uid, doDaiUid);
+    dongGoiKhung(k, KHUNG_HOI_TEN);
+    soLanHoi_++;
+    return k;
+  }
+
+  // Gọi từ callback nhận ESP-NOW: chỉ kiểm tra và chép khung vào hàng đợi
+  void onFrame(const uint8_t* data, int len) {
+    khung_ten k;
+    if (!kiemTraKhung(data, len, KHUNG_TEN, k)) return;
+    xQueueSend(hangDoi_, &k, 0);
+  }
+
+  // Lấy một khung trả lời (chờ tối đa cho tick) và cập nhật cache theo khung đó
+  bool poll(khung_ten& ra, TickType_t cho) {
+    if (xQueueReceive(hangDoi_, &ra, cho) != pdTRUE) return false;
+    if (ra.coTen) put(ra.uid, ra.doDaiUid, ra.ten, true);
+    else remove(ra.uid, ra.doDaiUid);
+    return true;
+  }
+
+  uint32_t hitCount() const { return soLanTrung_; }
+  uint32_t missCount() const { return soLanTruot_; }
+  uint32_t requestCount() const { return soLanHoi_; }
+  uint32_t flashWrites() const { return soLanGhi_; }
+
+private:
+  typedef struct {
+    uint8_t doDaiUid;      // 0: ô trống
+    uint8_t uid[10];
+    char ten[kDoDaiTen];
+    uint16_t lanKhoiDong;  // lần khởi động lấy tên từ gateway, 0: tên đọc từ thẻ
+    uint32_t lanDung;      // càng lớn càng mới dùng
+  } muc_khach_hang;
+
+  int tim(const uint8_t* uid, uint8_t doDaiUid) const {
+    for (uint8_t i = 0; i < kSoMuc; i++)
+      if (muc_[i].doDaiUid == doDaiUid && memcmp(muc_[i].uid, uid, doDaiUid) == 0) return i;
+    return -1;
+  }
+
+  // Ô trống đầu tiên, hết ô trống thì ô dùng lâu nhất
+  int chonMucThay() const {
+    int chon = 0;
+    for (uint8_t i = 0; i < kSoMuc; i++) {
+      if (muc_[i].doDaiUid == 0) return i;
+      if (muc_[i].lanDung < muc_[chon].lanDung) chon = i;
+    }
+    return chon;
+  }
+
+  static const char* tenKhoa(uint8_t i, char khoa[5]) {
+    snprintf(khoa, 5, "m%u", (unsigned)i);
+    return khoa;
+  }
+
+  // Ghi (hoặc xoá khoá của ô trống) một ô, prefs đã mở để ghi
+  void ghiO(Preferences& prefs, uint8_t i) {
+    char khoa[5];
+    if (muc_[i].doDaiUid) prefs.putBytes(tenKhoa(i, khoa), &muc_[i], sizeof(muc_[i]));
+    else prefs.remove(tenKhoa(i, khoa));
+  }
+
+  void luu(uint8_t i) {
+    Preferences prefs;
+    prefs.begin("khachhang", false);
+    ghiO(prefs, i);
+    prefs.end();
+    soLanGhi_++;
+  }
+
+  muc_khach_hang muc_[kSoMuc];
+  uint32_t demDung_ = 0;
+  uint16_t lanKhoiDong_ = 0;
+  QueueHandle_t hangDoi_ = NULL;
+  SemaphoreHandle_t khoa_ = NULL;
+
+  uint32_t soLanTrung_ = 0;
+  uint32_t soLanTruot_ = 0;
+  uint32_t soLanHoi_ = 0;
+  uint32_t soLanGhi_ = 0;
+};
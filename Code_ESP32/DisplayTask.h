@@ -0,0 +1,159 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "ScaleDisplay.h"
+
+// Task riêng vẽ màn hình trạm cân: loop() và các task khác chỉ gửi lệnh qua hàng đợi rồi làm
+// tiếp, không phải chờ vẽ trên SPI.
+//
+// Lệnh set được áp ngay vào ScaleDisplay (chỉ chép chuỗi); khi hàng đợi hết lệnh mới render()
+// một lần, nên nhiều trường đổi liên tiếp chỉ tốn một lần vẽ. Màn hình tự xoá sau thoiGianXoa ms kể từ
+// release() (kết quả lần cân đã hiện); giữa hold() và release() (đang cân) thì không bao giờ tự xoá.
+// TFT dùng chung bus SPI với MFRC522: mỗi lần vẽ giữ spi (mutex của sketch).
+class DisplayTask {
+public:
+  DisplayTask(ScaleDisplay& manHinh, uint32_t thoiGianXoa) : manHinh_(manHinh), thoiGianXoa_(thoiGianXoa) {}
+
+  bool begin(SemaphoreHandle_t spi, UBaseType_t soLenhHangDoi = 16, UBaseType_t uuTien = 2, BaseType_t core = 1) {
+    spi_ = spi;
+    hangDoi_ = xQueueCreate(soLenhHangDoi, sizeof(lenh_man_hinh));
+    if (!hangDoi_) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "manhinh", 4096, this, uuTien, NULL, core) == pdPASS;
+  }
+
+  void set(uint8_t truong, const char* giaTri) {
+    lenh_man_hinh l;
+    l.loai = LENH_SET;
+    l.truong = truong;
+    strlcpy(l.noiDung, giaTri ? giaTri : "", sizeof(l.noiDung));
+    gui(l);
+  }
+
+  __attribute__((format(printf, 3, 4))) void printf(uint8_t truong, const char* dinhDang, ...) {
+    lenh_man_hinh l;
+    l.loai = LENH_SET;
+    l.truong = truong;
+    va_list ds;
+    va_start(ds, dinhDang);
+    vsnprintf(l.noiDung, sizeof(l.noiDung), dinhDang, ds);
+    va_end(ds);
+    gui(l);
+  }
+
+  void showMessage(const char* noiDung, uint16_t mau) {
+    lenh_man_hinh l;
+    l.loai = LENH_THONG_BAO;
+    l.mau = mau;
+    strlcpy(l.noiDung, noiDung, sizeof(l.noiDung));
+    gui(l);
+  }
+
+  void clear() {
+    lenh_man_hinh l;
+    l.loai = LENH_XOA;
+    gui(l);
+  }
+
+  // Bắt đầu một lần cân: không tự xoá màn hình cho tới release()
+  void hold() {
+    lenh_man_hinh l;
+    l.loai = LENH_GIU;
+    gui(l);
+  }
+
+  // Kết quả đã hiện: xoá màn hình sau thoiGianXoa ms tính từ lúc này
+  void release() {
+    lenh_man_hinh l;
+    l.loai = LENH_THA;
+    gui(l);
+  }
+
+  // Màn hình đang hiện một lần cân (chưa bị xoá vì hết thời gian)
+  bool showing() const { return dangHien_; }
+
+private:
+  enum { LENH_SET, LENH_THONG_BAO, LENH_XOA, LENH_GIU, LENH_THA };
+
+  typedef struct {
+    uint8_t loai;
+    uint8_t truong;
+    uint16_t mau;
+    char noiDung[ScaleDisplay::kDoDaiGiaTri];
+  } lenh_man_hinh;
+
+  void gui(const lenh_man_hinh& l) {
+    if (l.loai == LENH_XOA) dangHien_ = false;
+    else if (l.loai != LENH_GIU && l.loai != LENH_THA) dangHien_ = true;
+    xQueueSend(hangDoi_, &l, portMAX_DELAY);
+  }
+
+  static void taskEntry(void* thamSo) { static_cast<DisplayTask*>(thamSo)->chay(); }
+
+  void chay() {
+    lenh_man_hinh l;
+    for (;;) {
+      // Hạn xoá tính từ lệnh release(), không phải từ lệnh gần nhất
+      TickType_t cho = portMAX_DELAY;
+      if (henXoa_) {
+        TickType_t daQua = xTaskGetTickCount() - henLuc_;
+        cho = daQua < pdMS_TO_TICKS(thoiGianXoa_) ? pdMS_TO_TICKS(thoiGianXoa_) - daQua : 0;
+      }
+      if (xQueueReceive(hangDoi_, &l, cho) != pdTRUE) {
+        henXoa_ = false;
+        dangHien_ = false;
+        l.loai = LENH_XOA;
+        apDung(l);
+        continue;
+      }
+
+      bool canVe = false, xongLanCan = false;
+      do {
+        if (l.loai == LENH_GIU || l.loai == LENH_THA) {
+          henXoa_ = l.loai == LENH_THA;
+          henLuc_ = xTaskGetTickCount();
+          xongLanCan |= henXoa_;
+        } else {
+          canVe = apDung(l);
+        }
+      } while (xQueueReceive(hangDoi_, &l, 0) == pdTRUE);
+
+      if (canVe) {
+        xSemaphoreTake(spi_, portMAX_DELAY);
+        manHinh_.render();
+        xSemaphoreGive(spi_);
+      }
+      if (xongLanCan) baoCaoThoiGianVe();
+    }
+  }
+
+  // Mỗi lần cân một dòng (sau khung vẽ kết quả), không in sau từng khung
+  void baoCaoThoiGianVe() {
+    const Log2Histogram& dayDu = manHinh_.fullFrameUs();
+    const Log2Histogram& motPhan = manHinh_.partialFrameUs();
+    Serial.printf("Vẽ màn hình: khung cuối %lu us; đầy đủ %lu lần, TB %lu us; một phần %lu lần, TB %lu us, p90 %lu us\n",
+                  (unsigned long)manHinh_.lastFrameUs(), (unsigned long)dayDu.count(), (unsigned long)dayDu.mean(),
+                  (unsigned long)motPhan.count(), (unsigned long)motPhan.mean(), (unsigned long)motPhan.percentile(90));
+  }
+
+  // true nếu lệnh cần render(); thông báo và xoá thì vẽ ngay, không render() đè lên
+  bool apDung(const lenh_man_hinh& l) {
+    if (l.loai == LENH_SET) {
+      manHinh_.set(l.truong, l.noiDung);
+      return true;
+    }
+    xSemaphoreTake(spi_, portMAX_DELAY);
+    if (l.loai == LENH_THONG_BAO) manHinh_.showMessage(l.noiDung, l.mau);
+    else manHinh_.clear();
+    xSemaphoreGive(spi_);
+    return false;
+  }
+
+  ScaleDisplay& manHinh_;
+  uint32_t thoiGianXoa_;
+  SemaphoreHandle_t spi_ = NULL;
+  QueueHandle_t hangDoi_ = NULL;
+  volatile bool dangHien_ = false;
+  bool henXoa_ = false;     // đã release(): xoá khi hết thoiGianXoa_ tính từ henLuc_
+  TickType_t henLuc_ = 0;
+};
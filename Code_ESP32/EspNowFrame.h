@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Khung ESP-NOW nhị phân dùng chung cho Scale_1/2/3 và Gateway.
+// Thay cho struct_message { char uidStr[20]; char khoiLuong[20]; uint8_t loaiCan; } (41 byte, ASCII).
+#define KHUNG_PHIEN_BAN 1
+
+enum {
+  KHUNG_CAN = 1,          // một lần cân từ trạm gửi về gateway
+  KHUNG_GHEP_NOI = 2,     // trạm cân phát quảng bá để tìm gateway
+  KHUNG_GHEP_NOI_OK = 3,  // gateway trả lời trực tiếp cho trạm cân
+  KHUNG_HOI_TEN = 4,      // trạm cân hỏi tên khách hàng theo UID thẻ
+  KHUNG_TEN = 5,          // gateway trả tên khách hàng cho trạm cân
+};
+
+typedef struct __attribute__((packed)) {
+  uint8_t phienBan;   // KHUNG_PHIEN_BAN
+  uint8_t loaiKhung;  // KHUNG_CAN
+  uint8_t loaiCan;    // 1: mủ tạp, 2: mủ nước, 3: TSC
+  uint8_t doDaiUid;   // 4, 7 hoặc 10 byte
+  uint8_t uid[10];    // UID thẻ RFID dạng byte thô
+  uint32_t soThuTu;   // tăng dần theo từng lần cân của trạm
+  uint32_t thoiGian;  // millis() của trạm lúc cân xong
+  int32_t giaTri;     // số nguyên phần nghìn: gram với khối lượng (kg * 1000), phần nghìn với TSC
+  uint16_t crc;       // CRC16-CCITT của mọi byte phía trước
+} khung_can;
+
+static_assert(sizeof(khung_can) == 28, "khung_can phải đúng 28 byte");
+
+// Ghép nối: trạm cân gửi KHUNG_GHEP_NOI tới FF:FF:FF:FF:FF:FF, gateway trả KHUNG_GHEP_NOI_OK;
+// MAC nguồn của khung trả lời chính là MAC gateway để trạm cân lưu lại.
+typedef struct __attribute__((packed)) {
+  uint8_t phienBan;
+  uint8_t loaiKhung;  // KHUNG_GHEP_NOI hoặc KHUNG_GHEP_NOI_OK
+  uint8_t loaiCan;    // loại cân của trạm gửi yêu cầu
+  uint8_t kenh;       // kênh WiFi gateway đang dùng (trong khung trả lời)
+  uint16_t crc;
+} khung_ghep_noi;
+
+// Tên khách hàng theo UID: trạm cân gửi KHUNG_HOI_TEN (ten rỗng), gateway trả KHUNG_TEN.
+// coTen = 0 trong khung trả lời nghĩa là server không có khách hàng nào mang RFID này.
+typedef struct __attribute__((packed)) {
+  uint8_t phienBan;
+  uint8_t loaiKhung;  // KHUNG_HOI_TEN hoặc KHUNG_TEN
+  uint8_t loaiCan;
+  uint8_t doDaiUid;
+  uint8_t uid[10];
+  uint8_t coTen;
+  char ten[32];       // tên hiển thị không dấu, luôn kết thúc bằng '\0'
+  uint16_t crc;
+} khung_ten;
+
+inline uint16_t khungCrc16(const uint8_t* p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  while (n--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Điền phiên bản, loại khung và CRC trước khi gửi
+inline void dongGoiKhung(khung_can& k) {
+  k.phienBan = KHUNG_PHIEN_BAN;
+  k.loaiKhung = KHUNG_CAN;
+  k.crc = khungCrc16((const uint8_t*)&k, offsetof(khung_can, crc));
+}
+
+inline void dongGoiKhung(khung_ghep_noi& k, uint8_t loaiKhung) {
+  k.phienBan = KHUNG_PHIEN_BAN;
+  k.loaiKhung = loaiKhung;
+  k.crc = khungCrc16((const uint8_t*)&k, offsetof(khung_ghep_noi, crc));
+}
+
+inline void dongGoiKhung(khung_ten& k, uint8_t loaiKhung) {
+  k.phienBan = KHUNG_PHIEN_BAN;
+  k.loaiKhung = loaiKhung;
+  k.ten[sizeof(k.ten) - 1] = '\0';
+  k.crc = khungCrc16((const uint8_t*)&k, offsetof(khung_ten, crc));
+}
+
+// Loại khung (KHUNG_*) của dữ liệu nhận được, 0 nếu không đọc được phần đầu
+inline uint8_t loaiKhungCua(const uint8_t* data, int len) {
+  if (len < 2 || data[0] != KHUNG_PHIEN_BAN) return 0;
+  return data[1];
+}
+
+inline bool kiemTraKhung(const uint8_t* data, int len, uint8_t loaiKhung, khung_ghep_noi& ra) {
+  if (len != (int)sizeof(khung_ghep_noi)) return false;
+  memcpy(&ra, data, sizeof(ra));
+  if (ra.phienBan != KHUNG_PHIEN_BAN || ra.loaiKhung != loaiKhung) return false;
+  return ra.crc == khungCrc16((const uint8_t*)&ra, offsetof(khung_ghep_noi, crc));
+}
+
+inline bool kiemTraKhung(const uint8_t* data, int len, uint8_t loaiKhung, khung_ten& ra) {
+  if (len != (int)sizeof(khung_ten)) return false;
+  memcpy(&ra, data, sizeof(ra));
+  if (ra.phienBan != KHUNG_PHIEN_BAN || ra.loaiKhung != loaiKhung) return false;
+  if (ra.doDaiUid == 0 || ra.doDaiUid > sizeof(ra.uid) || ra.ten[sizeof(ra.ten) - 1] != '\0') return false;
+  return ra.crc == khungCrc16((const uint8_t*)&ra, offsetof(khung_ten, crc));
+}
+
+// Kiểm tra độ dài, phiên bản, UID và CRC của khung nhận được
+inline bool kiemTraKhung(const uint8_t* data, int len, khung_can& ra) {
+  if (len != (int)sizeof(khung_can)) return false;
+  memcpy(&ra, data, sizeof(ra));
+  if (ra.phienBan != KHUNG_PHIEN_BAN || ra.loaiKhung != KHUNG_CAN) return false;
+  if (ra.doDaiUid == 0 || ra.doDaiUid > sizeof(ra.uid)) return false;
+  return ra.crc == khungCrc16((const uint8_t*)&ra, offsetof(khung_can, crc));
+}
+
+// UID dạng chuỗi hex viết hoa (giống RFID lưu trong KhachHang), ra phải có ít nhất 21 byte
+inline void uidToHex(const uint8_t* uid, uint8_t doDai, char* ra) {
+  static const char hex[] = "0123456789ABCDEF";
+  for (uint8_t i = 0; i < doDai; i++) {
+    ra[2 * i] = hex[uid[i] >> 4];
+    ra[2 * i + 1] = hex[uid[i] & 0x0F];
+  }
+  ra[2 * doDai] = '\0';
+}
+
+inline bool cungUid(const khung_can& a, const khung_can& b) {
+  return a.doDaiUid == b.doDaiUid && memcmp(a.uid, b.uid, a.doDaiUid) == 0;
+}
+
+inline int32_t toPhanNghin(float giaTri) { return (int32_t)lroundf(giaTri * 1000.0f); }
+inline float tuPhanNghin(int32_t giaTri) { return giaTri / 1000.0f; }
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <Preferences.h>
+#include "EspNowFrame.h"
+
+// Ghép nối trạm cân với gateway, thay cho MAC gateway viết cứng trong từng firmware.
+// Trạm cân phát KHUNG_GHEP_NOI quảng bá, gateway nào nhận được sẽ trả KHUNG_GHEP_NOI_OK;
+// MAC của gateway được lưu trong NVS ("khung"/"gw") để lần khởi động sau dùng ngay, kênh WiFi của
+// gateway cũng vậy ("khung"/"kenh") để khởi động không phải quét WiFi.
+
+static volatile bool daNhanGhepNoi = false;
+static uint8_t macGhepNoi[6];
+static uint8_t kenhGhepNoi = 0;
+static void (*nhanKhungKhac)(const uint8_t* mac, const uint8_t* data, int len) = nullptr;
+
+// Callback nhận duy nhất của trạm cân: khung trả lời ghép nối xử lý tại đây, khung loại khác
+// chuyển cho nhanKhungKhac (xem datNhanKhung)
+static void onGhepNoiRecv(const uint8_t* mac, const uint8_t* data, int len) {
+  if (loaiKhungCua(data, len) != KHUNG_GHEP_NOI_OK) {
+    if (nhanKhungKhac) nhanKhungKhac(mac, data, len);
+    return;
+  }
+  khung_ghep_noi k;
+  if (daNhanGhepNoi || !kiemTraKhung(data, len, KHUNG_GHEP_NOI_OK, k)) return;
+  memcpy(macGhepNoi, mac, 6);
+  kenhGhepNoi = k.kenh;
+  daNhanGhepNoi = true;
+}
+
+// Nhận các khung gateway gửi tới ngoài khung ghép nối (chạy trong task WiFi: phải ngắn)
+inline void datNhanKhung(void (*cb)(const uint8_t* mac, const uint8_t* data, int len)) {
+  nhanKhungKhac = cb;
+  esp_now_register_recv_cb(onGhepNoiRecv);
+}
+
+// Đọc MAC gateway đã ghép nối, false nếu chưa ghép nối lần nào
+inline bool docGatewayDaLuu(uint8_t mac[6]) {
+  Preferences prefs;
+  prefs.begin("khung", true);
+  bool co = prefs.getBytes("gw", mac, 6) == 6;
+  prefs.end();
+  return co;
+}
+
+// Kênh WiFi của gateway đã lưu, 0 nếu chưa có
+inline uint8_t docKenhDaLuu() {
+  Preferences prefs;
+  prefs.begin("khung", true);
+  uint8_t kenh = prefs.getUChar("kenh", 0);
+  prefs.end();
+  return kenh <= 13 ? kenh : 0;
+}
+
+// Lưu kênh (chỉ ghi flash khi đổi)
+inline void luuKenh(uint8_t kenh) {
+  if (kenh == 0 || kenh == docKenhDaLuu()) return;
+  Preferences prefs;
+  prefs.begin("khung", false);
+  prefs.putUChar("kenh", kenh);
+  prefs.end();
+}
+
+inline uint8_t kenhHienTai() {
+  uint8_t kenh = 0;
+  wifi_second_chan_t phu;
+  esp_wifi_get_channel(&kenh, &phu);
+  return kenh;
+}
+
+// Phát yêu cầu ghép nối trên kênh hiện tại và chờ tối đa choToiDa ms.
+// Thành công thì ghi MAC gateway vào mac và NVS. esp_now_init() phải được gọi trước.
+inline bool ghepNoiGateway(uint8_t loaiCan, uint8_t mac[6], unsigned long choToiDa) {
+  static const uint8_t quangBa[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  if (!esp_now_is_peer_exist(quangBa)) {
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, quangBa, 6);
+    peer.channel = 0;  // kênh hiện tại
+    peer.encrypt = false;
+    if (esp_now_add_peer(&peer) != ESP_OK) return false;
+  }
+
+  daNhanGhepNoi = false;
+  esp_now_register_recv_cb(onGhepNoiRecv);
+
+  khung_ghep_noi yeuCau = {};
+  yeuCau.loaiCan = loaiCan;
+  dongGoiKhung(yeuCau, KHUNG_GHEP_NOI);
+
+  unsigned long batDau = millis();
+  unsigned long lanGuiCuoi = 0;
+  bool daGui = false;
+  while (!daNhanGhepNoi && millis() - batDau < choToiDa) {
+    // Gửi lại mỗi 250 ms phòng khi gateway đang bận
+    if (!daGui || millis() - lanGuiCuoi >= 250) {
+      esp_now_send(quangBa, (const uint8_t*)&yeuCau, sizeof(yeuCau));
+      lanGuiCuoi = millis();
+      daGui = true;
+    }
+    delay(10);
+  }
+  esp_now_del_peer(quangBa);
+  if (!daNhanGhepNoi) return false;
+
+  memcpy(mac, macGhepNoi, 6);
+  uint8_t macDaLuu[6];
+  if (!docGatewayDaLuu(macDaLuu) || memcmp(macDaLuu, mac, 6) != 0) {
+    Preferences prefs;
+    prefs.begin("khung", false);
+    prefs.putBytes("gw", mac, 6);
+    prefs.end();
+  }
+  luuKenh(kenhGhepNoi ? kenhGhepNoi : kenhHienTai());
+  Serial.printf("Đã ghép nối gateway %02X:%02X:%02X:%02X:%02X:%02X, kênh %u\n",
+                mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], kenhHienTai());
+  return true;
+}
+
+// Chưa biết kênh hoặc gateway đã đổi kênh (AP đổi kênh): phát yêu cầu ghép nối lần lượt trên
+// kênh 1..13, mỗi kênh chờ choMoiKenh ms. Trả về kênh tìm thấy (đã chuyển sang và đã lưu),
+// 0 nếu không kênh nào trả lời (trở lại kênh cũ).
+inline uint8_t quetKenhGateway(uint8_t loaiCan, uint8_t mac[6], unsigned long choMoiKenh = 300) {
+  uint8_t kenhCu = kenhHienTai();
+  for (uint8_t kenh = 1; kenh <= 13; kenh++) {
+    esp_wifi_set_channel(kenh, WIFI_SECOND_CHAN_NONE);
+    if (ghepNoiGateway(loaiCan, mac, choMoiKenh)) return kenh;
+  }
+  if (kenhCu) esp_wifi_set_channel(kenhCu, WIFI_SECOND_CHAN_NONE);
+  return 0;
+}
+
+// Gửi mãi không được: có thể gateway đã bị thay hoặc đã đổi kênh. Thử ghép nối lại trên kênh
+// hiện tại, quetKenh thì dò thêm các kênh khác; đổi peer nếu MAC khác. true nếu gateway trả lời.
+// Peer gateway thêm với channel = 0 (kênh hiện tại) nên đổi kênh không phải thêm lại peer.
+inline bool ghepNoiLai(uint8_t loaiCan, uint8_t mac[6], bool quetKenh = false) {
+  uint8_t macMoi[6];
+  if (!ghepNoiGateway(loaiCan, macMoi, 1000) && !(quetKenh && quetKenhGateway(loaiCan, macMoi))) return false;
+  if (memcmp(macMoi, mac, 6) == 0) return true;
+  esp_now_del_peer(mac);
+  memcpy(mac, macMoi, 6);
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, mac, 6);
+  peer.channel = 0;
+  peer.encrypt = false;
+  return esp_now_add_peer(&peer) == ESP_OK;
+}
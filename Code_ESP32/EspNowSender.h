@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include "Log2Histogram.h"
+
+// Gửi ESP-NOW chờ kết quả thật của callback gửi (ACK lớp MAC từ gateway), thay cho việc đọc cờ
+// guiThanhCong ngay sau esp_now_send() rồi delay(100): cờ chưa kịp đổi nên khung đã tới nơi vẫn bị gửi lại.
+//
+// Callback gửi chạy trong task WiFi và đánh thức nơi gọi send() qua semaphore đếm. Thử lại khi NACK
+// hoặc hết giờ chờ, lùi kBackoffBase * 2^n ms cộng jitter. Mỗi esp_now_send() của send() có một số thứ
+// tự; callback tới theo thứ tự gửi nên callback thứ n là kết quả của lần gửi thứ n, và callback muộn
+// của lần đã hết giờ không bị lần thử sau tưởng là ACK của mình. Callback của khung gửi tới địa chỉ
+// khác (quảng bá ghép nối trong EspNowPairing.h) không được đếm.
+class EspNowSender {
+public:
+  static const uint32_t kBackoffBase = 10;  // ms
+
+  bool begin() {
+    xong_ = xSemaphoreCreateCounting(16, 0);
+    if (!xong_) return false;
+    hienTai_ = this;
+    return esp_now_register_send_cb(onSent) == ESP_OK;
+  }
+
+  // Gửi và chờ ACK, tối đa soLanThu lần, mỗi lần chờ choAck ms. true nếu gateway đã nhận.
+  bool send(const uint8_t* mac, const uint8_t* data, size_t len, uint8_t soLanThu = 5, uint32_t choAck = 50) {
+    // Đổi địa chỉ (ghép nối lại gateway khác): callback muộn của địa chỉ cũ sẽ không được đếm nữa
+    if (memcmp(mac, macDich_, 6) != 0) {
+      memcpy(macDich_, mac, 6);
+      soCallback_ = soLanGui_;
+    }
+    for (uint8_t lan = 0; lan < soLanThu; lan++) {
+      if (lan > 0) {
+        soLanThuLai_++;
+        uint32_t cho = kBackoffBase << (lan - 1);
+        vTaskDelay(pdMS_TO_TICKS(cho + esp_random() % (cho + 1)));
+      }
+
+      // Bỏ lần đánh thức cũ còn sót lại (callback muộn): soCallback_ đã đếm chúng
+      while (xSemaphoreTake(xong_, 0) == pdTRUE) continue;
+      // Callback có thể tới trước khi esp_now_send() trả về: số thứ tự lấy trước khi gửi
+      uint32_t soThuTu = soLanGui_ + 1;
+      unsigned long batDau = micros();
+      if (esp_now_send(mac, data, len) != ESP_OK) continue;
+      soLanGui_ = soThuTu;
+      if (!choKetQua(soThuTu, choAck)) {
+        soLanHetGio_++;
+        continue;
+      }
+      if (thanhCong_) {
+        thoiGianAck_.record(micros() - batDau);
+        return true;
+      }
+    }
+    soLanThatBai_++;
+    return false;
+  }
+
+  const Log2Histogram& ackLatencyUs() const { return thoiGianAck_; }
+  uint32_t retryCount() const { return soLanThuLai_; }
+  uint32_t timeoutCount() const { return soLanHetGio_; }
+  uint32_t failureCount() const { return soLanThatBai_; }
+
+private:
+  // Chờ callback của lần gửi soThuTu, bỏ qua callback muộn của các lần trước còn đang tới
+  bool choKetQua(uint32_t soThuTu, uint32_t choAck) {
+    TickType_t batDau = xTaskGetTickCount();
+    TickType_t han = pdMS_TO_TICKS(choAck);
+    for (;;) {
+      if ((int32_t)(soCallback_ - soThuTu) >= 0) return true;
+      TickType_t daQua = xTaskGetTickCount() - batDau;
+      if (daQua >= han || xSemaphoreTake(xong_, han - daQua) != pdTRUE) return false;
+    }
+  }
+
+  static void onSent(const uint8_t* mac, esp_now_send_status_t trangThai) {
+    EspNowSender* s = hienTai_;
+    if (!s || !mac || memcmp(mac, s->macDich_, 6) != 0) return;
+    s->thanhCong_ = (trangThai == ESP_NOW_SEND_SUCCESS);
+    s->soCallback_++;
+    xSemaphoreGive(s->xong_);
+  }
+
+  static EspNowSender* hienTai_;
+
+  SemaphoreHandle_t xong_ = NULL;
+  volatile bool thanhCong_ = false;
+  uint8_t macDich_[6] = {};
+  volatile uint32_t soLanGui_ = 0;   // số thứ tự esp_now_send() cuối cùng của send()
+  volatile uint32_t soCallback_ = 0;  // số callback tới địa chỉ macDich_ đã nhận
+  Log2Histogram thoiGianAck_;
+  uint32_t soLanThuLai_ = 0;
+  uint32_t soLanHetGio_ = 0;
+  uint32_t soLanThatBai_ = 0;
+};
+
+EspNowSender* EspNowSender::hienTai_ = nullptr;
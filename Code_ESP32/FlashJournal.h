@@ -0,0 +1,278 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Nhật ký ghi nối tiếp (write-ahead) trên LittleFS/SPIFFS cho bản ghi kích thước cố định T.
+//
+// File dữ liệu:  [magic 4B][thế hệ 4B] rồi các bản ghi [magic 2B][độ dài 2B][crc32 4B][T]
+// File xác nhận: [thế hệ 4B][vị trí 4B] – mọi bản ghi trước "vị trí" đã được server xác nhận.
+//
+// Khi nén, phần chưa xác nhận được chép sang file mới với thế hệ +1, nên nếu mất điện
+// giữa chừng thì file xác nhận cũ (khác thế hệ) tự bị bỏ qua và đọc lại từ đầu file mới.
+//
+// Bên ngoài chỉ dùng số thứ tự bản ghi (tăng dần, không đổi khi nén); vì bản ghi có
+// kích thước cố định nên vị trí trong file tính được từ số thứ tự.
+template <typename T>
+class FlashJournal {
+public:
+  static const uint32_t kMagicFile = 0x4C4E4A47;  // "GJNL"
+  static const uint16_t kMagicBanGhi = 0xA55A;
+  static const uint32_t kDauFile = 8;
+
+  struct DauBanGhi {
+    uint16_t magic;
+    uint16_t doDai;
+    uint32_t crc;
+  };
+  static const uint32_t kKichThuocBanGhi = sizeof(DauBanGhi) + sizeof(T);
+
+  FlashJournal(fs::FS& fs, const char* duongDan, uint32_t kichThuocToiDa)
+    : fs_(fs), duongDan_(duongDan), duongDanAck_(String(duongDan) + ".ack"),
+      duongDanTam_(String(duongDan) + ".tmp"), kichThuocToiDa_(kichThuocToiDa) {}
+
+  // Đọc vị trí xác nhận, quét phần chưa xác nhận và bỏ bản ghi ghi dở ở cuối (nếu có)
+  bool begin() {
+    theHe_ = 0;
+    soThuTuDauFile_ = 0;
+    viTriXacNhan_ = kDauFile;
+    viTriCuoi_ = kDauFile;
+
+    // Mất điện giữa lúc thay file khi nén: file tạm đã đầy đủ
+    if (!fs_.exists(duongDan_) && fs_.exists(duongDanTam_)) fs_.rename(duongDanTam_, duongDan_);
+    if (!fs_.exists(duongDan_)) return taoFileMoi(0);
+
+    File f = fs_.open(duongDan_, "r");
+    if (!f) return false;
+    uint32_t dau[2];
+    if (f.read((uint8_t*)dau, sizeof(dau)) != sizeof(dau) || dau[0] != kMagicFile) {
+      f.close();
+      fs_.remove(duongDan_);
+      return taoFileMoi(0);
+    }
+    theHe_ = dau[1];
+
+    uint32_t ack[2];
+    File fa = fs_.open(duongDanAck_, "r");
+    if (fa && fa.read((uint8_t*)ack, sizeof(ack)) == sizeof(ack) && ack[0] == theHe_) {
+      viTriXacNhan_ = ack[1];
+    }
+    if (fa) fa.close();
+
+    // Quét để đếm bản ghi chưa gửi và tìm điểm kết thúc hợp lệ
+    unsigned long batDau = micros();
+    uint32_t kichThuocFile = f.size();
+    if (viTriXacNhan_ > kichThuocFile) viTriXacNhan_ = kichThuocFile;
+    viTriXacNhan_ -= (viTriXacNhan_ - kDauFile) % kKichThuocBanGhi;
+    f.seek(viTriXacNhan_);
+    viTriCuoi_ = viTriXacNhan_;
+    T tam;
+    while (docBanGhi(f, tam)) viTriCuoi_ += kKichThuocBanGhi;
+    f.close();
+    thoiGianQuet_ = micros() - batDau;
+
+    // Có rác ở cuối file (mất điện khi đang ghi) -> nén lại để lần ghi sau nối đúng chỗ
+    if (viTriCuoi_ != kichThuocFile) return nen();
+    return true;
+  }
+
+  // Ghi thêm một bản ghi và đồng bộ xuống flash; soThuTu (nếu có) nhận số thứ tự của bản ghi
+  bool append(const T& banGhi, uint32_t* soThuTu = nullptr) {
+    if (viTriCuoi_ + kKichThuocBanGhi > kichThuocToiDa_) {
+      soLanDay_++;
+      return false;
+    }
+
+    // Lần ghi trước bị dở: phải bỏ phần rác ở cuối file trước, không thì bản ghi mới nằm sau rác
+    // trong khi read() tìm nó ở viTriCuoi_
+    if (cuoiFileHong_ && !nen()) return false;
+
+    unsigned long batDau = micros();
+    DauBanGhi dau = { kMagicBanGhi, (uint16_t)sizeof(T), crc32((const uint8_t*)&banGhi, sizeof(T)) };
+    File f = fs_.open(duongDan_, "a");
+    if (!f) return false;
+    bool ok = f.write((const uint8_t*)&dau, sizeof(dau)) == sizeof(dau) &&
+              f.write((const uint8_t*)&banGhi, sizeof(T)) == sizeof(T);
+    f.close();  // close() đồng bộ metadata của LittleFS
+    if (!ok) {
+      // Có thể đã ghi được một phần bản ghi; fs::File không cắt được file nên chép lại phần hợp lệ
+      // (nén). Nén lỗi (flash đầy) thì lần append sau thử lại.
+      cuoiFileHong_ = true;
+      nen();
+      return false;
+    }
+
+    if (soThuTu) *soThuTu = endSeq();
+    viTriCuoi_ += kKichThuocBanGhi;
+
+    unsigned long thoiGian = micros() - batDau;
+    soLanGhi_++;
+    tongThoiGianGhi_ += thoiGian;
+    if (thoiGian > thoiGianGhiMax_) thoiGianGhiMax_ = thoiGian;
+    return true;
+  }
+
+  // Đọc tối đa n bản ghi bắt đầu từ số thứ tự soThuTu, dời soThuTu tới sau bản ghi cuối đã đọc
+  size_t read(uint32_t& soThuTu, T* ra, size_t n) {
+    if (soThuTu < commitSeq()) soThuTu = commitSeq();
+    if (soThuTu >= endSeq() || n == 0) return 0;
+    File f = fs_.open(duongDan_, "r");
+    if (!f) return 0;
+
+    unsigned long batDau = micros();
+    f.seek(viTriCua(soThuTu));
+    size_t soDaDoc = 0;
+    while (soDaDoc < n && soThuTu < endSeq() && docBanGhi(f, ra[soDaDoc])) {
+      soThuTu++;
+      soDaDoc++;
+    }
+    f.close();
+
+    soBanGhiDaDoc_ += soDaDoc;
+    tongThoiGianDoc_ += micros() - batDau;
+    return soDaDoc;
+  }
+
+  // Xác nhận mọi bản ghi có số thứ tự nhỏ hơn soThuTuKeTiep.
+  // Nén file khi đã xác nhận hết hoặc phần đã xác nhận chiếm quá nửa dung lượng.
+  bool commit(uint32_t soThuTuKeTiep) {
+    if (soThuTuKeTiep <= commitSeq() || soThuTuKeTiep > endSeq()) return false;
+    viTriXacNhan_ = viTriCua(soThuTuKeTiep);
+
+    if (viTriXacNhan_ == viTriCuoi_) {
+      // Đã gửi hết: bỏ file, không cần chép gì
+      fs_.remove(duongDan_);
+      return taoFileMoi(theHe_ + 1);
+    }
+    // Nén không được (flash đầy...) thì file cũ vẫn nguyên: chỉ ghi xác nhận, lần commit sau thử nén lại
+    if (viTriXacNhan_ - kDauFile >= kichThuocToiDa_ / 2 && nen()) return true;
+    return ghiXacNhan();
+  }
+
+  uint32_t commitSeq() const { return soThuTuCua(viTriXacNhan_); }
+  uint32_t endSeq() const { return soThuTuCua(viTriCuoi_); }
+  uint32_t pendingCount() const { return endSeq() - commitSeq(); }
+  uint32_t sizeBytes() const { return viTriCuoi_; }
+  uint32_t capacityBytes() const { return kichThuocToiDa_; }
+  uint32_t appendCount() const { return soLanGhi_; }
+  uint32_t fullCount() const { return soLanDay_; }
+  uint32_t compactionCount() const { return soLanNen_; }
+  uint32_t compactionErrorCount() const { return soLanNenLoi_; }
+  // Thời gian (us): tổng và lớn nhất của append(), quét lúc begin(), tổng của read()
+  uint32_t appendTotalUs() const { return tongThoiGianGhi_; }
+  uint32_t appendMaxUs() const { return thoiGianGhiMax_; }
+  uint32_t bootScanUs() const { return thoiGianQuet_; }
+  uint32_t replayCount() const { return soBanGhiDaDoc_; }
+  uint32_t replayTotalUs() const { return tongThoiGianDoc_; }
+
+private:
+  static uint32_t crc32(const uint8_t* p, size_t n) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (n--) {
+      crc ^= *p++;
+      for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+  }
+
+  uint32_t viTriCua(uint32_t soThuTu) const {
+    return kDauFile + (soThuTu - soThuTuDauFile_) * kKichThuocBanGhi;
+  }
+  uint32_t soThuTuCua(uint32_t viTri) const {
+    return soThuTuDauFile_ + (viTri - kDauFile) / kKichThuocBanGhi;
+  }
+
+  bool docBanGhi(File& f, T& ra) {
+    DauBanGhi dau;
+    if (f.read((uint8_t*)&dau, sizeof(dau)) != sizeof(dau)) return false;
+    if (dau.magic != kMagicBanGhi || dau.doDai != sizeof(T)) return false;
+    if (f.read((uint8_t*)&ra, sizeof(T)) != sizeof(T)) return false;
+    return dau.crc == crc32((const uint8_t*)&ra, sizeof(T));
+  }
+
+  bool taoFileMoi(uint32_t theHe) {
+    File f = fs_.open(duongDan_, "w");
+    if (!f) return false;
+    uint32_t dau[2] = { kMagicFile, theHe };
+    bool ok = f.write((const uint8_t*)dau, sizeof(dau)) == sizeof(dau);
+    f.close();
+    if (!ok) return false;
+    theHe_ = theHe;
+    soThuTuDauFile_ = commitSeq();
+    viTriXacNhan_ = kDauFile;
+    viTriCuoi_ = kDauFile;
+    cuoiFileHong_ = false;
+    return ghiXacNhan();
+  }
+
+  bool ghiXacNhan() {
+    File f = fs_.open(duongDanAck_, "w");
+    if (!f) return false;
+    uint32_t ack[2] = { theHe_, viTriXacNhan_ };
+    bool ok = f.write((const uint8_t*)ack, sizeof(ack)) == sizeof(ack);
+    f.close();
+    return ok;
+  }
+
+  // Chép phần chưa xác nhận sang file mới (thế hệ +1) rồi thay file cũ.
+  // File cũ chỉ bị xóa khi đã chép đủ; lỗi đọc/ghi thì bỏ file tạm, giữ file cũ và trả về false.
+  bool nen() {
+    File cu = fs_.open(duongDan_, "r");
+    if (!cu) return false;
+    File moi = fs_.open(duongDanTam_, "w");
+    if (!moi) {
+      cu.close();
+      return false;
+    }
+
+    uint32_t dau[2] = { kMagicFile, theHe_ + 1 };
+    bool ok = moi.write((const uint8_t*)dau, sizeof(dau)) == sizeof(dau) && cu.seek(viTriXacNhan_);
+    uint8_t buf[128];
+    uint32_t conLai = viTriCuoi_ - viTriXacNhan_;
+    while (ok && conLai > 0) {
+      size_t n = cu.read(buf, conLai < sizeof(buf) ? conLai : sizeof(buf));
+      ok = n > 0 && moi.write(buf, n) == n;
+      if (ok) conLai -= n;
+    }
+    cu.close();
+    moi.close();
+    if (!ok || conLai != 0) {
+      fs_.remove(duongDanTam_);
+      soLanNenLoi_++;
+      return false;
+    }
+
+    fs_.remove(duongDan_);
+    fs_.rename(duongDanTam_, duongDan_);
+    theHe_++;
+    soThuTuDauFile_ = commitSeq();
+    viTriCuoi_ = kDauFile + (viTriCuoi_ - viTriXacNhan_);
+    viTriXacNhan_ = kDauFile;
+    cuoiFileHong_ = false;
+    soLanNen_++;
+    return ghiXacNhan();
+  }
+
+  fs::FS& fs_;
+  const char* duongDan_;
+  String duongDanAck_;
+  String duongDanTam_;
+  uint32_t kichThuocToiDa_;
+
+  uint32_t theHe_ = 0;
+  uint32_t soThuTuDauFile_ = 0;   // số thứ tự của bản ghi đầu tiên trong file hiện tại
+  uint32_t viTriXacNhan_ = kDauFile;
+  uint32_t viTriCuoi_ = kDauFile;
+  bool cuoiFileHong_ = false;     // sau viTriCuoi_ còn rác của một lần append() lỗi
+
+  // Thống kê
+  uint32_t soLanGhi_ = 0;
+  unsigned long tongThoiGianGhi_ = 0;
+  unsigned long thoiGianGhiMax_ = 0;
+  uint32_t soLanDay_ = 0;
+  uint32_t soBanGhiDaDoc_ = 0;
+  unsigned long tongThoiGianDoc_ = 0;
+  unsigned long thoiGianQuet_ = 0;
+  uint32_t soLanNen_ = 0;
+  uint32_t soLanNenLoi_ = 0;
+};
@@ -2,7 +2,15 @@
 #include <esp_wifi.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <WebServer.h>
+#include "SpscRing.h"
+#include "FlashJournal.h"
+#include "EspNowFrame.h"
+#include "Log2Histogram.h"
+#include "WiFiLink.h"
 
 // const char* SSID = "1PHNAD";
 // const char* PASS = "Hongbietmk";
@@ -11,164 +19,1238 @@
 const char* SSID = "DoAnTotNghiep";
 const char* PASS = "12345678";
 
-// API endpoints (using local machine's IP)
-const char* muTapUrl = "https://thanhdat.nbqtai.id.vn/giaodich/mu-tap/";
-const char* tscDrcUrl = "https://thanhdat.nbqtai.id.vn/giaodich/tsc-drc/";
-const char* muNuocUrl = "https://thanhdat.nbqtai.id.vn/giaodich/mu-nuoc/";
+// Kết nối WiFi chạy nền: đường nhanh bằng BSSID/kênh/IP đã lưu, tự kết nối lại khi mất AP
+WiFiLink ketNoiWiFi(SSID, PASS);
 
+// API endpoint: gửi nhiều lần cân trong một request
+const char* batchUrl = "https://thanhdat.nbqtai.id.vn/giaodich/batch/";
+// Tên khách hàng theo RFID cho màn hình trạm cân (thêm RFID vào cuối)
+const char* khachHangUrl = "https://thanhdat.nbqtai.id.vn/khachhang/by-rfid/";
+
+// 1: in từng lần cân/từng phần tử phản hồi ra Serial (gỡ lỗi); 0: chỉ in lỗi và bản tóm tắt định kỳ
+#define LOG_CHI_TIET 0
+
+// Một lần cân: khung gốc kèm MAC trạm cân. (MAC, khung.soThuTu) là khoá chống trùng
+// gửi lên server, nên MAC cũng được ghi vào journal.
 typedef struct {
-  char uidStr[20];
-  char khoiLuong[20];
-  uint8_t loaiCan;
-} struct_message;
+  uint8_t mac[6];
+  khung_can khung;
+} lan_can;
+
+// Một khung nhận được kèm địa chỉ MAC nguồn
+typedef struct {
+  lan_can data;
+  uint32_t nhanLuc;  // micros() lúc callback nhận khung
+} ban_tin_nhan;
+
+// Lần cân đã ghi journal, chuyển từ task nhận sang task upload
+typedef struct {
+  lan_can data;
+  uint32_t soThuTu;  // số thứ tự trong journal
+  uint32_t ghiLuc;   // millis() lúc ghi xong journal
+} lan_can_moi;
+
+// Pipeline: onDataRecv (task WiFi) -> hangDoiNhan -> ingestTask (core 0, cùng core với WiFi)
+// -> journal + hangDoiTaiLen -> uploadTask (core 1) -> các luồng upload. housekeepingTask lo LED, thống kê
+// và các khung unicast trả lời trạm cân (hangDoiGuiTram).
+SpscRing<ban_tin_nhan, 64> hangDoiNhan;
+QueueHandle_t hangDoiTaiLen = NULL;
+TaskHandle_t ingestTaskHandle = NULL;
+const int hangDoiTaiLenMax = 64;
+volatile uint32_t soKhungHong = 0;  // sai độ dài, phiên bản hoặc CRC
+uint32_t soKhungKhongHopLe = 0;
+uint32_t soKhungTrung = 0;
+uint32_t soKhungDaGhi = 0;  // khung hợp lệ đã ghi journal
+uint32_t soLanTranHangDoiTaiLen = 0;
+
+uint32_t soRequest = 0;
+uint32_t soLanBatTay = 0;
+uint32_t soLanCanDaGui = 0;
+unsigned long tongThoiGianUpload = 0;  // ms
+
+// Gom lô: gửi khi đủ batchMax lần cân hoặc lần cân sớm nhất đã chờ quá batchWindow
+const int batchMax = 20;
+const unsigned long batchWindow = 300;  // ms
+
+// Luồng upload: lần cân được băm theo RFID vào một trong soLuongUpload luồng, mỗi luồng có task và
+// kết nối HTTPS keep-alive riêng (chỉ bắt tay TLS lại khi server đóng kết nối). Mọi lần cân của một
+// khách hàng nằm cùng luồng và mỗi luồng chỉ có một lô đang gửi, nên thứ tự theo RFID vẫn chặt, còn
+// khách hàng ở luồng khác không phải chờ request của nhau. Mỗi kết nối TLS tốn ~40 KB heap cộng stack
+// task nên chỉ dùng 2 luồng bên cạnh kết nối hỏi tên.
+const int soLuongUpload = 2;
+typedef struct {
+  int soChon;
+  int chon[batchMax];  // vị trí trong bangCho
+} lo_upload;
+typedef struct {
+  WiFiClientSecure tls;
+  HTTPClient http;
+  QueueHandle_t lo;        // lô uploadTask giao, tối đa một lô
+  volatile bool dangGui;
+  uint32_t doSau;          // lần cân của luồng trong bảng chờ chưa xong
+  uint32_t soDangGui;      // lần cân trong lô đang gửi
+  uint32_t soDangGhep;     // lần cân mủ tạp đang giữ chờ ghép
+  uint32_t soRequest;
+} luong_upload;
+luong_upload luongUpload[soLuongUpload];
+TaskHandle_t uploadTaskHandle = NULL;
+
+// Mọi lần cân được ghi vào journal trên flash trước khi upload, chỉ xoá khi server đã xác nhận.
+// Sau mất WiFi/API hoặc khởi động lại, các lần cân chưa xác nhận được đọc lại đúng thứ tự.
+// Task nhận ghi, task upload đọc/xác nhận nên mọi thao tác journal đi qua journalMutex.
+FlashJournal<lan_can> journal(LittleFS, "/journal.bin", 256 * 1024);
+SemaphoreHandle_t journalMutex = NULL;
+uint32_t soThuTuDoc = 0;             // số thứ tự journal tiếp theo chưa có trong bảng chờ
+uint32_t soThuTuXacNhan = 0;         // journal đã xác nhận tới trước số thứ tự này
+uint32_t soLanGhiJournalLoi = 0;
 
-struct_message incoming;
-bool dataReceived = false;
+// Bảng các lần cân đã đọc từ journal, theo thứ tự journal. Mỗi lần cân có lịch gửi riêng:
+// gửi lỗi thì lùi thời điểm gửi theo hàm mũ (có jitter), các lần cân khác vẫn được gửi tiếp.
+// Lần cân của cùng một RFID luôn gửi theo đúng thứ tự (PUT mủ nước/TSC phải sau POST mủ tạp).
+// uploadTask thêm/bỏ mục và chia lô, các luồng upload ghi kết quả: bảng chờ và các số liệu upload
+// đi qua bangMutex (không giữ trong lúc chờ HTTP).
+enum { CHO_GUI = 0, DA_XONG = 1, DANG_GUI = 2 };
+typedef struct {
+  lan_can data;
+  uint32_t soThuTu;           // số thứ tự trong journal
+  uint8_t trangThai;
+  uint8_t soLanThu;
+  unsigned long thoiDiemGui;  // millis() sớm nhất được gửi
+  uint32_t ghiLuc;            // millis() lúc ghi journal, 0 nếu đọc lại từ lần chạy trước
+  int8_t tram;                // chỉ số trong bảng trạm cân, -1 nếu bảng đầy
+  uint8_t luong;              // luồng upload theo RFID
+  uint16_t ngay;              // ngày UTC lúc vào bảng, 0 nếu chưa đồng bộ giờ
+  bool khongGhep;             // server từ chối bản ghép: gửi từng phần
+  bool guiRieng;              // server từ chối cả lô chứa lần cân này: gửi một mình để biết lỗi của ai
+  int16_t ghep[2];            // mủ tạp đã ghép: vị trí lần cân mủ nước và TSC, -1 nếu không
+} lan_can_cho;
+
+// Vòng [0, bangChoMax) theo thứ tự journal; [bangChoMax, bangChoMax + bangGiuMax) là các ô giữ mủ tạp
+// chờ ghép (DA_XONG: ô trống). Chỉ số trong lô và ghep[] dùng chung một mảng nên gửi/kết quả không phân biệt.
+const int bangChoMax = 64;
+const int bangGiuMax = 32;
+lan_can_cho bangCho[bangChoMax + bangGiuMax];
+int dauBang = 0;
+int soTrongBang = 0;
+SemaphoreHandle_t bangMutex = NULL;
+
+// Ghép giao dịch: lần cân mủ tạp được giữ tới ghepTimeout chờ lần cân mủ nước và TSC của cùng RFID
+// trong ngày, rồi gửi chung một phần tử LoaiCan 0 (server ghi một lần thay cho ba request). Hết hạn,
+// hết ô giữ hoặc lần cân đọc lại sau khởi động thì gửi từng phần như cũ. Server chưa hỗ trợ
+// LoaiCan 0 (422 cả request) thì tắt ghép cho tới lần khởi động sau.
+// Lần cân đang giữ được chuyển ra ô giữ nên không chặn vòng chờ; journal chỉ xác nhận tới lần cân
+// giữ cũ nhất, khởi động lại thì các lần cân sau nó được gửi lại và server bỏ qua nhờ khoá chống trùng.
+const unsigned long ghepTimeout = 20UL * 60 * 1000;  // ms
+bool choPhepGhep = true;
+uint32_t soGiaoDichDaGhep = 0;
+uint32_t soLanGhepHetHan = 0;
+uint32_t soLanGhepHetO = 0;  // hết ô giữ: gửi từng phần ngay
+
+const unsigned long backoffBase = 1000;   // ms, lần thử lại đầu tiên
+const unsigned long backoffMax = 60000;   // ms
+uint32_t soLanHenLai = 0;
+uint32_t soLanCanBiTuChoi = 0;  // server trả 4xx, bỏ không gửi lại
+uint32_t soLanTachLo = 0;       // lô bị 4xx cả request, tách ra gửi từng lần cân
+
+// Phân bố mã HTTP theo nhóm: [0] lỗi kết nối, [1..5] 1xx..5xx.
+// maHttp đếm theo request, maKetQua đếm theo từng lần cân trong phản hồi lô.
+uint32_t maHttp[6];
+uint32_t maKetQua[6];
+
+void demMaHttp(uint32_t (&bang)[6], int ma) {
+  int nhom = ma <= 0 ? 0 : ma / 100;
+  if (nhom > 5) nhom = 5;
+  bang[nhom]++;
+}
+
+// Thời gian của từng chặng trong pipeline (histogram log2, bộ nhớ cố định)
+Log2Histogram tgNhan;     // callback -> ghi xong journal (us)
+Log2Histogram tgCho;      // ghi journal -> bắt đầu gửi lần đầu (ms)
+Log2Histogram tgHttp;     // một request HTTP (ms)
+Log2Histogram tgToanBo;   // nhận + ghi journal -> server xác nhận (ms)
+
+// Trạm cân hỏi tên khách hàng: onDataRecv -> hangDoiHoiTen -> tenTask. Đường này tách khỏi
+// pipeline lần cân và có kết nối HTTPS riêng để hỏi tên không phải chờ sau một lô upload.
+typedef struct {
+  uint8_t mac[6];
+  khung_ten khung;
+} yeu_cau_ten;
+
+// Tên đã hỏi server, giữ tenTtl ms (kể cả câu trả lời "không có khách hàng"). Chỉ tenTask dùng.
+typedef struct {
+  uint8_t doDaiUid;  // 0: ô trống
+  uint8_t uid[10];
+  uint8_t coTen;
+  char ten[32];
+  unsigned long layLuc;
+} ten_khach_hang;
+
+QueueHandle_t hangDoiHoiTen = NULL;
+const int bangTenMax = 64;
+ten_khach_hang bangTen[bangTenMax];
+const unsigned long tenTtl = 600000;  // ms
+WiFiClientSecure tenTlsClient;
+HTTPClient tenHttp;
+uint32_t soLanHoiTen = 0;
+uint32_t soLanTenCoSan = 0;    // trả lời từ bangTen không cần hỏi server
+uint32_t soLanLayTenLoi = 0;
+Log2Histogram tgTen;  // một lần hỏi tên server (ms)
+volatile uint32_t soLanBoHoiTen = 0;  // hangDoiHoiTen đầy
+
+// Khung unicast tới trạm cân (trả lời ghép nối, tên khách hàng): ingestTask và tenTask xếp vào đây,
+// housekeepingTask thêm peer tạm, gửi rồi xoá peer. Chỉ một task đụng tới peer nên không cần mutex,
+// và lần chờ khung rời hàng đợi phát không chặn task nhận.
+typedef struct {
+  uint8_t mac[6];
+  uint8_t doDai;
+  uint8_t duLieu[ESP_NOW_MAX_DATA_LEN];
+} khung_gui_tram;
 
-int maxRetries = 3;
+QueueHandle_t hangDoiGuiTram = NULL;
+volatile uint32_t soLanBoGuiTram = 0;  // hangDoiGuiTram đầy
+
+// Trang /metrics nội bộ (định dạng text Prometheus) để theo dõi tải mùa cạo
+WebServer metricsServer(80);
 
 #define Led 27
 bool ledState = true;      // Trạng thái LED
-// Thời gian chớp led
-unsigned long previousMillis = 0;
 const long interval = 900;  // Khoảng thời gian giữa mỗi lần chớp led(ms)
 
-// Callback khi nhận dữ liệu
+// Thời gian in thống kê hàng đợi và upload
+const long statsInterval = 60000;
+
+// Callback khi nhận dữ liệu: chỉ kiểm tra khung, chép vào hàng đợi rồi đánh thức task nhận,
+// không in Serial ở đây để không giữ task WiFi lâu.
 void onDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len) {
-  memcpy(&incoming, incomingData, sizeof(incoming));
-  
-  dataReceived = true;
-  Serial.println("Dữ liệu nhận được:");
-  Serial.print("UID: ");
-  Serial.println(incoming.uidStr);
-  Serial.print("Khối lượng: ");
-  Serial.println(incoming.khoiLuong);
-  Serial.print("Loại cân: ");
-  Serial.println(incoming.loaiCan);
+  ban_tin_nhan tin;
+  khung_ghep_noi ghepNoi;
+  if (loaiKhungCua(incomingData, len) == KHUNG_HOI_TEN) {
+    yeu_cau_ten yc;
+    if (!kiemTraKhung(incomingData, len, KHUNG_HOI_TEN, yc.khung)) {
+      soKhungHong++;
+      return;
+    }
+    memcpy(yc.mac, mac, sizeof(yc.mac));
+    if (xQueueSend(hangDoiHoiTen, &yc, 0) != pdTRUE) soLanBoHoiTen++;
+    return;
+  }
+  if (loaiKhungCua(incomingData, len) == KHUNG_GHEP_NOI &&
+      kiemTraKhung(incomingData, len, KHUNG_GHEP_NOI, ghepNoi)) {
+    // Yêu cầu ghép nối cũng đi qua hàng đợi, task nhận sẽ trả lời
+    memset(&tin.data.khung, 0, sizeof(tin.data.khung));
+    tin.data.khung.loaiKhung = KHUNG_GHEP_NOI;
+    tin.data.khung.loaiCan = ghepNoi.loaiCan;
+  } else if (!kiemTraKhung(incomingData, len, tin.data.khung)) {
+    soKhungHong++;
+    return;
+  }
+  memcpy(tin.data.mac, mac, sizeof(tin.data.mac));
+  tin.nhanLuc = micros();
+  hangDoiNhan.push(tin);
+  if (ingestTaskHandle) xTaskNotifyGive(ingestTaskHandle);
 }
 
+// UID dạng chuỗi hex để in log và gửi lên server
+String uidCua(const khung_can& m) {
+  char ra[21];
+  uidToHex(m.uid, m.doDaiUid, ra);
+  return String(ra);
+}
+
+// MAC dạng AA:BB:CC:DD:EE:FF (MaCan trong khoá chống trùng)
+String macCua(const uint8_t* mac) {
+  char ra[18];
+  snprintf(ra, sizeof(ra), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  return String(ra);
+}
+
+// Bảng trạm cân theo MAC: thêm khi trạm ghép nối hoặc gửi khung đầu tiên (kể cả bản ghi đọc lại
+// từ journal sau khởi động). Mục không bao giờ bị xoá nên chỉ số trong bảng dùng được làm khoá.
+// Thêm mục đi qua tramCanMutex; mỗi bộ đếm chỉ có một task ghi (soDaXacNhan/soDangCho: các task
+// upload, dưới bangMutex), các task khác chỉ đọc để in thống kê.
+typedef struct {
+  uint8_t mac[6];
+  uint8_t loaiCan;
+  bool daCoSoThuTu;
+  uint32_t soThuTuCuoi;        // số thứ tự khung lớn nhất đã nhận qua radio
+  uint32_t soKhung;            // khung hợp lệ đã ghi journal
+  uint32_t soTrung;            // khung gửi lại (mất ACK) bị bỏ
+  uint32_t soMat;              // số thứ tự bị hụt trong cùng một lần chạy của trạm
+  uint32_t soDaXacNhan;        // lần cân đã xong phía server
+  uint32_t soDangCho;          // lần cân trong bảng chờ chưa xong
+  unsigned long lanCuoiThay;   // millis() lần cuối nhận khung từ trạm
+} tram_can;
+
+const int tramCanMax = 32;
+tram_can tramCan[tramCanMax];
+volatile int soTramCan = 0;
+SemaphoreHandle_t tramCanMutex = NULL;
+uint32_t soLanBangTramDay = 0;
+
+// Chỉ số của trạm cân có MAC này, thêm mới nếu chưa có; -1 nếu bảng đầy
+int timTramCan(const uint8_t* mac) {
+  xSemaphoreTake(tramCanMutex, portMAX_DELAY);
+  int viTri = -1;
+  for (int i = 0; i < soTramCan && viTri < 0; i++) {
+    if (memcmp(tramCan[i].mac, mac, 6) == 0) viTri = i;
+  }
+  if (viTri < 0 && soTramCan < tramCanMax) {
+    viTri = soTramCan;
+    memset(&tramCan[viTri], 0, sizeof(tram_can));
+    memcpy(tramCan[viTri].mac, mac, 6);
+    soTramCan = soTramCan + 1;
+  } else if (viTri < 0) {
+    soLanBangTramDay++;
+  }
+  xSemaphoreGive(tramCanMutex);
+  return viTri;
+}
+
+// Ghi nhận số thứ tự khung của trạm; false nếu là bản gửi lại của khung đã nhận.
+// 16 bit cao là số lần khởi động của trạm: khác lần chạy thì bắt đầu đếm lại.
+bool ghiNhanSoThuTu(tram_can& t, uint32_t soThuTu) {
+  t.lanCuoiThay = millis();
+  if (t.daCoSoThuTu && (soThuTu >> 16) == (t.soThuTuCuoi >> 16)) {
+    if ((soThuTu & 0xFFFF) <= (t.soThuTuCuoi & 0xFFFF)) {
+      t.soTrung++;
+      return false;
+    }
+    t.soMat += (soThuTu & 0xFFFF) - (t.soThuTuCuoi & 0xFFFF) - 1;
+  }
+  t.daCoSoThuTu = true;
+  t.soThuTuCuoi = soThuTu;
+  t.soKhung++;
+  return true;
+}
+
+// Xếp khung unicast cho housekeepingTask gửi tới trạm cân. false nếu hàng đợi đầy.
+bool guiToiTram(const uint8_t* mac, const void* data, size_t len) {
+  khung_gui_tram k;
+  if (len > sizeof(k.duLieu)) return false;
+  memcpy(k.mac, mac, 6);
+  k.doDai = len;
+  memcpy(k.duLieu, data, len);
+  if (xQueueSend(hangDoiGuiTram, &k, 0) == pdTRUE) return true;
+  soLanBoGuiTram++;
+  return false;
+}
+
+// Gửi unicast tới trạm cân: phải tạm thêm trạm làm peer
+// (ESP-NOW giới hạn 20 peer, gateway không giữ peer cho hàng chục trạm). Chỉ housekeepingTask gọi.
+void guiNgayToiTram(const khung_gui_tram& k) {
+  bool daCoPeer = esp_now_is_peer_exist(k.mac);
+  if (!daCoPeer) {
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, k.mac, 6);
+    peer.channel = 0;  // kênh hiện tại
+    peer.encrypt = false;
+    if (esp_now_add_peer(&peer) != ESP_OK) return;
+  }
+  esp_now_send(k.mac, k.duLieu, k.doDai);
+  vTaskDelay(pdMS_TO_TICKS(20));  // chờ khung rời hàng đợi phát trước khi xoá peer
+  if (!daCoPeer) esp_now_del_peer(k.mac);
+}
+
+// Trả lời yêu cầu ghép nối
+void traLoiGhepNoi(const uint8_t* mac, uint8_t loaiCan) {
+  int viTri = timTramCan(mac);
+  if (viTri >= 0) {
+    tramCan[viTri].loaiCan = loaiCan;
+    tramCan[viTri].lanCuoiThay = millis();
+  }
+
+  khung_ghep_noi k = {};
+  k.loaiCan = loaiCan;
+  k.kenh = WiFi.channel();
+  dongGoiKhung(k, KHUNG_GHEP_NOI_OK);
+  if (!guiToiTram(mac, &k, sizeof(k))) return;
+  Serial.printf("Ghép nối trạm cân %s (loại %u)\n", macCua(mac).c_str(), loaiCan);
+}
+
+// Kiểm tra nội dung khung (CRC và độ dài đã kiểm trong callback): loại cân hợp lệ, giá trị không âm
+bool validateReading(const khung_can& m) {
+  return m.loaiCan >= 1 && m.loaiCan <= 3 && m.giaTri >= 0;
+}
+
+// Task nhận: kiểm tra khung, ghi journal rồi chuyển cho task upload
+void ingestTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    ban_tin_nhan tin;
+    while (hangDoiNhan.pop(tin)) {
+      if (tin.data.khung.loaiKhung == KHUNG_GHEP_NOI) {
+        traLoiGhepNoi(tin.data.mac, tin.data.khung.loaiCan);
+        continue;
+      }
+      if (!validateReading(tin.data.khung)) {
+        soKhungKhongHopLe++;
+        Serial.printf("Khung không hợp lệ từ %s\n", macCua(tin.data.mac).c_str());
+        continue;
+      }
+      int tram = timTramCan(tin.data.mac);
+      if (tram >= 0) {
+        if (tramCan[tram].loaiCan == 0) tramCan[tram].loaiCan = tin.data.khung.loaiCan;
+        if (!ghiNhanSoThuTu(tramCan[tram], tin.data.khung.soThuTu)) {
+          soKhungTrung++;
+          continue;
+        }
+      }
+      if (LOG_CHI_TIET) Serial.printf("Nhận: UID %s, khối lượng %.3f, loại cân %u, từ %s#%u\n",
+                    uidCua(tin.data.khung).c_str(), tuPhanNghin(tin.data.khung.giaTri), tin.data.khung.loaiCan,
+                    macCua(tin.data.mac).c_str(), tin.data.khung.soThuTu);
+
+      lan_can_moi moi;
+      moi.data = tin.data;
+      xSemaphoreTake(journalMutex, portMAX_DELAY);
+      bool ok = journal.append(tin.data, &moi.soThuTu);
+      xSemaphoreGive(journalMutex);
+      if (!ok) {
+        soLanGhiJournalLoi++;
+        Serial.println("Ghi journal thất bại, lần cân này sẽ không được gửi lại!");
+        continue;
+      }
+      soKhungDaGhi++;
+      tgNhan.record(micros() - tin.nhanLuc);
+
+      // Hàng đợi đầy thì thôi: bản ghi vẫn nằm trong journal, task upload sẽ tự đọc lại
+      moi.ghiLuc = millis();
+      if (xQueueSend(hangDoiTaiLen, &moi, 0) != pdTRUE) soLanTranHangDoiTaiLen++;
+    }
+  }
+}
+
+void uploadTask(void* thamSo);
+void luongUploadTask(void* thamSo);
+void tenTask(void* thamSo);
+void housekeepingTask(void* thamSo);
+void metricsTask(void* thamSo);
+
 void setup() {
   Serial.begin(9600);  // Changed to standard baud rate
   pinMode(Led, OUTPUT);
   digitalWrite(Led, HIGH);
 
-  WiFi.mode(WIFI_AP_STA);
-  WiFi.begin(SSID, PASS);
-  Serial.print("Đang kết nối WiFi");
-  while (WiFi.status() != WL_CONNECTED) {
-    Serial.print(".");
-    delay(500);
+  journalMutex = xSemaphoreCreateMutex();
+  tramCanMutex = xSemaphoreCreateMutex();
+  bangMutex = xSemaphoreCreateMutex();
+  hangDoiHoiTen = xQueueCreate(16, sizeof(yeu_cau_ten));
+  hangDoiGuiTram = xQueueCreate(8, sizeof(khung_gui_tram));
+  hangDoiTaiLen = xQueueCreate(hangDoiTaiLenMax, sizeof(lan_can_moi));
+
+  if (!LittleFS.begin(true) || !journal.begin()) {
+    Serial.println("Không mở được journal trên flash!");
   }
-  Serial.println();
-  Serial.print("WiFi connected, IP: ");
-  Serial.println(WiFi.localIP());
+  soThuTuDoc = journal.commitSeq();
+  soThuTuXacNhan = soThuTuDoc;
+  for (int i = bangChoMax; i < bangChoMax + bangGiuMax; i++) bangCho[i].trangThai = DA_XONG;
+  Serial.printf("Journal: %u lần cân chưa gửi từ lần chạy trước\n", journal.pendingCount());
 
-  int channel = WiFi.channel();
-  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
-  Serial.print("ESP-NOW set kênh: ");
-  Serial.println(channel);
+  // Không chờ WiFi: ESP-NOW nhận ngay trên kênh đã lưu, khi kết nối xong radio theo kênh của AP
+  // (trạm cân tự dò lại kênh nếu AP đổi kênh). Upload chờ tới khi có WiFi.
+  WiFi.mode(WIFI_AP_STA);
+  if (!ketNoiWiFi.begin()) Serial.println("Không tạo được task WiFi!");
+  configTime(0, 0, "pool.ntp.org");  // ngày UTC để ghép giao dịch theo ngày như server
+  Serial.printf("ESP-NOW kênh đã lưu: %u, metrics: http://<IP>/metrics\n", (unsigned)ketNoiWiFi.channel());
 
   if (esp_now_init() != ESP_OK) {
     Serial.println("ESP-NOW init lỗi!");
     while(true) delay(1000);
   }
 
+  // Giữ nguyên hành vi cũ: không kiểm tra chứng chỉ server
+  for (int i = 0; i < soLuongUpload; i++) {
+    luongUpload[i].tls.setInsecure();
+    luongUpload[i].http.setReuse(true);
+    luongUpload[i].lo = xQueueCreate(1, sizeof(lo_upload));
+  }
+  tenTlsClient.setInsecure();
+  tenHttp.setReuse(true);
+
+  xTaskCreatePinnedToCore(ingestTask, "ingest", 6144, NULL, 3, &ingestTaskHandle, 0);
+  xTaskCreatePinnedToCore(uploadTask, "upload", 6144, NULL, 2, &uploadTaskHandle, 1);
+  for (int i = 0; i < soLuongUpload; i++) {
+    char ten[12];
+    snprintf(ten, sizeof(ten), "upload%d", i);
+    xTaskCreatePinnedToCore(luongUploadTask, ten, 16384, &luongUpload[i], 2, NULL, 1);
+  }
+  xTaskCreatePinnedToCore(tenTask, "ten", 12288, NULL, 1, NULL, 1);
+  xTaskCreatePinnedToCore(housekeepingTask, "housekeeping", 4096, NULL, 1, NULL, 1);
+  xTaskCreatePinnedToCore(metricsTask, "metrics", 6144, NULL, 1, NULL, 1);
+
   esp_now_register_recv_cb(onDataRecv);
   Serial.println("ESP-NOW khởi tạo thành công!");
 }
 
-int sendWithRetry(HTTPClient& http, const String& payload, const String& method, int maxRetries = 3) {
-  int httpResponseCode = -1;
-  int retryCount = 0;
+// Chuyển một lần cân sang phần tử JSON của lô
+bool addBatchItem(JsonArray danhSach, const lan_can& lanCan) {
+  const khung_can& incoming = lanCan.khung;
+  if (incoming.loaiCan < 1 || incoming.loaiCan > 3) {
+    Serial.println("Loại cân không hợp lệ: " + String(incoming.loaiCan));
+    return false;
+  }
+
+  JsonObject item = danhSach.add<JsonObject>();
+  item["LoaiCan"] = incoming.loaiCan;
+  item["RFID"] = uidCua(incoming);
+  item["MaCan"] = macCua(lanCan.mac);
+  item["SoThuTu"] = incoming.soThuTu;
+
+  float giaTri = tuPhanNghin(incoming.giaTri);
+  if (incoming.loaiCan == 1) {
+    item["KhoiLuongMuTap"] = giaTri;
+  } else if (incoming.loaiCan == 2) {
+    item["KhoiLuongMuNuoc"] = giaTri;
+  } else {
+    item["TSC"] = giaTri;
+    item["DRC"] = giaTri * 0.9;
+  }
+  return true;
+}
+
+// Lùi thời điểm gửi của một lần cân: base * 2^(n-1), tối đa backoffMax, jitter trong nửa sau khoảng chờ
+void henLai(lan_can_cho& c) {
+  c.trangThai = CHO_GUI;
+  if (c.soLanThu < 255) c.soLanThu++;
+  unsigned long cho = backoffBase << (c.soLanThu - 1 < 6 ? c.soLanThu - 1 : 6);
+  if (cho > backoffMax) cho = backoffMax;
+  cho = cho / 2 + esp_random() % (cho / 2 + 1);
+  c.thoiDiemGui = millis() + cho;
+  soLanHenLai++;
+  if (LOG_CHI_TIET) Serial.printf("  %s loại %u: thử lại lần %u sau %lu ms\n", uidCua(c.data.khung).c_str(), c.data.khung.loaiCan, c.soLanThu, cho);
+}
+
+// Đánh dấu một lần cân đã xong và ghi nhận thời gian từ lúc nhận tới lúc server xác nhận
+void daXong(lan_can_cho& c) {
+  c.trangThai = DA_XONG;
+  if (c.tram >= 0) {
+    tramCan[c.tram].soDaXacNhan++;
+    tramCan[c.tram].soDangCho--;
+  }
+  if (c.ghiLuc) tgToanBo.record(millis() - c.ghiLuc);
+}
+
+// daXong/henLai cho một phần tử của lô: lần cân tại viTri cùng các lần cân đã ghép vào nó
+void daXongNhom(int viTri) {
+  lan_can_cho& c = bangCho[viTri];
+  for (int i = 0; i < 2; i++) {
+    if (c.ghep[i] >= 0) daXong(bangCho[c.ghep[i]]);
+  }
+  daXong(c);
+}
 
-  while (retryCount < maxRetries) {
-    if (method == "POST") {
-      httpResponseCode = http.POST(payload);
-    } else if (method == "PUT") {
-      httpResponseCode = http.PUT(payload);
+void henLaiNhom(int viTri) {
+  lan_can_cho& c = bangCho[viTri];
+  for (int i = 0; i < 2; i++) {
+    if (c.ghep[i] >= 0) henLai(bangCho[c.ghep[i]]);
+  }
+  henLai(c);
+}
+
+// Server từ chối cả lô: gửi lại ngay, mỗi request một phần tử (không tính là lần thử lại)
+void tachKhoiLo(int viTri) {
+  lan_can_cho& c = bangCho[viTri];
+  for (int i = 0; i < 2; i++) {
+    if (c.ghep[i] >= 0) bangCho[c.ghep[i]].trangThai = CHO_GUI;
+  }
+  c.trangThai = CHO_GUI;
+  c.guiRieng = true;
+  c.thoiDiemGui = millis();
+}
+
+// Cập nhật trạng thái từng lần cân theo phản hồi của server.
+// Lỗi kết nối hoặc 5xx: hẹn gửi lại; 2xx/4xx của từng phần tử: xong (4xx là dữ liệu sai, gửi lại cũng
+// vô ích). 4xx cho cả request chưa cho biết phần tử nào sai: lô nhiều phần tử thì tách ra gửi riêng,
+// chỉ bỏ phần tử bị từ chối khi gửi một mình.
+void handleBatchResponse(int httpResponseCode, const String& response, const int chon[], int soChon) {
+  demMaHttp(maHttp, httpResponseCode);
+  if (httpResponseCode <= 0 || httpResponseCode >= 500) {
+    Serial.println("Error on sending request: " + String(httpResponseCode));
+    for (int i = 0; i < soChon; i++) henLaiNhom(chon[i]);
+    return;
+  }
+
+  if (httpResponseCode != 200) {
+    Serial.println("HTTP Response code: " + String(httpResponseCode) + ", response: " + response);
+    if (soChon > 1) {
+      soLanTachLo++;
+      for (int i = 0; i < soChon; i++) tachKhoiLo(chon[i]);
+      return;
+    }
+    lan_can_cho& c = bangCho[chon[0]];
+    if (c.ghep[0] >= 0) {
+      // Bản ghép gửi một mình vẫn bị từ chối: 422 là server chưa hỗ trợ LoaiCan 0 (tắt ghép),
+      // lỗi khác thì gửi lại từng phần để các phần hợp lệ vẫn được ghi
+      if (httpResponseCode == 422) {
+        Serial.println("Server không nhận giao dịch ghép (LoaiCan 0), chuyển về gửi từng phần");
+        choPhepGhep = false;
+      }
+      c.khongGhep = true;
+      tachKhoiLo(chon[0]);
+      return;
+    }
+    soLanCanBiTuChoi++;
+    daXongNhom(chon[0]);
+    return;
+  }
+
+  JsonDocument resp;
+  if (deserializeJson(resp, response)) {
+    Serial.println("Không đọc được phản hồi lô: " + response);
+    for (int i = 0; i < soChon; i++) henLaiNhom(chon[i]);
+    return;
+  }
+
+  bool coKetQua[batchMax] = { false };
+  for (JsonObject kq : resp["KetQua"].as<JsonArray>()) {
+    int viTri = kq["ViTri"] | -1;
+    int trangThai = kq["TrangThai"] | 0;
+    if (viTri < 0 || viTri >= soChon) continue;
+    coKetQua[viTri] = true;
+    demMaHttp(maKetQua, trangThai);
+    lan_can_cho& c = bangCho[chon[viTri]];
+    bool daGhep = c.ghep[0] >= 0;
+    if (trangThai >= 200 && trangThai < 300) {
+      if (LOG_CHI_TIET) Serial.printf("  [%d] %s loại %u: OK (ID %d)\n", viTri, uidCua(c.data.khung).c_str(), daGhep ? 0 : c.data.khung.loaiCan, kq["IDGiaoDich"] | 0);
+      if (daGhep) soGiaoDichDaGhep++;
+      daXongNhom(chon[viTri]);
     } else {
-      Serial.println("Unsupported HTTP method: " + method);
-      return -1;
+      Serial.printf("  [%d] %s loại %u: lỗi %d %s\n", viTri, uidCua(c.data.khung).c_str(), daGhep ? 0 : c.data.khung.loaiCan, trangThai,
+                    kq["ChiTiet"] | "");
+      if (trangThai >= 500) {
+        henLaiNhom(chon[viTri]);
+      } else if (daGhep && trangThai == 422) {
+        // Một phần không hợp lệ: gửi lại từng phần để các phần còn lại vẫn được ghi
+        c.khongGhep = true;
+        henLaiNhom(chon[viTri]);
+      } else {
+        soLanCanBiTuChoi++;
+        daXongNhom(chon[viTri]);
+      }
     }
+  }
+  for (int i = 0; i < soChon; i++) {
+    if (!coKetQua[i]) henLaiNhom(chon[i]);
+  }
+}
 
-    if (httpResponseCode > 0) {
-      break; // Thành công
+// Giao dịch đủ ba phần đã ghép: một phần tử LoaiCan 0. MaCan/SoThuTu là khoá của lần cân mủ tạp,
+// CacPhan mang khoá chống trùng của cả ba lần cân để server ghi nhận từng lần cân đã áp dụng.
+void addGroupItem(JsonArray danhSach, const lan_can_cho& c) {
+  const lan_can* phan[3] = { &c.data, &bangCho[c.ghep[0]].data, &bangCho[c.ghep[1]].data };
+  JsonObject item = danhSach.add<JsonObject>();
+  item["LoaiCan"] = 0;
+  item["RFID"] = uidCua(c.data.khung);
+  item["MaCan"] = macCua(c.data.mac);
+  item["SoThuTu"] = c.data.khung.soThuTu;
+  item["KhoiLuongMuTap"] = tuPhanNghin(phan[0]->khung.giaTri);
+  item["KhoiLuongMuNuoc"] = tuPhanNghin(phan[1]->khung.giaTri);
+  float tsc = tuPhanNghin(phan[2]->khung.giaTri);
+  item["TSC"] = tsc;
+  item["DRC"] = tsc * 0.9;
+
+  JsonArray cacPhan = item["CacPhan"].to<JsonArray>();
+  for (const lan_can* p : phan) {
+    JsonObject khoa = cacPhan.add<JsonObject>();
+    khoa["LoaiCan"] = p->khung.loaiCan;
+    khoa["MaCan"] = macCua(p->mac);
+    khoa["SoThuTu"] = p->khung.soThuTu;
+  }
+}
+
+// Gửi các lần cân đã chọn trong một request trên kết nối của luồng (chỉ thử một lần, không chặn
+// để chờ thử lại). Chạy trong task của luồng, chỉ giữ bangMutex khi đọc/ghi bảng chờ.
+void sendBatch(luong_upload& l, const int chonTuBang[], int soTuBang) {
+  JsonDocument doc;
+  JsonArray danhSach = doc["DanhSach"].to<JsonArray>();
+  int chon[batchMax];  // vị trí trong request -> vị trí trong bangCho
+  int soPhanTu = 0;
+
+  xSemaphoreTake(bangMutex, portMAX_DELAY);
+  for (int i = 0; i < soTuBang; i++) {
+    lan_can_cho& c = bangCho[chonTuBang[i]];
+    if (c.ghep[0] >= 0) {
+      addGroupItem(danhSach, c);
+      chon[soPhanTu++] = chonTuBang[i];
+      if (c.soLanThu == 0 && c.ghiLuc) tgCho.record(millis() - c.ghiLuc);
+    } else if (addBatchItem(danhSach, c.data)) {
+      chon[soPhanTu++] = chonTuBang[i];
+      if (c.soLanThu == 0 && c.ghiLuc) tgCho.record(millis() - c.ghiLuc);
+    } else {
+      daXong(c);
     }
+  }
+  xSemaphoreGive(bangMutex);
+  if (soPhanTu == 0) return;
 
-    Serial.println("Request failed (code " + String(httpResponseCode) + "), retrying (" + String(retryCount + 1) + "/" + String(maxRetries) + ")");
-    retryCount++;
-    delay(1000); // delay giữa các lần thử
+  String requestBody;
+  serializeJson(doc, requestBody);
+  if (LOG_CHI_TIET) {
+    Serial.printf("Sending POST (%d readings) to %s\n", soPhanTu, batchUrl);
+    Serial.println("Request body: " + requestBody);
   }
 
-  return httpResponseCode;
+  // Kết nối chưa mở hoặc đã bị server đóng thì request này sẽ phải bắt tay TLS
+  bool batTay = !l.tls.connected();
+  unsigned long batDau = millis();
+
+  l.http.begin(l.tls, batchUrl);
+  l.http.addHeader("Content-Type", "application/json");
+  int httpResponseCode = l.http.POST(requestBody);
+  String response = httpResponseCode > 0 ? l.http.getString() : String();
+  unsigned long thoiGian = millis() - batDau;
+  l.http.end();  // setReuse(true): giữ kết nối mở cho lần sau
+
+  xSemaphoreTake(bangMutex, portMAX_DELAY);
+  handleBatchResponse(httpResponseCode, response, chon, soPhanTu);
+  l.soRequest++;
+  soRequest++;
+  if (batTay) soLanBatTay++;
+  soLanCanDaGui += soPhanTu;
+  tongThoiGianUpload += thoiGian;
+  tgHttp.record(thoiGian);
+  xSemaphoreGive(bangMutex);
+  if (LOG_CHI_TIET) Serial.printf("Upload %d lần cân: %lu ms (%lu ms/lần cân, %s)\n", soPhanTu, thoiGian,
+                thoiGian / soPhanTu, batTay ? "bắt tay TLS" : "dùng lại kết nối");
 }
 
+// Luồng upload của RFID (FNV-1a trên UID): cùng thẻ luôn cùng luồng
+uint8_t luongCua(const khung_can& k) {
+  uint32_t bam = 2166136261UL;
+  for (uint8_t i = 0; i < k.doDaiUid; i++) bam = (bam ^ k.uid[i]) * 16777619UL;
+  return bam % soLuongUpload;
+}
 
-void handleResponse(int httpResponseCode, HTTPClient& http) {
-  if (httpResponseCode > 0) {
-    String response = http.getString();
-    Serial.println("HTTP Response code: " + String(httpResponseCode));
-    Serial.println("Response: " + response);
-  } else {
-    Serial.println("Error on sending request: " + String(httpResponseCode));
+// Ngày UTC (số ngày từ 1970) theo giờ SNTP, 0 khi chưa đồng bộ giờ
+uint16_t ngayHienTai() {
+  time_t bayGio = time(nullptr);
+  return bayGio > 1600000000 ? bayGio / 86400 : 0;
+}
+
+void addToPendingTable(const lan_can& data, uint32_t soThuTu, uint32_t ghiLuc) {
+  lan_can_cho& c = bangCho[(dauBang + soTrongBang++) % bangChoMax];
+  c.data = data;
+  c.soThuTu = soThuTu;
+  c.trangThai = CHO_GUI;
+  c.soLanThu = 0;
+  c.thoiDiemGui = millis();
+  c.ghiLuc = ghiLuc;
+  c.tram = timTramCan(data.mac);
+  if (c.tram >= 0) tramCan[c.tram].soDangCho++;
+  c.luong = luongCua(data.khung);
+  c.ngay = ngayHienTai();
+  c.khongGhep = false;
+  c.guiRieng = false;
+  c.ghep[0] = c.ghep[1] = -1;
+}
+
+// Đưa lần cân mới vào bảng chờ: lấy thẳng từ hangDoiTaiLen nếu liền mạch với soThuTuDoc,
+// còn không (khởi động lại, hàng đợi từng bị tràn) thì đọc bù từ journal.
+void fillPendingTable() {
+  while (soTrongBang < bangChoMax) {
+    lan_can_moi moi;
+    bool coMoi = xQueuePeek(hangDoiTaiLen, &moi, 0) == pdTRUE;
+    if (coMoi && moi.soThuTu < soThuTuDoc) {
+      xQueueReceive(hangDoiTaiLen, &moi, 0);  // đã đọc bù từ journal rồi
+      continue;
+    }
+    if (coMoi && moi.soThuTu == soThuTuDoc) {
+      xQueueReceive(hangDoiTaiLen, &moi, 0);
+      addToPendingTable(moi.data, soThuTuDoc++, moi.ghiLuc);
+      continue;
+    }
+
+    // Đọc bù từ journal, tối đa tới bản ghi đang chờ trong hàng đợi
+    lan_can tam[batchMax];
+    uint32_t toiDa = bangChoMax - soTrongBang < batchMax ? bangChoMax - soTrongBang : batchMax;
+    if (coMoi && moi.soThuTu - soThuTuDoc < toiDa) toiDa = moi.soThuTu - soThuTuDoc;
+    xSemaphoreTake(journalMutex, portMAX_DELAY);
+    size_t n = journal.read(soThuTuDoc, tam, toiDa);
+    xSemaphoreGive(journalMutex);
+    if (n == 0) break;
+    uint32_t batDau = soThuTuDoc - n;
+    for (size_t i = 0; i < n; i++) addToPendingTable(tam[i], batDau + i, 0);
   }
 }
 
-void sendHttpRequest() {
-  HTTPClient http;
+// Lần cân đến hạn gửi (trong vòng chờ hoặc ô giữ): nếu là mủ tạp, tìm lần cân mủ nước và TSC kế sau
+// của cùng RFID trong cùng ngày (dừng ở lần mủ tạp kế tiếp: giao dịch mới) và ghi vào c.ghep.
+// false nếu nên giữ lại chờ phần còn thiếu; hết hạn thì từ đó gửi từng phần.
+bool ghepGiaoDich(lan_can_cho& c) {
+  c.ghep[0] = c.ghep[1] = -1;
+  if (!choPhepGhep || c.khongGhep || c.data.khung.loaiCan != 1) return true;
+
+  for (int j = 0; j < soTrongBang; j++) {
+    int viTri = (dauBang + j) % bangChoMax;
+    const lan_can_cho& p = bangCho[viTri];
+    if (p.soThuTu <= c.soThuTu || p.trangThai != CHO_GUI || !cungUid(p.data.khung, c.data.khung)) continue;
+    uint8_t loai = p.data.khung.loaiCan;
+    if (loai == 1) break;
+    bool cungNgay = c.ngay == 0 || p.ngay == 0 || c.ngay == p.ngay;
+    if ((loai == 2 || loai == 3) && c.ghep[loai - 2] < 0 && cungNgay) c.ghep[loai - 2] = viTri;
+  }
+  if (c.ghep[0] >= 0 && c.ghep[1] >= 0) return true;
+
+  c.ghep[0] = c.ghep[1] = -1;
+  if (!c.ghiLuc) return true;
+  if (millis() - c.ghiLuc < ghepTimeout) return false;
+  c.khongGhep = true;
+  soLanGhepHetHan++;
+  return true;
+}
+
+// Ô giữ trống, -1 nếu hết
+int oGiuTrong() {
+  for (int i = bangChoMax; i < bangChoMax + bangGiuMax; i++) {
+    if (bangCho[i].trangThai == DA_XONG) return i;
+  }
+  return -1;
+}
+
+// Chọn tối đa batchMax lần cân đến hạn gửi của một luồng, cập nhật độ sâu của luồng.
+// Trả về 0 nếu nên chờ gom thêm. Khi tồn đọng nhiều hơn một lô, chia đều chỗ trong lô cho
+// các trạm cân đang có hàng để một trạm gửi dồn không làm các trạm khác chờ theo.
+int selectBatch(int luong, int chon[]) {
+  const khung_can* uidDangCho[bangChoMax + bangGiuMax];
+  int soUidDangCho = 0;
+  int duDieuKien[bangChoMax + bangGiuMax];
+  int soDuDieuKien = 0;
+  unsigned long now = millis();
+  unsigned long somNhat = now;
+  uint32_t soDangGhep = 0;
+
+  // Mủ tạp đang giữ đứng trước mọi lần cân còn trong vòng chờ của cùng RFID
+  for (int viTri = bangChoMax; viTri < bangChoMax + bangGiuMax; viTri++) {
+    lan_can_cho& c = bangCho[viTri];
+    if (c.trangThai == DA_XONG || c.luong != luong) continue;
+    uidDangCho[soUidDangCho++] = &c.data.khung;
+    if (c.trangThai == DANG_GUI || (long)(now - c.thoiDiemGui) < 0) continue;
+    if (!ghepGiaoDich(c)) {
+      soDangGhep++;
+      continue;
+    }
+    duDieuKien[soDuDieuKien++] = viTri;
+    if ((long)(c.thoiDiemGui - somNhat) < 0) somNhat = c.thoiDiemGui;
+  }
+
+  for (int k = 0; k < soTrongBang; k++) {
+    int viTri = (dauBang + k) % bangChoMax;
+    lan_can_cho& c = bangCho[viTri];
+    if (c.trangThai == DA_XONG || c.luong != luong) continue;
+
+    // Còn lần cân trước đó của cùng RFID chưa xong (kể cả đang gửi) thì phải chờ
+    bool biChan = false;
+    for (int j = 0; j < soUidDangCho && !biChan; j++) {
+      biChan = cungUid(*uidDangCho[j], c.data.khung);
+    }
+    uidDangCho[soUidDangCho++] = &c.data.khung;
+    if (biChan || c.trangThai == DANG_GUI || (long)(now - c.thoiDiemGui) < 0) continue;
+    if (!ghepGiaoDich(c)) {
+      // Chuyển sang ô giữ: ô trong vòng coi như xong, journal vẫn giữ lần cân này (xem commitFinished)
+      int giu = oGiuTrong();
+      if (giu >= 0) {
+        bangCho[giu] = c;
+        c.trangThai = DA_XONG;
+        soDangGhep++;
+        continue;
+      }
+      c.khongGhep = true;
+      soLanGhepHetO++;
+    }
+
+    duDieuKien[soDuDieuKien++] = viTri;
+    if ((long)(c.thoiDiemGui - somNhat) < 0) somNhat = c.thoiDiemGui;
+  }
+  luongUpload[luong].doSau = soUidDangCho;
+  luongUpload[luong].soDangGhep = soDangGhep;
+
+  // Lần cân tách khỏi lô bị từ chối: gửi một mình, không chờ gom
+  for (int i = 0; i < soDuDieuKien; i++) {
+    if (bangCho[duDieuKien[i]].guiRieng) {
+      chon[0] = duDieuKien[i];
+      return 1;
+    }
+  }
+
+  if (soDuDieuKien < batchMax && now - somNhat < batchWindow) return 0;
+  if (soDuDieuKien <= batchMax) {
+    memcpy(chon, duDieuKien, soDuDieuKien * sizeof(int));
+    return soDuDieuKien;
+  }
+
+  // Lượt 1: mỗi trạm tối đa "phan" lần cân; lượt 2: lấp chỗ còn lại theo thứ tự journal
+  uint8_t soCuaTram[tramCanMax + 1] = { 0 };  // ô cuối cho lần cân không có trong bảng trạm
+  int soTramCoHang = 0;
+  for (int i = 0; i < soDuDieuKien; i++) {
+    int tram = bangCho[duDieuKien[i]].tram;
+    uint8_t& dem = soCuaTram[tram >= 0 ? tram : tramCanMax];
+    if (dem == 0) soTramCoHang++;
+    dem = 1;
+  }
+  int phan = batchMax / soTramCoHang > 0 ? batchMax / soTramCoHang : 1;
+
+  memset(soCuaTram, 0, sizeof(soCuaTram));
+  bool daChon[bangChoMax + bangGiuMax] = { false };
+  int soChon = 0;
+  for (int i = 0; i < soDuDieuKien && soChon < batchMax; i++) {
+    int tram = bangCho[duDieuKien[i]].tram;
+    uint8_t& dem = soCuaTram[tram >= 0 ? tram : tramCanMax];
+    if (dem < phan) {
+      dem++;
+      daChon[i] = true;
+      soChon++;
+    }
+  }
+  for (int i = 0; i < soDuDieuKien && soChon < batchMax; i++) {
+    if (!daChon[i]) {
+      daChon[i] = true;
+      soChon++;
+    }
+  }
+
+  soChon = 0;
+  for (int i = 0; i < soDuDieuKien; i++) {
+    if (daChon[i]) chon[soChon++] = duDieuKien[i];
+  }
+  return soChon;
+}
+
+// Bỏ các lần cân đã xong ở đầu vòng chờ và xác nhận journal tới lần cân đầu tiên chưa xong:
+// đầu vòng chờ, hoặc lần cân mủ tạp đang giữ nếu cũ hơn
+void commitFinished() {
+  while (soTrongBang > 0 && bangCho[dauBang].trangThai == DA_XONG) {
+    dauBang = (dauBang + 1) % bangChoMax;
+    soTrongBang--;
+  }
+  uint32_t soThuTuKeTiep = soTrongBang > 0 ? bangCho[dauBang].soThuTu : soThuTuDoc;
+  for (int i = bangChoMax; i < bangChoMax + bangGiuMax; i++) {
+    if (bangCho[i].trangThai != DA_XONG && bangCho[i].soThuTu < soThuTuKeTiep) soThuTuKeTiep = bangCho[i].soThuTu;
+  }
+  if (soThuTuKeTiep <= soThuTuXacNhan) return;
+
+  xSemaphoreTake(journalMutex, portMAX_DELAY);
+  journal.commit(soThuTuKeTiep);
+  xSemaphoreGive(journalMutex);
+  soThuTuXacNhan = soThuTuKeTiep;
+}
+
+int soOGiuDangDung() {
+  int n = 0;
+  for (int i = bangChoMax; i < bangChoMax + bangGiuMax; i++) n += bangCho[i].trangThai != DA_XONG;
+  return n;
+}
+
+// Task upload: đưa lần cân mới vào bảng chờ, xác nhận journal và giao lô cho các luồng đang rảnh
+void uploadTask(void*) {
+  lo_upload lo;
+  for (;;) {
+    // Mất WiFi: không giao lô để khỏi tốn lần thử và backoff, lần cân vẫn nằm trong journal
+    bool coWiFi = ketNoiWiFi.connected();
+    xSemaphoreTake(bangMutex, portMAX_DELAY);
+    fillPendingTable();
+    commitFinished();
+    for (int i = 0; i < soLuongUpload; i++) {
+      luong_upload& l = luongUpload[i];
+      lo.soChon = selectBatch(i, lo.chon);
+      if (!coWiFi || l.dangGui || lo.soChon == 0) continue;
+      for (int j = 0; j < lo.soChon; j++) {
+        lan_can_cho& c = bangCho[lo.chon[j]];
+        c.trangThai = DANG_GUI;
+        for (int g = 0; g < 2; g++) {
+          if (c.ghep[g] >= 0) bangCho[c.ghep[g]].trangThai = DANG_GUI;
+        }
+      }
+      l.dangGui = true;
+      l.soDangGui = lo.soChon;
+      xQueueSend(l.lo, &lo, 0);
+    }
+    xSemaphoreGive(bangMutex);
+
+    // Ngủ tới khi một luồng gửi xong hoặc hết 50 ms (lần cân mới vẫn chờ gom tới batchWindow)
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(coWiFi ? 50 : 200));
+  }
+}
+
+// Task của một luồng upload: gửi lô được giao rồi báo uploadTask
+void luongUploadTask(void* thamSo) {
+  luong_upload& l = *static_cast<luong_upload*>(thamSo);
+  lo_upload lo;
+  for (;;) {
+    xQueueReceive(l.lo, &lo, portMAX_DELAY);
+    sendBatch(l, lo.chon, lo.soChon);
+    l.soDangGui = 0;
+    l.dangGui = false;
+    xTaskNotifyGive(uploadTaskHandle);
+  }
+}
+
+// Vị trí của thẻ trong bangTen, -1 nếu chưa có
+int timTen(const khung_ten& k) {
+  for (int i = 0; i < bangTenMax; i++) {
+    if (bangTen[i].doDaiUid == k.doDaiUid && memcmp(bangTen[i].uid, k.uid, k.doDaiUid) == 0) return i;
+  }
+  return -1;
+}
+
+// Hỏi server tên của thẻ và ghi vào bangTen; false nếu lỗi kết nối/server (không ghi gì)
+bool layTenTuServer(const khung_ten& k, int& viTri) {
+  char rfid[21];
+  uidToHex(k.uid, k.doDaiUid, rfid);
+  unsigned long batDau = millis();
+  tenHttp.begin(tenTlsClient, String(khachHangUrl) + rfid);
+  int ma = tenHttp.GET();
+  String noiDung = ma == 200 ? tenHttp.getString() : String();
+  tenHttp.end();
+  tgTen.record(millis() - batDau);
+
   JsonDocument doc;
-  String requestBody, method, url;
+  if ((ma != 200 && ma != 404) || (ma == 200 && deserializeJson(doc, noiDung))) {
+    soLanLayTenLoi++;
+    Serial.printf("Không lấy được tên khách hàng %s: %d\n", rfid, ma);
+    return false;
+  }
 
-  http.addHeader("Content-Type", "application/json");
+  if (viTri < 0) {
+    // Ô trống hoặc ô lấy lâu nhất
+    viTri = 0;
+    for (int i = 0; i < bangTenMax; i++) {
+      if (bangTen[i].doDaiUid == 0) {
+        viTri = i;
+        break;
+      }
+      if ((long)(bangTen[i].layLuc - bangTen[viTri].layLuc) < 0) viTri = i;
+    }
+  }
+  ten_khach_hang& t = bangTen[viTri];
+  t.doDaiUid = k.doDaiUid;
+  memcpy(t.uid, k.uid, k.doDaiUid);
+  t.coTen = ma == 200;
+  strlcpy(t.ten, ma == 200 ? (doc["TenHienThi"] | "") : "", sizeof(t.ten));
+  t.layLuc = millis();
+  return true;
+}
 
-  if (incoming.loaiCan == 1) {
-    url = muTapUrl;
-    method = "POST";
-    doc["RFID"] = String(incoming.uidStr);
-    doc["KhoiLuongMuTap"] = atof(incoming.khoiLuong);
-
-  } else if (incoming.loaiCan == 3) {
-    url = tscDrcUrl;
-    method = "PUT";
-    doc["RFID"] = String(incoming.uidStr);
-    doc["TSC"] = atof(incoming.khoiLuong);
-    doc["DRC"] = atof(incoming.khoiLuong) * 0.9;
+// Task trả lời tên khách hàng cho trạm cân: dùng bangTen nếu còn hạn, không thì hỏi server.
+// Server lỗi thì dùng tên cũ (nếu có), không có gì để trả thì bỏ qua: trạm cân hỏi lại lần chạm sau.
+void tenTask(void*) {
+  yeu_cau_ten yc;
+  for (;;) {
+    if (xQueueReceive(hangDoiHoiTen, &yc, portMAX_DELAY) != pdTRUE) continue;
+    soLanHoiTen++;
 
-  } else if (incoming.loaiCan == 2) {
-    url = muNuocUrl;
-    method = "PUT";
-    doc["RFID"] = String(incoming.uidStr);
-    doc["KhoiLuongMuNuoc"] = atof(incoming.khoiLuong);
+    int viTri = timTen(yc.khung);
+    if (viTri >= 0 && millis() - bangTen[viTri].layLuc < tenTtl) {
+      soLanTenCoSan++;
+    } else if (!layTenTuServer(yc.khung, viTri) && viTri < 0) {
+      continue;
+    }
 
-  } else {
-    Serial.println("Loại cân không hợp lệ: " + String(incoming.loaiCan));
-    return;
+    khung_ten k = yc.khung;
+    k.coTen = bangTen[viTri].coTen;
+    strlcpy(k.ten, bangTen[viTri].ten, sizeof(k.ten));
+    dongGoiKhung(k, KHUNG_TEN);
+    guiToiTram(yc.mac, &k, sizeof(k));
+    if (LOG_CHI_TIET) Serial.printf("Tên cho %s: %s\n", macCua(yc.mac).c_str(), k.coTen ? k.ten : "(không có)");
   }
+}
 
-  serializeJson(doc, requestBody);
-  Serial.println("Sending " + method + " to " + url);
-  Serial.println("Request body: " + requestBody);
+// Bản tóm tắt một dòng mỗi statsInterval: nhận / upload / chờ / độ trễ nhận -> xác nhận
+void printStats() {
+  xSemaphoreTake(journalMutex, portMAX_DELAY);
+  uint32_t dangCho = journal.pendingCount();
+  xSemaphoreGive(journalMutex);
+  Serial.printf("[stats] rx %u trùng %u hỏng %u rớt %u | up %u req (2xx %u 4xx %u 5xx %u lỗi %u) hẹn lại %u từ chối %u"
+                " | chờ %u | trạm %d | e2e p50 %lu p95 %lu max %lu ms\n",
+                soKhungDaGhi, soKhungTrung, soKhungHong + soKhungKhongHopLe,
+                hangDoiNhan.dropped() + soLanTranHangDoiTaiLen + soLanGhiJournalLoi,
+                soRequest, maHttp[2], maHttp[4], maHttp[5], maHttp[0], soLanHenLai, soLanCanBiTuChoi,
+                dangCho, (int)soTramCan, (unsigned long)tgToanBo.percentile(50), (unsigned long)tgToanBo.percentile(95),
+                (unsigned long)tgToanBo.max());
+}
 
-  http.begin(url);
-  int httpResponseCode = sendWithRetry(http, requestBody, method);
-  handleResponse(httpResponseCode, http);
-  http.end();
+void metricDong(String& ra, const char* ten, uint32_t giaTri) {
+  ra += ten;
+  ra += ' ';
+  ra += giaTri;
+  ra += '\n';
 }
 
+void metricHistogram(String& ra, const char* ten, const Log2Histogram& h) {
+  char dong[96];
+  uint32_t tichLuy = 0;
+  for (int i = 0; i < Log2Histogram::kSoBucket; i++) {
+    tichLuy += h.bucketCount(i);
+    if (i < Log2Histogram::kSoBucket - 1) {
+      snprintf(dong, sizeof(dong), "%s_bucket{le=\"%lu\"} %u\n", ten, (unsigned long)Log2Histogram::bucketUpper(i) - 1, tichLuy);
+    } else {
+      snprintf(dong, sizeof(dong), "%s_bucket{le=\"+Inf\"} %u\n", ten, tichLuy);
+    }
+    ra += dong;
+  }
+  snprintf(dong, sizeof(dong), "%s_sum %llu\n%s_count %u\n%s_max %u\n", ten, (unsigned long long)h.sum(),
+           ten, h.count(), ten, h.max());
+  ra += dong;
+}
 
-void loop() {
-  unsigned long currentMillis = millis();
-  if (dataReceived) {
-    Serial.println("Processing received data...");
-    sendHttpRequest();
-    dataReceived = false;
-    Serial.println("Waiting for next ESP-NOW message...");
+void metricMaHttp(String& ra, const char* ten, const uint32_t (&bang)[6]) {
+  static const char* nhom[6] = { "error", "1xx", "2xx", "3xx", "4xx", "5xx" };
+  char dong[80];
+  for (int i = 0; i < 6; i++) {
+    snprintf(dong, sizeof(dong), "%s{code=\"%s\"} %u\n", ten, nhom[i], bang[i]);
+    ra += dong;
+  }
+}
+
+// Số liệu từng trạm cân, nhãn mac và loai
+void metricTramCan(String& ra) {
+  char dong[128];
+  int n = soTramCan;
+  for (int i = 0; i < n; i++) {
+    const tram_can& t = tramCan[i];
+    String nhan = "{mac=\"" + macCua(t.mac) + "\",loai=\"" + String(t.loaiCan) + "\"}";
+    snprintf(dong, sizeof(dong), "gateway_peer_frames_total%s %u\n", nhan.c_str(), t.soKhung);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_peer_duplicates_total%s %u\n", nhan.c_str(), t.soTrung);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_peer_seq_gaps_total%s %u\n", nhan.c_str(), t.soMat);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_peer_acked_total%s %u\n", nhan.c_str(), t.soDaXacNhan);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_peer_pending%s %u\n", nhan.c_str(), t.soDangCho);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_peer_last_seen_seconds%s %lu\n", nhan.c_str(),
+             t.lanCuoiThay ? (millis() - t.lanCuoiThay) / 1000 : 0UL);
+    ra += dong;
   }
-  delay(100); // Small delay to prevent busy waiting
+}
+
+// Số liệu từng luồng upload, nhãn lane
+void metricLuongUpload(String& ra) {
+  char dong[96];
+  for (int i = 0; i < soLuongUpload; i++) {
+    const luong_upload& l = luongUpload[i];
+    snprintf(dong, sizeof(dong), "gateway_upload_lane_queue_depth{lane=\"%d\"} %u\n", i, l.doSau);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_upload_lane_inflight{lane=\"%d\"} %u\n", i, l.soDangGui);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_upload_lane_requests_total{lane=\"%d\"} %u\n", i, l.soRequest);
+    ra += dong;
+    snprintf(dong, sizeof(dong), "gateway_upload_lane_assembling{lane=\"%d\"} %u\n", i, l.soDangGhep);
+    ra += dong;
+  }
+}
+
+// GET /metrics
+void handleMetrics() {
+  String ra;
+  ra.reserve(4096);
+  metricDong(ra, "gateway_uptime_seconds", millis() / 1000);
+  metricDong(ra, "gateway_rx_frames_total", soKhungDaGhi);
+  metricDong(ra, "gateway_rx_duplicate_total", soKhungTrung);
+  metricDong(ra, "gateway_rx_corrupt_total", soKhungHong);
+  metricDong(ra, "gateway_rx_invalid_total", soKhungKhongHopLe);
+  metricDong(ra, "gateway_rx_ring_dropped_total", hangDoiNhan.dropped());
+  metricDong(ra, "gateway_rx_ring_depth", hangDoiNhan.size());
+  metricDong(ra, "gateway_rx_ring_high_water", hangDoiNhan.highWater());
+  metricDong(ra, "gateway_upload_queue_depth", uxQueueMessagesWaiting(hangDoiTaiLen));
+  metricDong(ra, "gateway_upload_queue_overflow_total", soLanTranHangDoiTaiLen);
+  metricDong(ra, "gateway_pending_table_depth", soTrongBang);
+  metricLuongUpload(ra);
+  metricDong(ra, "gateway_assembly_enabled", choPhepGhep);
+  metricDong(ra, "gateway_assembled_transactions_total", soGiaoDichDaGhep);
+  metricDong(ra, "gateway_assembly_timeouts_total", soLanGhepHetHan);
+  metricDong(ra, "gateway_assembly_hold_full_total", soLanGhepHetO);
+  metricDong(ra, "gateway_assembly_held", soOGiuDangDung());
+  metricDong(ra, "gateway_http_requests_total", soRequest);
+  metricDong(ra, "gateway_tls_handshakes_total", soLanBatTay);
+  metricDong(ra, "gateway_readings_sent_total", soLanCanDaGui);
+  metricDong(ra, "gateway_retries_total", soLanHenLai);
+  metricDong(ra, "gateway_readings_rejected_total", soLanCanBiTuChoi);
+  metricDong(ra, "gateway_batch_splits_total", soLanTachLo);
+  metricMaHttp(ra, "gateway_http_responses_total", maHttp);
+  metricMaHttp(ra, "gateway_reading_results_total", maKetQua);
+
+  xSemaphoreTake(journalMutex, portMAX_DELAY);
+  metricDong(ra, "gateway_journal_pending", journal.pendingCount());
+  metricDong(ra, "gateway_journal_bytes", journal.sizeBytes());
+  metricDong(ra, "gateway_journal_capacity_bytes", journal.capacityBytes());
+  metricDong(ra, "gateway_journal_appends_total", journal.appendCount());
+  metricDong(ra, "gateway_journal_full_total", journal.fullCount());
+  metricDong(ra, "gateway_journal_compactions_total", journal.compactionCount());
+  metricDong(ra, "gateway_journal_compaction_errors_total", journal.compactionErrorCount());
+  metricDong(ra, "gateway_journal_append_us_sum", journal.appendTotalUs());
+  metricDong(ra, "gateway_journal_append_us_max", journal.appendMaxUs());
+  metricDong(ra, "gateway_journal_boot_scan_us", journal.bootScanUs());
+  metricDong(ra, "gateway_journal_replayed_total", journal.replayCount());
+  metricDong(ra, "gateway_journal_replay_us_sum", journal.replayTotalUs());
+  xSemaphoreGive(journalMutex);
+  metricDong(ra, "gateway_journal_write_errors_total", soLanGhiJournalLoi);
+
+  metricDong(ra, "gateway_name_requests_total", soLanHoiTen);
+  metricDong(ra, "gateway_name_cache_hits_total", soLanTenCoSan);
+  metricDong(ra, "gateway_name_fetch_errors_total", soLanLayTenLoi);
+  metricDong(ra, "gateway_name_requests_dropped_total", soLanBoHoiTen);
+  metricDong(ra, "gateway_station_sends_dropped_total", soLanBoGuiTram);
 
-  if (currentMillis - previousMillis >= interval) {
-    previousMillis = currentMillis;
+  metricDong(ra, "gateway_peers", soTramCan);
+  metricDong(ra, "gateway_peer_table_full_total", soLanBangTramDay);
+  metricTramCan(ra);
+
+  metricDong(ra, "gateway_wifi_connected", ketNoiWiFi.connected());
+  metricDong(ra, "gateway_wifi_channel", WiFi.channel());
+  metricDong(ra, "gateway_wifi_drops_total", ketNoiWiFi.dropCount());
+  metricDong(ra, "gateway_wifi_reconnects_total", ketNoiWiFi.reconnectCount());
+  metricDong(ra, "gateway_wifi_fast_connects_total", ketNoiWiFi.fastConnectCount());
+  metricDong(ra, "gateway_wifi_full_connects_total", ketNoiWiFi.fullConnectCount());
+  metricDong(ra, "gateway_wifi_failed_attempts_total", ketNoiWiFi.failedAttemptCount());
+  metricDong(ra, "gateway_wifi_outage_ms_total", ketNoiWiFi.outageTotalMs());
+  metricDong(ra, "gateway_wifi_current_outage_ms", ketNoiWiFi.currentOutageMs());
+
+  metricHistogram(ra, "gateway_ingest_latency_us", tgNhan);
+  metricHistogram(ra, "gateway_queue_wait_ms", tgCho);
+  metricHistogram(ra, "gateway_http_latency_ms", tgHttp);
+  metricHistogram(ra, "gateway_receive_to_ack_ms", tgToanBo);
+  metricHistogram(ra, "gateway_name_fetch_latency_ms", tgTen);
+  metricHistogram(ra, "gateway_wifi_connect_ms", ketNoiWiFi.connectMs());
+  metricHistogram(ra, "gateway_wifi_outage_ms", ketNoiWiFi.outageMs());
+  metricsServer.send(200, "text/plain; version=0.0.4", ra);
+}
+
+// Task phục vụ /metrics, ưu tiên thấp nhất để không tranh với nhận/upload
+void metricsTask(void*) {
+  metricsServer.on("/metrics", HTTP_GET, handleMetrics);
+  metricsServer.begin();
+  for (;;) {
+    metricsServer.handleClient();
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+// Task nền ưu tiên thấp: gửi khung unicast tới trạm cân, chớp LED và in thống kê định kỳ.
+// Chờ trên hangDoiGuiTram cho tới lần chớp LED kế tiếp.
+void housekeepingTask(void*) {
+  TickType_t lanCuoi = xTaskGetTickCount();
+  unsigned long previousStatsMillis = millis();
+  khung_gui_tram k;
+  for (;;) {
+    TickType_t daQua = xTaskGetTickCount() - lanCuoi;
+    TickType_t chuKy = pdMS_TO_TICKS(interval);
+    if (xQueueReceive(hangDoiGuiTram, &k, daQua >= chuKy ? 0 : chuKy - daQua) == pdTRUE) {
+      guiNgayToiTram(k);
+      continue;
+    }
+    lanCuoi += chuKy;
     ledState = !ledState;
     digitalWrite(Led, ledState);
+
+    if (millis() - previousStatsMillis >= (unsigned long)statsInterval) {
+      previousStatsMillis = millis();
+      printStats();
+    }
   }
-}
\ No newline at end of file
+}
+
+void loop() {
+  // Mọi việc đã chuyển sang các task riêng
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// Histogram thời gian cố định bộ nhớ, bucket theo luỹ thừa 2:
+// bucket 0 chứa giá trị 0, bucket i (i >= 1) chứa [2^(i-1), 2^i), bucket cuối chứa mọi giá trị lớn hơn.
+// Một task ghi, task khác đọc để in/trả /metrics: mỗi trường 32 bit đọc riêng lẻ là nguyên vẹn,
+// ảnh chụp có thể lệch nhau một lần ghi, chấp nhận được với số liệu thống kê.
+class Log2Histogram {
+public:
+  static const int kSoBucket = 24;  // tới 2^22 (~70 phút nếu đơn vị ms)
+
+  void record(uint32_t giaTri) {
+    int i = 0;
+    while (i < kSoBucket - 1 && giaTri >= (1UL << i)) i++;
+    bucket_[i]++;
+    soLan_++;
+    tong_ += giaTri;
+    if (giaTri > max_) max_ = giaTri;
+  }
+
+  uint32_t count() const { return soLan_; }
+  uint64_t sum() const { return tong_; }
+  uint32_t max() const { return max_; }
+  uint32_t mean() const { return soLan_ ? (uint32_t)(tong_ / soLan_) : 0; }
+  uint32_t bucketCount(int i) const { return bucket_[i]; }
+
+  // Cận trên (không tính) của bucket i; bucket cuối trả 0xFFFFFFFF (+Inf)
+  static uint32_t bucketUpper(int i) { return i < kSoBucket - 1 ? (1UL << i) : 0xFFFFFFFFUL; }
+
+  // Ước lượng phân vị phanTram (0-100): cận trên của bucket chứa phân vị, không vượt quá max
+  uint32_t percentile(uint8_t phanTram) const {
+    if (soLan_ == 0) return 0;
+    uint64_t canDat = ((uint64_t)soLan_ * phanTram + 99) / 100;
+    if (canDat == 0) canDat = 1;
+    uint64_t daDem = 0;
+    for (int i = 0; i < kSoBucket; i++) {
+      daDem += bucket_[i];
+      if (daDem >= canDat) return bucketUpper(i) < max_ ? bucketUpper(i) : max_;
+    }
+    return max_;
+  }
+
+private:
+  uint32_t bucket_[kSoBucket] = {};
+  uint32_t soLan_ = 0;
+  uint64_t tong_ = 0;
+  uint32_t max_ = 0;
+};
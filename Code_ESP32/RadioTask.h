@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Arduino.h>
+#include "EspNowFrame.h"
+#include "EspNowSender.h"
+#include "FlashJournal.h"
+
+// Task riêng gửi ESP-NOW cho trạm cân: loop() xếp khung vào hàng đợi rồi quay lại nhận thẻ kế tiếp
+// ngay, không đứng chờ ACK và các lần thử lại của EspNowSender.
+//
+// Khung cân (thuLai = true) được gửi lại tới 5 lần và báo kết quả qua callback. Mỗi lần gateway không
+// ACK (kể cả khi gửi lại journal) gọi onGatewayLost: chạy trong task này nên được phép chặn để ghép nối
+// lại hoặc dò kênh. Khung hỏi tên chỉ gửi một lần, mất thì thôi.
+// Mọi lần gửi của trạm đi qua task này nên chỉ một nơi đọc/ghi địa chỉ gateway sau setup().
+//
+// Có journal (useJournal()) thì khung cân gửi thất bại được ghi vào flash thay vì mất: khi còn khung
+// chờ trong journal, khung mới cũng được ghi nối sau để gateway nhận đúng thứ tự, và task gửi lại
+// journal mỗi kChuKyXa ms theo lô tối đa kLoXa khung. Chỉ xác nhận (ghi file .ack) một lần mỗi lô
+// nên mỗi khung tốn một lần ghi nối và chia phần nhỏ một lần ghi xác nhận.
+class RadioTask {
+public:
+  typedef void (*Callback)(const uint8_t* data, size_t len, bool thanhCong, void* thamSo);
+  typedef void (*LostCallback)(void* thamSo);
+
+  static const size_t kKhungToiDa = 64;
+  static const uint32_t kChuKyXa = 5000;  // ms giữa hai lần thử gửi lại journal
+  static const uint8_t kLoXa = 8;
+
+  typedef FlashJournal<khung_can> Journal;
+
+  RadioTask(EspNowSender& sender, uint8_t* gateway) : sender_(sender), gateway_(gateway) {}
+
+  bool begin(UBaseType_t soKhungHangDoi = 8, UBaseType_t uuTien = 3, BaseType_t core = 0) {
+    hangDoi_ = xQueueCreate(soKhungHangDoi, sizeof(khung_gui));
+    if (!hangDoi_) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "radio", 6144, this, uuTien, NULL, core) == pdPASS;
+  }
+
+  void onResult(Callback cb, void* thamSo = nullptr) {
+    thamSo_ = thamSo;
+    callback_ = cb;
+  }
+
+  void onGatewayLost(LostCallback cb, void* thamSo = nullptr) {
+    thamSoMat_ = thamSo;
+    matGateway_ = cb;
+  }
+
+  // Gọi trước begin(); journal chỉ được dùng trong task radio từ đó về sau
+  void useJournal(Journal* journal) { journal_ = journal; }
+
+  // Xếp khung vào hàng đợi, chờ tối đa cho tick nếu hàng đợi đầy
+  bool enqueue(const void* data, size_t len, bool thuLai, TickType_t cho = portMAX_DELAY) {
+    if (len > kKhungToiDa) return false;
+    khung_gui k;
+    k.doDai = len;
+    k.thuLai = thuLai;
+    memcpy(k.duLieu, data, len);
+    if (xQueueSend(hangDoi_, &k, cho) == pdTRUE) return true;
+    soKhungBiBo_++;
+    return false;
+  }
+
+  uint32_t pending() const { return hangDoi_ ? uxQueueMessagesWaiting(hangDoi_) : 0; }
+  uint32_t droppedCount() const { return soKhungBiBo_; }
+  uint32_t journalPending() const { return journal_ ? journal_->pendingCount() : 0; }
+  uint32_t journaledCount() const { return soKhungVaoJournal_; }
+  uint32_t replayedCount() const { return soKhungGuiLai_; }
+
+private:
+  typedef struct {
+    uint8_t doDai;
+    bool thuLai;
+    uint8_t duLieu[kKhungToiDa];
+  } khung_gui;
+
+  static void taskEntry(void* thamSo) { static_cast<RadioTask*>(thamSo)->chay(); }
+
+  void chay() {
+    khung_gui k;
+    for (;;) {
+      bool conJournal = journalPending() > 0;
+      if (xQueueReceive(hangDoi_, &k, conJournal ? pdMS_TO_TICKS(kChuKyXa) : portMAX_DELAY) == pdTRUE) {
+        if (!k.thuLai) {
+          sender_.send(gateway_, k.duLieu, k.doDai, 1);
+          continue;
+        }
+        if (!conJournal) {
+          bool ok = sender_.send(gateway_, k.duLieu, k.doDai);
+          if (!ok) luuJournal(k);
+          if (callback_) callback_(k.duLieu, k.doDai, ok, thamSo_);
+          if (!ok && matGateway_) matGateway_(thamSoMat_);
+          continue;
+        }
+        // Còn khung cũ chưa gửi: xếp sau chúng rồi gửi cả lô theo thứ tự
+        luuJournal(k);
+      }
+      xaJournal();
+    }
+  }
+
+  void luuJournal(const khung_gui& k) {
+    if (!journal_ || k.doDai != sizeof(khung_can)) return;
+    if (journal_->append(*(const khung_can*)k.duLieu)) soKhungVaoJournal_++;
+    else Serial.println("Journal khung chờ gửi đầy, bỏ khung!");
+  }
+
+  // Gửi lại các khung trong journal theo thứ tự, dừng ở khung đầu tiên không có ACK
+  void xaJournal() {
+    khung_can lo[kLoXa];
+    uint32_t soThuTu = journal_->commitSeq();
+    size_t n = journal_->read(soThuTu, lo, kLoXa);
+    size_t daGui = 0;
+    while (daGui < n && sender_.send(gateway_, (const uint8_t*)&lo[daGui], sizeof(khung_can))) daGui++;
+    if (daGui < n && matGateway_) matGateway_(thamSoMat_);
+    if (daGui == 0) return;
+    journal_->commit(journal_->commitSeq() + daGui);
+    soKhungGuiLai_ += daGui;
+    Serial.printf("Gửi lại %u khung từ journal, còn %lu khung\n", (unsigned)daGui, (unsigned long)journal_->pendingCount());
+  }
+
+  EspNowSender& sender_;
+  uint8_t* gateway_;
+  QueueHandle_t hangDoi_ = NULL;
+  Callback callback_ = nullptr;
+  void* thamSo_ = nullptr;
+  LostCallback matGateway_ = nullptr;
+  void* thamSoMat_ = nullptr;
+  volatile uint32_t soKhungBiBo_ = 0;
+  Journal* journal_ = nullptr;
+  uint32_t soKhungVaoJournal_ = 0;
+  uint32_t soKhungGuiLai_ = 0;
+};
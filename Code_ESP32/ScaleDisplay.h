@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+#include <stdarg.h>
+#include "Log2Histogram.h"
+
+// Màn hình ST7735 của trạm cân theo kiểu giữ trạng thái, thay cho hien_thi() cũ xoá cả màn hình
+// (fillScreen) rồi vẽ lại mọi khung và nhãn mỗi lần gọi: chậm trên SPI và nhấp nháy.
+//
+// Khung viền và nhãn là phần tĩnh, chỉ vẽ khi màn hình vừa bị xoá. Mỗi trường (tên, ID, KL...)
+// nhớ chuỗi đang hiển thị; set() chỉ đánh dấu trường đổi giá trị và render() chỉ vẽ lại các trường đó.
+// Chữ được in kèm màu nền nên đè thẳng lên chữ cũ, chỉ phần chữ cũ dài hơn mới cần fillRect.
+//
+// Thời gian mỗi lần vẽ (us) được ghi riêng cho lần vẽ đầy đủ và lần vẽ một phần để so sánh.
+class ScaleDisplay {
+public:
+  static const uint8_t kSoTruongToiDa = 6;
+  static const uint8_t kSoKhungToiDa = 4;
+  static const uint8_t kCoChu = 2;                 // setTextSize(2)
+  static const int16_t kRongKyTu = 6 * kCoChu;     // font mặc định 5x7 + 1 cột cách
+  static const int16_t kCaoKyTu = 8 * kCoChu;
+  static const uint16_t kMauNen = ST77XX_BLACK;
+  static const uint8_t kDoDaiGiaTri = 24;          // kể cả '\0'
+
+  explicit ScaleDisplay(Adafruit_ST7735& tft) : tft_(tft) {}
+
+  // Khung viền tĩnh
+  void addBox(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t mau) {
+    if (soKhung_ >= kSoKhungToiDa) return;
+    khung_[soKhung_++] = { x, y, w, h, mau };
+  }
+
+  // Trường gồm nhãn tĩnh (có thể rỗng) và giá trị ngay sau nhãn, rộng tối đa w pixel.
+  // Trả về chỉ số trường theo thứ tự thêm vào.
+  uint8_t addField(int16_t x, int16_t y, int16_t w, const char* nhan, uint16_t mauNhan, uint16_t mauGiaTri) {
+    if (soTruong_ >= kSoTruongToiDa) return kSoTruongToiDa - 1;
+    truong& t = truong_[soTruong_];
+    t.x = x;
+    t.y = y;
+    t.nhan = nhan;
+    t.mauNhan = mauNhan;
+    t.mauGiaTri = mauGiaTri;
+    t.xGiaTri = x + strlen(nhan) * kRongKyTu;
+    int16_t soKyTu = (x + w - t.xGiaTri) / kRongKyTu;
+    t.soKyTuToiDa = soKyTu < 0 ? 0 : (soKyTu >= (int16_t)sizeof(t.giaTri) ? sizeof(t.giaTri) - 1 : soKyTu);
+    t.giaTri[0] = '\0';
+    t.doDaiDaVe = 0;
+    t.ban = true;
+    return soTruong_++;
+  }
+
+  // Đặt giá trị; chuỗi dài hơn chỗ trống bị cắt (không xuống dòng đè lên trường dưới)
+  void set(uint8_t i, const char* giaTri) {
+    if (i >= soTruong_) return;
+    truong& t = truong_[i];
+    char moi[sizeof(t.giaTri)];
+    strncpy(moi, giaTri ? giaTri : "", t.soKyTuToiDa);
+    moi[t.soKyTuToiDa] = '\0';
+    if (strcmp(moi, t.giaTri) == 0) return;
+    strcpy(t.giaTri, moi);
+    t.ban = true;
+  }
+
+  __attribute__((format(printf, 3, 4))) void printf(uint8_t i, const char* dinhDang, ...) {
+    char tam[sizeof(truong_[0].giaTri)];
+    va_list ds;
+    va_start(ds, dinhDang);
+    vsnprintf(tam, sizeof(tam), dinhDang, ds);
+    va_end(ds);
+    set(i, tam);
+  }
+
+  // Vẽ phần đã đổi; lần đầu sau clear()/showMessage() vẽ cả khung viền và nhãn
+  void render() {
+    unsigned long batDau = micros();
+    bool dayDu = !daVeKhung_;
+    tft_.setTextSize(kCoChu);
+    if (dayDu) {
+      if (!manHinhTrang_) tft_.fillScreen(kMauNen);
+      for (uint8_t i = 0; i < soKhung_; i++)
+        tft_.drawRect(khung_[i].x, khung_[i].y, khung_[i].w, khung_[i].h, khung_[i].mau);
+      for (uint8_t i = 0; i < soTruong_; i++) {
+        truong& t = truong_[i];
+        tft_.setTextColor(t.mauNhan);
+        tft_.setCursor(t.x, t.y);
+        tft_.print(t.nhan);
+        t.doDaiDaVe = 0;  // nền đã đen
+        t.ban = true;
+      }
+      daVeKhung_ = true;
+      manHinhTrang_ = false;
+    }
+
+    uint8_t soTruongVe = 0;
+    tft_.setTextWrap(false);
+    for (uint8_t i = 0; i < soTruong_; i++) {
+      truong& t = truong_[i];
+      if (!t.ban) continue;
+      uint8_t doDai = strlen(t.giaTri);
+      tft_.setTextColor(t.mauGiaTri, kMauNen);
+      tft_.setCursor(t.xGiaTri, t.y);
+      tft_.print(t.giaTri);
+      if (t.doDaiDaVe > doDai)
+        tft_.fillRect(t.xGiaTri + doDai * kRongKyTu, t.y, (t.doDaiDaVe - doDai) * kRongKyTu, kCaoKyTu, kMauNen);
+      t.doDaiDaVe = doDai;
+      t.ban = false;
+      soTruongVe++;
+    }
+
+    lanCuoiUs_ = micros() - batDau;
+    if (dayDu) veDayDu_.record(lanCuoiUs_);
+    else if (soTruongVe > 0) veMotPhan_.record(lanCuoiUs_);
+  }
+
+  // Xoá trắng màn hình và mọi giá trị; render() kế tiếp vẽ lại khung viền
+  void clear() {
+    tft_.fillScreen(kMauNen);
+    for (uint8_t i = 0; i < soTruong_; i++) truong_[i].giaTri[0] = '\0';
+    daVeKhung_ = false;
+    manHinhTrang_ = true;
+  }
+
+  // Thông báo toàn màn hình (vd. "ESP_NOW !"), giữ các giá trị cho render() kế tiếp
+  void showMessage(const char* noiDung, uint16_t mau) {
+    tft_.fillScreen(kMauNen);
+    tft_.setTextSize(kCoChu);
+    tft_.setTextColor(mau);
+    tft_.setCursor(2, 65);
+    tft_.print(noiDung);
+    daVeKhung_ = false;
+    manHinhTrang_ = false;
+  }
+
+  uint32_t lastFrameUs() const { return lanCuoiUs_; }
+  const Log2Histogram& fullFrameUs() const { return veDayDu_; }
+  const Log2Histogram& partialFrameUs() const { return veMotPhan_; }
+
+private:
+  struct khung_vien {
+    int16_t x, y, w, h;
+    uint16_t mau;
+  };
+
+  struct truong {
+    int16_t x, y, xGiaTri;
+    const char* nhan;
+    uint16_t mauNhan, mauGiaTri;
+    uint8_t soKyTuToiDa;
+    uint8_t doDaiDaVe;   // số ký tự giá trị đang có trên màn hình
+    bool ban;            // cần vẽ lại
+    char giaTri[kDoDaiGiaTri];
+  };
+
+  Adafruit_ST7735& tft_;
+  khung_vien khung_[kSoKhungToiDa];
+  truong truong_[kSoTruongToiDa];
+  uint8_t soKhung_ = 0;
+  uint8_t soTruong_ = 0;
+  bool daVeKhung_ = false;
+  bool manHinhTrang_ = false;  // vừa clear(), lần vẽ đầy đủ không cần fillScreen lại
+
+  uint32_t lanCuoiUs_ = 0;
+  Log2Histogram veDayDu_;
+  Log2Histogram veMotPhan_;
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <MFRC522.h>
+#include <Adafruit_ST7735.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <freertos/timers.h>
+#include "EspNowFrame.h"
+#include "EspNowPairing.h"
+#include "EspNowSender.h"
+#include "UartLineReader.h"
+#include "WeightParser.h"
+#include "StableWeightFilter.h"
+#include "ScaleDisplay.h"
+#include "CardSession.h"
+#include "CustomerCache.h"
+#include "CardReaderTask.h"
+#include "DisplayTask.h"
+#include "RadioTask.h"
+
+// Firmware chung của ba trạm cân, thay cho Scale_1/2/3.cpp chép gần như nguyên nhau.
+//
+// Phần cứng, đọc thẻ, đọc đầu cân, màn hình và gửi ESP-NOW viết một lần ở đây. Phần riêng của
+// trạm (loaiCan, block thẻ cần đọc, trường kết quả trên màn hình, quy trình cân) là policy Tram
+// trong ScaleStations.h; sketch của mỗi trạm chỉ gọi khoiDongTram<Tram>() và chayTram<Tram>().
+// Tram là tham số template nên code của các trạm khác không được biên dịch vào firmware.
+// Header chỉ dùng cho một sketch trạm cân (định nghĩa biến toàn cục).
+
+// WiFi cấu hình
+// constexpr char WIFI_SSID[] = "1PHNAD";
+// constexpr char WIFI_SSID[] = "Thu Thuy";
+constexpr char WIFI_SSID[] = "DoAnTotNghiep";
+
+// MAC gateway: đọc từ NVS, chưa có thì ghép nối lúc khởi động (xem EspNowPairing.h)
+uint8_t slaveAddress[6];
+
+// MFRC522 cấu hình
+#define RST_PIN 21
+#define SS_PIN 15
+MFRC522 mfrc522(SS_PIN, RST_PIN);
+MFRC522::MIFARE_Key key;
+CardSession the(mfrc522, key);  // mỗi sector chỉ xác thực một lần cho một lần chạm thẻ
+const int blockName = 2;
+const int blockWeight = 4;  // Block để lưu khối lượng lần 1 (trạm 2)
+String tenKH = "";
+
+// TFT cấu hình
+#define TFT_CS 5
+#define TFT_RST 13
+#define TFT_DC 25
+Adafruit_ST7735 tft(TFT_CS, TFT_DC, TFT_RST);
+ScaleDisplay manHinh(tft);
+DisplayTask hienThi(manHinh, 20000);  // xoá màn hình 20 s sau khi hiện kết quả
+SemaphoreHandle_t spiMutex;           // TFT và MFRC522 dùng chung bus SPI
+// Các trường trên màn hình, theo thứ tự addField(); trường kết quả của trạm bắt đầu từ TRUONG_KET_QUA
+enum { TRUONG_TEN, TRUONG_ID, TRUONG_KET_QUA };
+
+// UART RS232
+#define RXD2 16
+#define TXD2 17
+UartLineReader canUart(UART_NUM_2, RXD2, TXD2, 9600);
+// Nhận khối lượng khi 5 dòng liên tiếp lệch nhau không quá 0.020 và có tải từ 0.050 (đơn vị đầu cân)
+StableWeightFilter locCan(5, 20, 50);
+
+#define buzzer 27
+// Còi tắt bằng timer một lần thay vì delay(200) chặn task đọc thẻ
+TimerHandle_t tatCoi;
+void tatCoiCb(TimerHandle_t) { digitalWrite(buzzer, LOW); }
+
+void Buzzer(){
+  digitalWrite(buzzer, HIGH);
+  xTimerStart(tatCoi, 0);
+}
+
+// Khung dữ liệu truyền đi
+khung_can Data;
+char uidStr[21];
+int32_t ketQuaCan[3];  // phần nghìn, ý nghĩa theo trạm (xem ScaleStations.h)
+uint32_t soThuTuGui = 0;  // 16 bit cao: số lần khởi động, 16 bit thấp: lần cân trong lần chạy này
+EspNowSender guiCan;
+RadioTask radio(guiCan, slaveAddress);  // mọi lần gửi ESP-NOW sau setup() đi qua task radio
+// Khung cân gateway chưa nhận (mất sóng, gateway tắt): giữ trên flash, task radio gửi lại theo thứ tự
+RadioTask::Journal khungChoGui(LittleFS, "/chogui.bin", 16 * 1024);
+CustomerCache khachHang;  // tên khách hàng theo UID thẻ, lưu trên flash
+CardReaderTask docThe(mfrc522, the, khachHang, blockName);
+uint8_t loaiCanTram = 0;  // Tram::kLoaiCan, cho ketQuaGui()
+
+// Khung gateway gửi tới ngoài khung ghép nối: tên khách hàng trả lời KHUNG_HOI_TEN
+void onDataRecv(const uint8_t*, const uint8_t* data, int len) {
+  khachHang.onFrame(data, len);
+}
+
+// Hàm quét WiFi để tìm đúng channel (chỉ dùng khi chưa lưu kênh)
+int32_t getWiFiChannel(const char* ssid) {
+  int n = WiFi.scanNetworks();
+  if (n <= 0) return 0;
+
+  for (int i = 0; i < n; i++) {
+    if (WiFi.SSID(i) == ssid) return WiFi.channel(i);
+  }
+  return 0;
+}
+
+// Tên gateway trả về: cập nhật cache, và màn hình nếu thẻ đó đang hiển thị
+void capNhatTenKhachHang(TickType_t cho) {
+  khung_ten k;
+  while (khachHang.poll(k, cho)) {
+    cho = 0;
+    if (hienThi.showing() && k.coTen && k.doDaiUid == Data.doDaiUid && memcmp(k.uid, Data.uid, k.doDaiUid) == 0) {
+      tenKH = k.ten;
+      hienThi.set(TRUONG_TEN, k.ten);
+    }
+  }
+}
+
+// Kết quả gửi khung cân, chạy trong task radio
+void ketQuaGui(const uint8_t*, size_t, bool thanhCong, void*) {
+  Serial.printf("Gửi dữ liệu: %s (ACK TB %lu us, thử lại %lu lần, hết giờ %lu lần, %lu khung không gửi được, "
+                "%lu khung chờ gửi, %lu khung trong journal)\n",
+                thanhCong ? "Thành công" : "Thất bại", (unsigned long)guiCan.ackLatencyUs().mean(),
+                (unsigned long)guiCan.retryCount(), (unsigned long)guiCan.timeoutCount(),
+                (unsigned long)guiCan.failureCount(), (unsigned long)radio.pending(), (unsigned long)radio.journalPending());
+  Serial.printf("Radio: %lu khung bị bỏ (hàng đợi đầy), %lu khung vào journal, %lu khung gửi lại từ journal\n",
+                (unsigned long)radio.droppedCount(), (unsigned long)radio.journaledCount(),
+                (unsigned long)radio.replayedCount());
+  if (!thanhCong) {
+    // Khung đã vào journal (nếu còn chỗ), không cần nhập lại tay
+    hienThi.showMessage("ESP_NOW !", ST77XX_RED);
+  }
+}
+
+// Gateway không ACK (task radio): có thể gateway đã bị thay hoặc AP của gateway đã đổi kênh.
+// Ghép nối lại trên kênh hiện tại; dò các kênh khác tối đa mỗi phút một lần vì mất vài giây.
+unsigned long lanQuetKenhCuoi = 0;
+void timLaiGateway(void*) {
+  bool quetKenh = lanQuetKenhCuoi == 0 || millis() - lanQuetKenhCuoi > 60000;
+  if (quetKenh) lanQuetKenhCuoi = millis();
+  if (ghepNoiLai(loaiCanTram, slaveAddress, quetKenh)) lanQuetKenhCuoi = 0;
+}
+
+// Một lần cân ổn định, phần nghìn (xem WeightParser.h)
+int32_t docCan() {
+  Serial.println("Đang chờ dữ liệu từ cân...");
+  canUart.flush();  // bỏ các dòng đầu cân gửi trước lần cân này
+  locCan.reset();
+
+  dong_uart dong;
+  int32_t ketQua;
+  while (true) {
+    capNhatTenKhachHang(0);  // tên gateway trả về trong lúc chờ cân
+
+    // Chờ trên hàng đợi dòng: CPU rảnh cho WiFi/ESP-NOW thay vì quay vòng delay(10).
+    // Đầu cân chỉ in khi bấm nút thì im lặng một lúc nghĩa là dòng cuối đã là kết quả.
+    if (!canUart.readLine(dong, pdMS_TO_TICKS(200))) {
+      if (locCan.idle(millis(), ketQua)) break;
+      continue;
+    }
+
+    // Dòng trống, không có số, quá tải hoặc tải chưa ổn định: chờ dòng sau
+    if (locCan.push(phanTichCan(dong.noiDung, dong.doDai), dong.nhanLuc, ketQua)) break;
+  }
+  Serial.printf("Trọng lượng: %.3f, ổn định sau %lu ms (trung vị %lu ms)\n", tuPhanNghin(ketQua),
+                (unsigned long)locCan.lastSettleMs(), (unsigned long)locCan.settleTime().percentile(50));
+  Serial.printf("UART đầu cân: %lu dòng, %lu dòng bị bỏ (hàng đợi đầy), %lu lần tràn FIFO, %lu dòng quá dài\n",
+                (unsigned long)canUart.lineCount(), (unsigned long)canUart.droppedLines(),
+                (unsigned long)canUart.overflowCount(), (unsigned long)canUart.tooLongCount());
+  return ketQua;
+}
+
+template <class Tram>
+void hien_thi() {
+  hienThi.set(TRUONG_TEN, tenKH.c_str());
+  hienThi.set(TRUONG_ID, uidStr);
+  Tram::hienKetQua();
+}
+
+// setup() của trạm
+template <class Tram>
+void khoiDongTram() {
+  Serial.begin(9600);
+  if (!canUart.begin()) Serial.println("Không khởi tạo được UART đầu cân!");
+  loaiCanTram = Tram::kLoaiCan;
+
+  spiMutex = xSemaphoreCreateMutex();
+  pinMode(buzzer, OUTPUT);
+  digitalWrite(buzzer, LOW);
+  tatCoi = xTimerCreate("coi", pdMS_TO_TICKS(200), pdFALSE, NULL, tatCoiCb);
+
+  // Số thứ tự khung không lặp lại sau khi khởi động lại, để gateway/server nhận ra lần gửi lại
+  Preferences prefs;
+  prefs.begin("khung", false);
+  uint16_t soLanKhoiDong = prefs.getUShort("boot", 0) + 1;
+  prefs.putUShort("boot", soLanKhoiDong);
+  prefs.end();
+  soThuTuGui = (uint32_t)soLanKhoiDong << 16;
+  khachHang.begin(soLanKhoiDong);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+
+  // Kênh lưu từ lần trước: vào thẳng, không quét WiFi (vài giây sau mỗi lần mất điện).
+  // Chưa có thì quét tìm SSID một lần; gateway đổi kênh sau đó thì timLaiGateway() dò lại.
+  unsigned long batDauTimKenh = millis();
+  uint8_t kenh = docKenhDaLuu();
+  const char* nguonKenh = "đã lưu";
+  if (!kenh) {
+    kenh = getWiFiChannel(WIFI_SSID);
+    nguonKenh = "quét WiFi";
+    luuKenh(kenh);
+  }
+  if (kenh) esp_wifi_set_channel(kenh, WIFI_SECOND_CHAN_NONE);
+
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("ESP-NOW init thất bại");
+    while (true) delay(1000);
+  }
+  guiCan.begin();
+  datNhanKhung(onDataRecv);
+
+  // Chưa ghép nối, hoặc không thấy SSID (AP tắt, SSID ẩn): tìm gateway bằng ESP-NOW trên kênh đang có,
+  // không được thì dò từng kênh, thay vì đứng chờ mãi
+  if (!kenh || !docGatewayDaLuu(slaveAddress)) {
+    Serial.println(kenh ? "Chưa ghép nối gateway, đang tìm..." : "Không tìm thấy SSID, dò gateway trên các kênh...");
+    for (;;) {
+      if (kenh && ghepNoiGateway(Tram::kLoaiCan, slaveAddress, 3000)) break;
+      kenh = quetKenhGateway(Tram::kLoaiCan, slaveAddress);
+      if (kenh) {
+        nguonKenh = "dò ESP-NOW";
+        break;
+      }
+      Serial.println("Không thấy gateway, thử lại...");
+    }
+  }
+  unsigned long tgTimKenh = millis() - batDauTimKenh;
+
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, slaveAddress, 6);
+  peerInfo.channel = 0;  // kênh hiện tại: timLaiGateway() đổi kênh không phải thêm lại peer
+  peerInfo.encrypt = false;
+  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+    Serial.println("Thêm peer thất bại");
+    while (true) delay(1000);
+  }
+
+  tft.initR(INITR_BLACKTAB);
+  tft.setRotation(1);
+  tft.setTextColor(ST77XX_WHITE);
+  tft.setTextSize(2);
+  tft.fillScreen(ST77XX_BLACK);
+
+  // Bố cục màn hình: khung viền và nhãn vẽ một lần, hien_thi() chỉ vẽ lại trường đổi giá trị
+  manHinh.addBox(0, 0, 160, 26, ST77XX_CYAN);
+  manHinh.addBox(0, 30, 160, 26, ST77XX_CYAN);
+  manHinh.addBox(0, 60, 160, 65, ST77XX_CYAN);
+  manHinh.addField(2, 5, 156, "", ST77XX_WHITE, ST77XX_WHITE);
+  manHinh.addField(1, 35, 157, "ID: ", ST77XX_YELLOW, ST77XX_WHITE);
+  Tram::boCuc();
+
+  SPI.begin();
+  mfrc522.PCD_Init();
+  for (byte i = 0; i < 6; i++) key.keyByte[i] = 0xFF;
+
+  // Đọc thẻ, vẽ màn hình và gửi chạy song song với loop() (lần cân)
+  hienThi.begin(spiMutex);
+  radio.onResult(ketQuaGui);
+  radio.onGatewayLost(timLaiGateway);
+  if (LittleFS.begin(true) && khungChoGui.begin()) {
+    radio.useJournal(&khungChoGui);
+    if (khungChoGui.pendingCount()) Serial.printf("Còn %lu khung chưa gửi từ lần chạy trước\n", (unsigned long)khungChoGui.pendingCount());
+  } else {
+    Serial.println("Không mở được journal khung chờ gửi, khung gửi lỗi sẽ bị mất!");
+  }
+  radio.begin();
+  docThe.begin(spiMutex, Buzzer, Tram::kBlockKhac);
+
+  // Từ lúc cấp điện tới lúc nhận được thẻ đầu tiên
+  Serial.printf("Khởi động -> sẵn sàng: %lu ms (kênh %u %s, tìm kênh/gateway %lu ms)\n", millis(), kenh, nguonKenh,
+                tgTimKenh);
+}
+
+// loop() của trạm: một lần chạm thẻ
+template <class Tram>
+void chayTram() {
+  // Chờ lần chạm thẻ kế tiếp (task đọc thẻ đã đọc tên, blockKhac và bíp); trong lúc chờ nhận tên trả về muộn
+  the_moi moi;
+  if (!docThe.next(moi, pdMS_TO_TICKS(100))) {
+    capNhatTenKhachHang(0);
+    return;
+  }
+
+  // Reset dữ liệu
+  memset(&Data, 0, sizeof(Data));
+  memset(ketQuaCan, 0, sizeof(ketQuaCan));
+  Data.loaiCan = Tram::kLoaiCan;
+
+  // Lấy UID
+  Data.doDaiUid = moi.doDaiUid;
+  memcpy(Data.uid, moi.uid, Data.doDaiUid);
+  uidToHex(Data.uid, Data.doDaiUid, uidStr);
+
+  if (moi.hoiGateway) {
+    khung_ten hoi = khachHang.requestFrame(Tram::kLoaiCan, Data.uid, Data.doDaiUid);
+    radio.enqueue(&hoi, sizeof(hoi), false, 0);
+  }
+  tenKH = moi.ten;
+  hienThi.hold();  // đang cân: màn hình không tự xoá giữa chừng
+  hien_thi<Tram>();
+  // Thẻ chưa có tên ở đâu cả: chờ một chút, gateway thường trả lời ngay từ bộ nhớ
+  if (!moi.ten[0]) capNhatTenKhachHang(pdMS_TO_TICKS(150));
+
+  // Quy trình cân của trạm; trả về true nếu Data.giaTri là kết quả cần gửi
+  if (Tram::canVaTinh(moi)) {
+    Data.soThuTu = ++soThuTuGui;
+    Data.thoiGian = millis();
+    dongGoiKhung(Data);
+
+    // Gửi trong task radio (chờ ACK, thử lại tới 5 lần); loop() quay lại nhận thẻ kế tiếp ngay
+    radio.enqueue(&Data, sizeof(Data), true);
+  }
+  hienThi.release();
+  Serial.printf("Xong lần cân sau %lu ms từ lúc chạm thẻ\n", millis() - moi.chamLuc);
+}
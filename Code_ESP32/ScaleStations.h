@@ -0,0 +1,161 @@
+#pragma once
+
+#include "ScaleFirmware.h"
+
+// Phần riêng của từng loại trạm cân, dùng làm tham số Tram của khoiDongTram()/chayTram():
+//   kLoaiCan     loaiCan của khung gửi và khi ghép nối gateway
+//   kBlockKhac   block thẻ đọc thêm lúc chạm thẻ (the_moi::khoiKhac), -1 nếu không cần
+//   boCuc()      thêm các trường kết quả từ TRUONG_KET_QUA
+//   hienKetQua() đưa ketQuaCan[] lên các trường đó
+//   canVaTinh()  cân, tính Data.giaTri và release() thẻ; true nếu có kết quả để gửi
+
+// Trạm 1, tạp chất: cân một lần, gửi khối lượng (ketQuaCan[0])
+struct TramTapChat {
+  static constexpr uint8_t kLoaiCan = 1;
+  static constexpr int kBlockKhac = -1;
+
+  static void boCuc() {
+    manHinh.addField(2, 65, 156, "KL: ", ST77XX_YELLOW, ST77XX_WHITE);
+  }
+
+  static void hienKetQua() {
+    hienThi.printf(TRUONG_KET_QUA, "%.2f Kg", tuPhanNghin(ketQuaCan[0]));
+  }
+
+  static bool canVaTinh(const the_moi&) {
+    docThe.release();  // không ghi gì vào thẻ: task đọc thẻ cho thẻ ngủ và dò thẻ tiếp theo
+    ketQuaCan[0] = docCan();
+    Data.giaTri = ketQuaCan[0];
+    hien_thi<TramTapChat>();
+    return true;
+  }
+};
+
+// Trạm 2, mủ nước: lần chạm thứ nhất cân và lưu KL1 vào thẻ, lần chạm thứ hai cân KL2 và gửi
+// chênh lệch KL1 - KL2 (ketQuaCan[0..2]: KL1, KL2, chênh lệch)
+struct TramMuNuoc {
+  static constexpr uint8_t kLoaiCan = 2;
+  static constexpr int kBlockKhac = blockWeight;
+
+  static void boCuc() {
+    manHinh.addField(2, 63, 156, "KL1:", ST77XX_YELLOW, ST77XX_WHITE);
+    manHinh.addField(2, 83, 156, "KL2:", ST77XX_YELLOW, ST77XX_WHITE);
+    manHinh.addField(2, 103, 156, "KL: ", ST77XX_ORANGE, ST77XX_ORANGE);
+  }
+
+  static void hienKetQua() {
+    hienThi.printf(TRUONG_KET_QUA, "%.2f Kg", tuPhanNghin(ketQuaCan[0]));
+    hienThi.printf(TRUONG_KET_QUA + 1, "%.2f Kg", tuPhanNghin(ketQuaCan[1]));
+    hienThi.printf(TRUONG_KET_QUA + 2, "%.2f Kg", tuPhanNghin(ketQuaCan[2]));
+  }
+
+  static bool canVaTinh(const the_moi& moi) {
+    int32_t& canLan1 = ketQuaCan[0];
+    int32_t& canLan2 = ketQuaCan[1];
+    int32_t& chenhLech = ketQuaCan[2];
+
+    // Ghi tên vào thẻ
+    // tenKH = "NG.VIET HOANG";
+    // byte nameData[16] = {0};
+    // strncpy((char*)nameData, tenKH.c_str(), 15);
+    // docThe.write(blockName, nameData);
+
+    // Kiểm tra xem có dữ liệu khối lượng cũ không ("", "0", "0.00" là chưa có)
+    int32_t klCu = 0;
+    bool hasOldWeight = docKhoiLuongLan1(moi.khoiKhac, klCu);
+
+    if (!hasOldWeight) {
+      // LẦN QUÉT THỨ NHẤT
+      Serial.println("=== LẦN QUÉT THỨ NHẤT ===");
+
+      // Đọc khối lượng từ cân
+      canLan1 = docCan();
+
+      // Lưu khối lượng vào RFID (dạng chữ, đọc lại bằng phanTichCan), thẻ vẫn được giữ từ lúc chạm
+      byte weightData[16] = {0};
+      dinhDangPhanNghin(canLan1, (char*)weightData, 16);
+      bool daLuu = docThe.write(blockWeight, weightData);
+      docThe.release();
+
+      // Hiển thị
+      hien_thi<TramMuNuoc>();
+
+      Serial.print(daLuu ? "Đã lưu KL1: " : "Lưu KL1 vào thẻ thất bại: ");
+      Serial.println((char*)weightData);
+      return false;
+    }
+
+    // LẦN QUÉT THỨ HAI
+    Serial.println("=== LẦN QUÉT THỨ HAI ===");
+
+    // Khối lượng cũ đã đọc cùng tên lúc chạm thẻ
+    canLan1 = klCu;
+    Serial.print("Đọc KL1 từ RFID: ");
+    Serial.println(moi.khoiKhac);
+
+    // Xóa dữ liệu block khi thẻ còn trên đầu đọc (cùng sector: không xác thực lại),
+    // sau đó thẻ không còn cần trong lúc cân
+    byte emptyData[16] = {0};
+    if (docThe.write(blockWeight, emptyData)) Serial.println("Đã xóa dữ liệu block khối lượng");
+    docThe.release();
+
+    // Đọc khối lượng mới từ cân
+    canLan2 = docCan();
+
+    // Tính chênh lệch
+    chenhLech = canLan1 - canLan2;
+    Data.giaTri = chenhLech;
+
+    // Hiển thị
+    hien_thi<TramMuNuoc>();
+
+    Serial.print("KL1: "); Serial.print(tuPhanNghin(canLan1));
+    Serial.print(" | KL2: "); Serial.print(tuPhanNghin(canLan2));
+    Serial.print(" | Chênh lệch: "); Serial.println(tuPhanNghin(chenhLech));
+    return true;
+  }
+};
+
+// Trạm 3, TSC: cân mẫu hai lần, gửi hàm lượng = lần 2 / lần 1
+// (ketQuaCan[0..2]: lần 1, lần 2, hàm lượng)
+struct TramTsc {
+  static constexpr uint8_t kLoaiCan = 3;
+  static constexpr int kBlockKhac = -1;
+
+  static void boCuc() {
+    manHinh.addField(2, 63, 156, "KL1: ", ST77XX_YELLOW, ST77XX_WHITE);
+    manHinh.addField(2, 83, 156, "KL2: ", ST77XX_YELLOW, ST77XX_WHITE);
+    manHinh.addField(2, 103, 156, "TSC: ", ST77XX_ORANGE, ST77XX_ORANGE);
+  }
+
+  static void hienKetQua() {
+    hienThi.printf(TRUONG_KET_QUA, "%.2f g", tuPhanNghin(ketQuaCan[0]));
+    hienThi.printf(TRUONG_KET_QUA + 1, "%.2f g", tuPhanNghin(ketQuaCan[1]));
+    hienThi.printf(TRUONG_KET_QUA + 2, "%.2f", tuPhanNghin(ketQuaCan[2]));
+  }
+
+  static bool canVaTinh(const the_moi&) {
+    int32_t& canLan1 = ketQuaCan[0];
+    int32_t& canLan2 = ketQuaCan[1];
+    int32_t& hamLuong = ketQuaCan[2];
+    docThe.release();  // không ghi gì vào thẻ
+
+    Serial.println("Đang chờ cân lần 1...");
+    canLan1 = docCan();
+    Serial.print("Cân lần 1: "); Serial.println(tuPhanNghin(canLan1));
+    hien_thi<TramTsc>();
+
+    Serial.println("Đang chờ cân lần 2...");
+    canLan2 = docCan();
+    Serial.print("Cân lần 2: "); Serial.println(tuPhanNghin(canLan2));
+
+    // Hàm lượng = lần 2 / lần 1, tính bằng số nguyên phần nghìn (làm tròn)
+    hamLuong = tinhTiLe(canLan1, canLan2);
+    Data.giaTri = hamLuong;
+
+    Serial.print("Hàm lượng: ");
+    Serial.println(tuPhanNghin(hamLuong));
+    hien_thi<TramTsc>();
+    return true;
+  }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Hàng đợi vòng một nhà sản xuất / một người tiêu thụ, không khoá.
+// Nhà sản xuất (callback ESP-NOW trong task WiFi) chỉ ghi "dau",
+// người tiêu thụ (ingestTask trên core 0) chỉ ghi "cuoi", nên không cần mutex.
+// N phải là luỹ thừa của 2.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N phải là luỹ thừa của 2");
+
+public:
+  // Gọi từ phía nhà sản xuất. Trả về false (và tăng bộ đếm rớt) nếu đầy.
+  bool push(const T& item) {
+    const uint32_t dau = dau_.load(std::memory_order_relaxed);
+    const uint32_t cuoi = cuoi_.load(std::memory_order_acquire);
+    if (dau - cuoi >= N) {
+      soLanRot_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[dau & (N - 1)] = item;
+    dau_.store(dau + 1, std::memory_order_release);
+
+    const uint32_t doSau = dau + 1 - cuoi;
+    if (doSau > doSauMax_.load(std::memory_order_relaxed)) {
+      doSauMax_.store(doSau, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Gọi từ phía người tiêu thụ. Trả về false nếu rỗng.
+  bool pop(T& item) {
+    const uint32_t cuoi = cuoi_.load(std::memory_order_relaxed);
+    const uint32_t dau = dau_.load(std::memory_order_acquire);
+    if (cuoi == dau) return false;
+    item = buf_[cuoi & (N - 1)];
+    cuoi_.store(cuoi + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t size() const {
+    return dau_.load(std::memory_order_acquire) - cuoi_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+
+  uint32_t dropped() const { return soLanRot_.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return doSauMax_.load(std::memory_order_relaxed); }
+
+private:
+  T buf_[N];
+  std::atomic<uint32_t> dau_{0};
+  std::atomic<uint32_t> cuoi_{0};
+  std::atomic<uint32_t> soLanRot_{0};
+  std::atomic<uint32_t> doSauMax_{0};
+};
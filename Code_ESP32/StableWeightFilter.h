@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+#include "WeightParser.h"
+#include "Log2Histogram.h"
+
+// Bộ lọc ổn định tải chạy theo từng dòng đầu cân, đặt sau phanTichCan().
+//
+// Giữ cửa sổ trượt soMau mẫu gần nhất; khi mọi mẫu trong cửa sổ có tải (>= nguongCoTai) và
+// chênh lệch lớn nhất - nhỏ nhất không quá nguong thì coi là đã ổn định và trả trung vị cửa sổ,
+// tức là trả ngay khi đủ soMau mẫu ổn định chứ không đợi thêm.
+// Đầu cân có báo trạng thái: mẫu ST (ổn định) có tải được nhận ngay, mẫu US (chưa ổn định) xoá cửa sổ.
+// Đầu cân chỉ in khi bấm nút (không gửi liên tục): im lặng choDongKeTiep ms sau một mẫu có tải
+// thì idle() trả mẫu đó, nếu mẫu không bị báo US và các mẫu đang có trong cửa sổ không chênh quá nguong.
+//
+// Thời gian từ lúc có tải (mẫu có tải đầu tiên) tới lúc ổn định được ghi vào settleTime() (ms).
+// Không phụ thuộc Arduino: thời gian do nơi gọi truyền vào.
+class StableWeightFilter {
+public:
+  static const uint8_t kSoMauToiDa = 16;
+
+  StableWeightFilter(uint8_t soMau = 5, int32_t nguong = 20, int32_t nguongCoTai = 50,
+                     uint32_t choDongKeTiep = 1500)
+    : soMau_(soMau < 2 ? 2 : (soMau > kSoMauToiDa ? kSoMauToiDa : soMau)),
+      nguong_(nguong), nguongCoTai_(nguongCoTai), choDongKeTiep_(choDongKeTiep) {}
+
+  // Bắt đầu một lần cân mới
+  void reset() {
+    soTrongCuaSo_ = 0;
+    viTri_ = 0;
+    coTaiLuc_ = 0;
+    daCoTai_ = false;
+    coMauCuoi_ = false;
+  }
+
+  // Đưa một dòng đã phân tích vào bộ lọc. Trả về true và ghi giá trị ổn định vào ra khi tải đã ổn định.
+  bool push(const ket_qua_can& kq, uint32_t luc, int32_t& ra) {
+    if (kq.trangThai != CAN_OK) return false;
+    bool coTai = triTuyetDoi(kq.phanNghin) >= nguongCoTai_;
+    coMauCuoi_ = coTai && kq.onDinh != CHUA_ON_DINH;
+    mauCuoi_ = kq.phanNghin;
+    mauCuoiLuc_ = luc;
+
+    if (!coTai || kq.onDinh == CHUA_ON_DINH) {
+      // Cân trống hoặc đầu cân báo đang dao động: bắt đầu lại cửa sổ
+      soTrongCuaSo_ = 0;
+      viTri_ = 0;
+      if (!coTai) daCoTai_ = false;
+      if (coTai && !daCoTai_) batDauCoTai(luc);
+      return false;
+    }
+    if (!daCoTai_) batDauCoTai(luc);
+
+    if (kq.onDinh == ON_DINH) return xong(kq.phanNghin, luc, ra);
+
+    cuaSo_[viTri_] = kq.phanNghin;
+    viTri_ = (viTri_ + 1) % soMau_;
+    if (soTrongCuaSo_ < soMau_) soTrongCuaSo_++;
+    if (soTrongCuaSo_ < soMau_) return false;
+    if (doChenhCuaSo() > nguong_) return false;
+    return xong(trungVi(), luc, ra);
+  }
+
+  // Gọi khi chờ dòng mới quá lâu: đầu cân in theo lệnh thì mẫu có tải cuối cùng chính là kết quả
+  bool idle(uint32_t now, int32_t& ra) {
+    if (!coMauCuoi_ || now - mauCuoiLuc_ < choDongKeTiep_) return false;
+    if (doChenhCuaSo() > nguong_) return false;
+    return xong(mauCuoi_, mauCuoiLuc_, ra);
+  }
+
+  // Thời gian có tải -> ổn định của lần cân gần nhất và thống kê mọi lần cân (ms)
+  uint32_t lastSettleMs() const { return lanCuoi_; }
+  const Log2Histogram& settleTime() const { return thoiGianOnDinh_; }
+
+private:
+  static int32_t triTuyetDoi(int32_t x) { return x < 0 ? -x : x; }
+
+  // Lớn nhất - nhỏ nhất của các mẫu đang có trong cửa sổ (0 nếu cửa sổ trống)
+  int64_t doChenhCuaSo() const {
+    if (soTrongCuaSo_ == 0) return 0;
+    int32_t nhoNhat = cuaSo_[0], lonNhat = cuaSo_[0];
+    for (uint8_t i = 1; i < soTrongCuaSo_; i++) {
+      if (cuaSo_[i] < nhoNhat) nhoNhat = cuaSo_[i];
+      if (cuaSo_[i] > lonNhat) lonNhat = cuaSo_[i];
+    }
+    return (int64_t)lonNhat - nhoNhat;
+  }
+
+  void batDauCoTai(uint32_t luc) {
+    daCoTai_ = true;
+    coTaiLuc_ = luc;
+  }
+
+  bool xong(int32_t giaTri, uint32_t luc, int32_t& ra) {
+    ra = giaTri;
+    lanCuoi_ = daCoTai_ ? luc - coTaiLuc_ : 0;
+    thoiGianOnDinh_.record(lanCuoi_);
+    reset();
+    return true;
+  }
+
+  // Trung vị cửa sổ: sắp xếp chèn bản sao (tối đa 16 phần tử)
+  int32_t trungVi() const {
+    int32_t tam[kSoMauToiDa];
+    for (uint8_t i = 0; i < soMau_; i++) {
+      int32_t x = cuaSo_[i];
+      int j = i;
+      while (j > 0 && tam[j - 1] > x) {
+        tam[j] = tam[j - 1];
+        j--;
+      }
+      tam[j] = x;
+    }
+    return tam[soMau_ / 2];
+  }
+
+  uint8_t soMau_;
+  int32_t nguong_;
+  int32_t nguongCoTai_;
+  uint32_t choDongKeTiep_;
+
+  int32_t cuaSo_[kSoMauToiDa];
+  uint8_t soTrongCuaSo_ = 0;
+  uint8_t viTri_ = 0;
+  bool daCoTai_ = false;
+  uint32_t coTaiLuc_ = 0;
+  bool coMauCuoi_ = false;
+  int32_t mauCuoi_ = 0;
+  uint32_t mauCuoiLuc_ = 0;
+
+  uint32_t lanCuoi_ = 0;
+  Log2Histogram thoiGianOnDinh_;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/uart.h>
+
+// Đọc dòng từ đầu cân RS232 theo sự kiện, thay cho vòng while(true) + Serial2.available() + delay(10).
+//
+// ISR của driver UART đổ byte vào ring buffer của driver và báo sự kiện qua hàng đợi sự kiện;
+// một task riêng chờ sự kiện, chép byte ra và ghép dòng tại chỗ (không dùng String).
+// Dòng hoàn chỉnh (kết thúc bằng CR, LF hoặc ETX) được gọi callback (nếu có) rồi đưa vào
+// hàng đợi dòng để loop()/task khác lấy bằng readLine(); hàng đợi đầy thì bỏ dòng cũ nhất
+// vì với đầu cân chỉ dòng mới nhất có ý nghĩa.
+typedef struct {
+  char noiDung[48];   // luôn kết thúc bằng '\0'
+  uint8_t doDai;
+  uint32_t nhanLuc;   // millis() lúc nhận byte cuối của dòng
+} dong_uart;
+
+class UartLineReader {
+public:
+  typedef void (*Callback)(const dong_uart& dong, void* thamSo);
+
+  UartLineReader(uart_port_t cong, int chanRx, int chanTx, int baud)
+    : cong_(cong), chanRx_(chanRx), chanTx_(chanTx), baud_(baud) {}
+
+  // Cài driver UART và tạo task đọc. Không dùng chung cổng với Serial2.begin().
+  bool begin(UBaseType_t soDongHangDoi = 8, UBaseType_t uuTien = 5, BaseType_t core = 1) {
+    uart_config_t cauHinh = {};
+    cauHinh.baud_rate = baud_;
+    cauHinh.data_bits = UART_DATA_8_BITS;
+    cauHinh.parity = UART_PARITY_DISABLE;
+    cauHinh.stop_bits = UART_STOP_BITS_1;
+    cauHinh.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    cauHinh.source_clk = UART_SCLK_APB;
+    if (uart_driver_install(cong_, kRingBuffer, 0, 16, &suKien_, 0) != ESP_OK) return false;
+    if (uart_param_config(cong_, &cauHinh) != ESP_OK) return false;
+    if (uart_set_pin(cong_, chanTx_, chanRx_, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) return false;
+
+    hangDoiDong_ = xQueueCreate(soDongHangDoi, sizeof(dong_uart));
+    if (!hangDoiDong_) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "uart", 3072, this, uuTien, NULL, core) == pdPASS;
+  }
+
+  // Callback chạy trong task đọc UART: phải ngắn, không chặn
+  void onLine(Callback cb, void* thamSo = nullptr) {
+    thamSo_ = thamSo;
+    callback_ = cb;
+  }
+
+  // Lấy dòng kế tiếp, chờ tối đa cho tick (0: không chờ, portMAX_DELAY: chờ mãi)
+  bool readLine(dong_uart& ra, TickType_t cho) {
+    return xQueueReceive(hangDoiDong_, &ra, cho) == pdTRUE;
+  }
+
+  // Bỏ mọi dòng đang chờ (đầu cân gửi liên tục, dòng cũ không thuộc lần cân mới)
+  void flush() { xQueueReset(hangDoiDong_); }
+
+  uint32_t lineCount() const { return soDong_; }
+  uint32_t droppedLines() const { return soDongBiBo_; }
+  uint32_t overflowCount() const { return soLanTran_; }
+  uint32_t tooLongCount() const { return soDongQuaDai_; }
+
+private:
+  static const int kRingBuffer = 1024;  // ring buffer RX của driver (byte)
+  static const char kEtx = 0x03;
+
+  static void taskEntry(void* thamSo) { static_cast<UartLineReader*>(thamSo)->chay(); }
+
+  void chay() {
+    uart_event_t suKien;
+    uint8_t buf[64];
+    for (;;) {
+      if (xQueueReceive(suKien_, &suKien, portMAX_DELAY) != pdTRUE) continue;
+      switch (suKien.type) {
+        case UART_DATA: {
+          size_t conLai = suKien.size;
+          while (conLai > 0) {
+            int n = uart_read_bytes(cong_, buf, conLai < sizeof(buf) ? conLai : sizeof(buf), 0);
+            if (n <= 0) break;
+            for (int i = 0; i < n; i++) nhanByte((char)buf[i]);
+            conLai -= n;
+          }
+          break;
+        }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+          // Task không theo kịp: bỏ dữ liệu dở dang, dòng kế tiếp sẽ hợp lệ
+          soLanTran_++;
+          uart_flush_input(cong_);
+          xQueueReset(suKien_);
+          dong_.doDai = 0;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  void nhanByte(char c) {
+    if (c == '\r' || c == '\n' || c == kEtx) {
+      if (dong_.doDai > 0 && !quaDai_) guiDong();
+      dong_.doDai = 0;
+      quaDai_ = false;
+      return;
+    }
+    if (dong_.doDai >= sizeof(dong_.noiDung) - 1) {
+      // Dòng dài bất thường (nhiễu, sai baud): bỏ tới ký tự kết thúc dòng kế tiếp
+      if (!quaDai_) soDongQuaDai_++;
+      quaDai_ = true;
+      return;
+    }
+    dong_.noiDung[dong_.doDai++] = c;
+  }
+
+  void guiDong() {
+    dong_.noiDung[dong_.doDai] = '\0';
+    dong_.nhanLuc = millis();
+    soDong_++;
+    if (callback_) callback_(dong_, thamSo_);
+    if (xQueueSend(hangDoiDong_, &dong_, 0) != pdTRUE) {
+      dong_uart cu;
+      xQueueReceive(hangDoiDong_, &cu, 0);
+      xQueueSend(hangDoiDong_, &dong_, 0);
+      soDongBiBo_++;
+    }
+  }
+
+  uart_port_t cong_;
+  int chanRx_;
+  int chanTx_;
+  int baud_;
+  QueueHandle_t suKien_ = NULL;
+  QueueHandle_t hangDoiDong_ = NULL;
+  Callback callback_ = nullptr;
+  void* thamSo_ = nullptr;
+
+  dong_uart dong_ = {};
+  bool quaDai_ = false;
+
+  volatile uint32_t soDong_ = 0;
+  volatile uint32_t soDongBiBo_ = 0;
+  volatile uint32_t soLanTran_ = 0;
+  volatile uint32_t soDongQuaDai_ = 0;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Bộ phân tích dòng số liệu của đầu cân, dùng chung cho Scale_1/2/3.
+// Làm việc trực tiếp trên (const char*, độ dài), không cấp phát, không dùng float:
+// kết quả là số nguyên phần nghìn của đơn vị in trên đầu cân (kg -> gam, g -> mg).
+//
+// Nhận được các dạng thường gặp:
+//   "  12.34 kg", "-0.5g", "+0012.345", "\x02 ST,GS,+0012.34kg\x03", "US,NT,  1.20 kg", "OL"
+// Tiền tố ST/US (ổn định / chưa ổn định) được ghi nhận, OL và OVER... (OVERLOAD, OVERFLOW) báo quá tải.
+// Không phụ thuộc Arduino nên biên dịch được cả trên máy tính.
+
+enum {
+  CAN_OK = 0,
+  CAN_RONG,          // dòng trống hoặc chỉ có khung STX/ETX
+  CAN_KHONG_CO_SO,   // không tìm thấy chữ số
+  CAN_TRAN_SO,       // vượt quá int32 phần nghìn
+  CAN_QUA_TAI,       // đầu cân báo OL / OVER
+};
+
+enum {
+  DON_VI_KHONG_RO = 0,
+  DON_VI_KG,
+  DON_VI_G,
+  DON_VI_LB,
+};
+
+enum {
+  ON_DINH_KHONG_RO = 0,
+  ON_DINH,           // tiền tố ST
+  CHUA_ON_DINH,      // tiền tố US
+};
+
+typedef struct {
+  int32_t phanNghin;  // giá trị * 1000, làm tròn nửa lên ở chữ số thập phân thứ tư
+  uint8_t trangThai;  // CAN_*
+  uint8_t donVi;      // DON_VI_*
+  uint8_t onDinh;     // ON_DINH_*
+  uint8_t soChuSoLe;  // số chữ số sau dấu chấm đầu cân in ra
+} ket_qua_can;
+
+inline bool laChuSo(char c) { return c >= '0' && c <= '9'; }
+inline char chuHoa(char c) { return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c; }
+inline bool laChuCai(char c) { return chuHoa(c) >= 'A' && chuHoa(c) <= 'Z'; }
+
+// So khớp không phân biệt hoa thường; caTu: từ phải kết thúc (không theo sau bởi chữ cái),
+// không thì chỉ cần bắt đầu bằng tu
+inline bool khopTu(const char* p, const char* het, const char* tu, bool caTu = true) {
+  while (*tu) {
+    if (p >= het || chuHoa(*p) != *tu) return false;
+    p++;
+    tu++;
+  }
+  return !caTu || p >= het || !laChuCai(*p);
+}
+
+inline ket_qua_can phanTichCan(const char* dau, size_t doDai) {
+  ket_qua_can kq = { 0, CAN_RONG, DON_VI_KHONG_RO, ON_DINH_KHONG_RO, 0 };
+  const char* p = dau;
+  const char* het = dau + doDai;
+
+  // Bỏ khung STX/ETX, khoảng trắng và CR/LF ở hai đầu
+  while (p < het && (*p == 0x02 || *p == ' ' || *p == '\t')) p++;
+  while (het > p && (het[-1] == 0x03 || het[-1] == ' ' || het[-1] == '\t' ||
+                     het[-1] == '\r' || het[-1] == '\n' || het[-1] == '\0')) het--;
+  if (p >= het) return kq;
+
+  // Tiền tố trạng thái trước con số (chỉ xét ở đầu từ)
+  const char* q = p;
+  while (q < het && !laChuSo(*q)) {
+    if (q > p && laChuCai(q[-1])) {
+      q++;
+      continue;
+    }
+    if (khopTu(q, het, "OL") || khopTu(q, het, "OVER", false)) {
+      kq.trangThai = CAN_QUA_TAI;
+      return kq;
+    }
+    if (khopTu(q, het, "ST")) kq.onDinh = ON_DINH;
+    else if (khopTu(q, het, "US")) kq.onDinh = CHUA_ON_DINH;
+    q++;
+  }
+  if (q >= het) {
+    kq.trangThai = CAN_KHONG_CO_SO;
+    return kq;
+  }
+
+  // Dấu đứng ngay trước chữ số đầu tiên (cho phép khoảng trắng xen giữa, vd "-   12.5")
+  bool am = false;
+  for (const char* s = q - 1; s >= p; s--) {
+    if (*s == ' ') continue;
+    am = (*s == '-');
+    break;
+  }
+
+  // Phần nguyên
+  const int64_t gioiHan = (int64_t)INT32_MAX + 1;
+  int64_t phanNguyen = 0;
+  while (q < het && laChuSo(*q)) {
+    phanNguyen = phanNguyen * 10 + (*q - '0');
+    if (phanNguyen > gioiHan / 1000) {
+      kq.trangThai = CAN_TRAN_SO;
+      return kq;
+    }
+    q++;
+  }
+  int64_t giaTri = phanNguyen * 1000;
+
+  // Phần thập phân: giữ 3 chữ số, chữ số thứ tư để làm tròn, bỏ phần còn lại
+  if (q < het && *q == '.') {
+    q++;
+    int32_t heSo = 100;
+    while (q < het && laChuSo(*q)) {
+      if (kq.soChuSoLe < 3) giaTri += (*q - '0') * heSo;
+      else if (kq.soChuSoLe == 3 && *q >= '5') giaTri += 1;
+      heSo /= 10;
+      kq.soChuSoLe++;
+      q++;
+    }
+  }
+  if (giaTri > gioiHan - (am ? 0 : 1)) {
+    kq.trangThai = CAN_TRAN_SO;
+    return kq;
+  }
+  kq.phanNghin = (int32_t)(am ? -giaTri : giaTri);
+
+  // Đơn vị sau con số
+  while (q < het && *q == ' ') q++;
+  if (khopTu(q, het, "KG")) kq.donVi = DON_VI_KG;
+  else if (khopTu(q, het, "G")) kq.donVi = DON_VI_G;
+  else if (khopTu(q, het, "LB")) kq.donVi = DON_VI_LB;
+
+  kq.trangThai = CAN_OK;
+  return kq;
+}
+
+// Ghi số phần nghìn ra chuỗi thập phân 3 chữ số lẻ ("-12.345"), trả về số ký tự như snprintf
+inline int dinhDangPhanNghin(int32_t phanNghin, char* ra, size_t n) {
+  uint32_t triTuyetDoi = phanNghin < 0 ? (uint32_t)0 - (uint32_t)phanNghin : (uint32_t)phanNghin;
+  return snprintf(ra, n, "%s%lu.%03lu", phanNghin < 0 ? "-" : "",
+                  (unsigned long)(triTuyetDoi / 1000), (unsigned long)(triTuyetDoi % 1000));
+}
+
+// Khối lượng lần 1 trạm 2 lưu trên thẻ (chuỗi do dinhDangPhanNghin ghi). false nếu chưa có:
+// block trống, "0", "0.00" hay nội dung hỏng đều coi là lần chạm thứ nhất.
+inline bool docKhoiLuongLan1(const char* khoi, int32_t& phanNghin) {
+  size_t doDai = 0;
+  while (doDai < 16 && khoi[doDai]) doDai++;
+  ket_qua_can kq = phanTichCan(khoi, doDai);
+  if (kq.trangThai != CAN_OK || kq.phanNghin == 0) return false;
+  phanNghin = kq.phanNghin;
+  return true;
+}
+
+// Tỉ lệ lần 2 / lần 1 (hàm lượng TSC) theo phần nghìn, làm tròn; lần 1 không dương thì 0
+inline int32_t tinhTiLe(int32_t lan1, int32_t lan2) {
+  return lan1 > 0 ? (int32_t)(((int64_t)lan2 * 1000 + lan1 / 2) / lan1) : 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <Preferences.h>
+#include "Log2Histogram.h"
+
+// Quản lý kết nối WiFi (STA) của gateway, chạy nền: setup() không còn đứng chờ WiFi và mất AP giữa
+// chừng thì tự kết nối lại thay vì upload thất bại âm thầm cho tới khi khởi động lại.
+//
+// Sau mỗi lần có IP, BSSID, kênh và cấu hình IP được lưu vào NVS (chỉ ghi khi đổi). Lần kết nối sau
+// dùng đường nhanh: WiFi.begin() với kênh + BSSID (không quét mọi kênh) và IP tĩnh (không chờ DHCP).
+// kSoLanNhanh lần nhanh liền nhau thất bại (AP đổi kênh, đổi router...) thì quay về quét đầy đủ + DHCP
+// và học lại thông số. IP tĩnh là IP DHCP đã cấp lần trước, nên router cần giữ lease cho MAC gateway.
+//
+// ESP-NOW dùng chung radio: quét đầy đủ kéo radio khỏi kênh của các trạm cân, nên chỉ dùng khi đường
+// nhanh không được, và giữa các lần thử radio được trả về kênh đã lưu để vẫn nhận khung từ trạm cân.
+// Sự kiện WiFi (task sự kiện Arduino) chỉ đổi cờ và đánh thức task này; đo đạc và in Serial ở đây.
+class WiFiLink {
+public:
+  static const uint8_t kSoLanNhanh = 3;
+  static const uint32_t kChoNhanh = 4000;   // ms chờ có IP ở đường nhanh
+  static const uint32_t kChoDay = 15000;    // ms chờ có IP khi quét đầy đủ
+  static const uint32_t kLuiToiDa = 30000;  // ms nghỉ tối đa giữa hai lần thử
+
+  WiFiLink(const char* ssid, const char* pass) : ssid_(ssid), pass_(pass) {}
+
+  // Gọi sau WiFi.mode(): đưa radio về kênh đã lưu (ESP-NOW nhận được ngay) rồi kết nối trong nền
+  bool begin(UBaseType_t uuTien = 2, BaseType_t core = 1) {
+    hienTai_ = this;
+    WiFi.persistent(false);        // thông số do NVS "wifi" giữ, không ghi lại cấu hình WiFi mỗi lần begin()
+    WiFi.setAutoReconnect(false);  // kết nối lại do task này, không tranh với thư viện
+    WiFi.onEvent(onWiFiEvent);
+    coLuu_ = docLuu(luu_);
+    if (coLuu_) esp_wifi_set_channel(luu_.kenh, WIFI_SECOND_CHAN_NONE);
+    return xTaskCreatePinnedToCore(taskEntry, "wifi", 4096, this, uuTien, &task_, core) == pdPASS;
+  }
+
+  bool connected() const { return daKetNoi_; }
+  uint8_t channel() const { return coLuu_ ? luu_.kenh : 0; }
+
+  uint32_t dropCount() const { return soLanMat_; }
+  uint32_t reconnectCount() const { return soLanKetNoiLai_; }
+  uint32_t fastConnectCount() const { return soLanNhanh_; }
+  uint32_t fullConnectCount() const { return soLanDay_; }
+  uint32_t failedAttemptCount() const { return soLanLoi_; }
+  // Tổng thời gian mất kết nối kể cả lần đang mất (ms)
+  uint32_t outageTotalMs() const { return tongMat_ + currentOutageMs(); }
+  uint32_t currentOutageMs() const { return !daKetNoi_ && matLuc_ ? millis() - matLuc_ : 0; }
+
+  // Bắt đầu lần thử -> có IP (ms), mọi lần kết nối thành công
+  const Log2Histogram& connectMs() const { return tgKetNoi_; }
+  // Mất kết nối -> có IP trở lại (ms)
+  const Log2Histogram& outageMs() const { return tgMat_; }
+
+private:
+  // Thông số lần kết nối thành công gần nhất, lưu nguyên khối trong NVS "wifi"/"ketnoi"
+  typedef struct {
+    uint8_t bssid[6];
+    uint8_t kenh;
+    uint32_t ip, gateway, mask, dns;
+  } thong_so;
+
+  static void taskEntry(void* thamSo) { static_cast<WiFiLink*>(thamSo)->chay(); }
+
+  static void onWiFiEvent(arduino_event_id_t suKien, arduino_event_info_t thongTin) {
+    WiFiLink* l = hienTai_;
+    if (suKien == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+      l->daKetNoi_ = true;
+    } else if (suKien == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+      l->lyDo_ = thongTin.wifi_sta_disconnected.reason;
+      if (l->daKetNoi_) {
+        l->daKetNoi_ = false;
+        l->matLuc_ = millis();
+        l->soLanMat_++;
+      }
+    } else {
+      return;
+    }
+    xTaskNotifyGive(l->task_);
+  }
+
+  void chay() {
+    uint32_t nghi = 1000;
+    uint8_t soLanNhanhLoi = 0;
+    for (;;) {
+      if (daKetNoi_) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // chờ sự kiện mất kết nối
+        if (!daKetNoi_) Serial.printf("Mất WiFi (lý do %u), kết nối lại...\n", (unsigned)lyDo_);
+        continue;
+      }
+
+      bool nhanh = coLuu_ && soLanNhanhLoi < kSoLanNhanh;
+      uint32_t han = nhanh ? kChoNhanh : kChoDay;
+      uint32_t batDau = millis();
+      batDauKetNoi(nhanh);
+      while (!daKetNoi_ && millis() - batDau < han) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(han - (millis() - batDau)));
+      }
+
+      if (daKetNoi_) {
+        daCoIp(nhanh, millis() - batDau);
+        nghi = 1000;
+        soLanNhanhLoi = 0;
+        continue;
+      }
+
+      soLanLoi_++;
+      if (nhanh) soLanNhanhLoi++;
+      else soLanNhanhLoi = 0;  // quét đầy đủ cũng không được: lần sau lại thử đường nhanh trước
+      WiFi.disconnect();
+      if (coLuu_) esp_wifi_set_channel(luu_.kenh, WIFI_SECOND_CHAN_NONE);
+      Serial.printf("Kết nối WiFi (%s) thất bại, lý do %u, thử lại sau %lu ms\n", nhanh ? "nhanh" : "quét",
+                    (unsigned)lyDo_, (unsigned long)nghi);
+      vTaskDelay(pdMS_TO_TICKS(nghi));
+      nghi = nghi * 2 < kLuiToiDa ? nghi * 2 : kLuiToiDa;
+    }
+  }
+
+  void batDauKetNoi(bool nhanh) {
+    if (nhanh) {
+      WiFi.config(IPAddress(luu_.ip), IPAddress(luu_.gateway), IPAddress(luu_.mask), IPAddress(luu_.dns));
+      WiFi.begin(ssid_, pass_, luu_.kenh, luu_.bssid);
+    } else {
+      WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));  // về DHCP
+      WiFi.begin(ssid_, pass_);
+    }
+  }
+
+  void daCoIp(bool nhanh, uint32_t thoiGian) {
+    tgKetNoi_.record(thoiGian);
+    if (nhanh) soLanNhanh_++;
+    else soLanDay_++;
+    if (matLuc_) {
+      uint32_t mat = millis() - matLuc_;
+      tgMat_.record(mat);
+      tongMat_ += mat;
+      soLanKetNoiLai_++;
+      matLuc_ = 0;
+      Serial.printf("WiFi kết nối lại sau %lu ms mất kết nối\n", (unsigned long)mat);
+    }
+
+    thong_so moi;
+    memcpy(moi.bssid, WiFi.BSSID(), 6);
+    moi.kenh = WiFi.channel();
+    moi.ip = WiFi.localIP();
+    moi.gateway = WiFi.gatewayIP();
+    moi.mask = WiFi.subnetMask();
+    moi.dns = WiFi.dnsIP();
+    if (!coLuu_ || memcmp(&moi, &luu_, sizeof(moi)) != 0) {
+      luu_ = moi;
+      coLuu_ = true;
+      ghiLuu(luu_);
+    }
+    Serial.printf("WiFi connected (%s, %lu ms), IP: %s, kênh %u\n", nhanh ? "nhanh" : "quét", (unsigned long)thoiGian,
+                  WiFi.localIP().toString().c_str(), (unsigned)moi.kenh);
+  }
+
+  static bool docLuu(thong_so& ra) {
+    Preferences prefs;
+    prefs.begin("wifi", true);
+    bool co = prefs.getBytes("ketnoi", &ra, sizeof(ra)) == sizeof(ra);
+    prefs.end();
+    return co && ra.kenh >= 1 && ra.kenh <= 13 && ra.ip != 0;
+  }
+
+  static void ghiLuu(const thong_so& ts) {
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putBytes("ketnoi", &ts, sizeof(ts));
+    prefs.end();
+  }
+
+  static WiFiLink* hienTai_;
+
+  const char* ssid_;
+  const char* pass_;
+  TaskHandle_t task_ = NULL;
+  thong_so luu_;
+  bool coLuu_ = false;
+  volatile bool daKetNoi_ = false;
+  volatile uint8_t lyDo_ = 0;
+  volatile uint32_t matLuc_ = 0;  // millis() lúc mất kết nối, 0 khi đang kết nối hoặc chưa từng kết nối
+  uint32_t soLanMat_ = 0;
+  uint32_t soLanKetNoiLai_ = 0;
+  uint32_t soLanNhanh_ = 0;
+  uint32_t soLanDay_ = 0;
+  uint32_t soLanLoi_ = 0;
+  uint32_t tongMat_ = 0;
+  Log2Histogram tgKetNoi_;
+  Log2Histogram tgMat_;
+};
+
+WiFiLink* WiFiLink::hienTai_ = nullptr;
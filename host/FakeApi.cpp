@@ -0,0 +1,186 @@
+#include "FakeApi.h"
+
+#include <string.h>
+#include "ArduinoJson.h"
+#include "MoPhong.h"
+
+namespace {
+
+const int kHetGioDoc = -11;  // HTTPC_ERROR_READ_TIMEOUT
+
+long homNay() { return mophong::gioThuc() / 86400; }
+
+std::string chiTiet(const char* noiDung) { return std::string("{\"detail\":\"") + noiDung + "\"}"; }
+
+}  // namespace
+
+int FakeApi::xuLy(const std::string& phuongThuc, const std::string& url, const std::string& than, std::string& traVe) {
+  static const char kTen[] = "/khachhang/by-rfid/";
+  if (phuongThuc == "POST" && url.find("/giaodich/batch/") != std::string::npos) return xuLyLo(than, traVe);
+  size_t p = url.find(kTen);
+  if (phuongThuc != "GET" || p == std::string::npos) {
+    traVe = chiTiet("Not Found");
+    return 404;
+  }
+  soHoiTen_++;
+  std::string rfid = url.substr(p + strlen(kTen));
+  auto it = khach_.find(rfid);
+  if (it == khach_.end()) {
+    traVe = chiTiet("RFID not found");
+    return 404;
+  }
+  JsonDocument doc;
+  doc["RFID"] = rfid;
+  doc["HoVaTen"] = it->second;
+  doc["TenHienThi"] = it->second;
+  serializeJson(doc, traVe);
+  return 200;
+}
+
+// process_giaodich_batch: từng phần tử theo thứ tự, lỗi của một phần tử không ảnh hưởng phần tử khác
+int FakeApi::xuLyLo(const std::string& than, std::string& traVe) {
+  soRequestLo_++;
+  int maTraVe = 200;
+  if (soLanLoi_ > 0) {
+    soLanLoi_--;
+    if (maLoi_ != kHetGioDoc) {
+      traVe = maLoi_ > 0 ? chiTiet("Service Unavailable") : std::string();
+      return maLoi_;
+    }
+    maTraVe = maLoi_;
+  }
+
+  JsonDocument doc;
+  DeserializationError loiDoc = deserializeJson(doc, than);
+  JsonArray danhSach = doc["DanhSach"].as<JsonArray>();
+  if (loiDoc || danhSach.size() == 0 || danhSach.size() > 100) {
+    traVe = chiTiet("DanhSach must contain 1..100 items");
+    return 422;
+  }
+  if (serverCu_) {
+    for (JsonObject item : danhSach) {
+      if ((item["LoaiCan"] | -1) != 0) continue;
+      traVe = chiTiet("LoaiCan must be 1, 2 or 3");
+      return 422;
+    }
+  }
+
+  JsonDocument ra;
+  JsonArray ketQua = ra["KetQua"].to<JsonArray>();
+  int viTri = 0;
+  for (JsonObject item : danhSach) {
+    soPhanTu_++;
+    int loaiCan = item["LoaiCan"] | -1;
+    std::string rfid = item["RFID"] | "";
+    std::string maCan = item["MaCan"] | "";
+    uint32_t soThuTu = item["SoThuTu"] | 0LL;
+    double muTap = item["KhoiLuongMuTap"] | 0.0;
+    double muNuoc = item["KhoiLuongMuNuoc"] | 0.0;
+    double tsc = item["TSC"] | 0.0;
+    double drc = item["DRC"] | 0.0;
+    int id = 0;
+    std::string loi;
+    int trangThai;
+
+    auto daCo = daXuLy_.find(std::make_pair(maCan, soThuTu));
+    if (loaiCan != 0 && daCo != daXuLy_.end()) {
+      // Gateway gửi lại lần cân đã áp dụng (mất phản hồi)
+      soDaApDung_++;
+      id = daCo->second;
+      loi = "Already applied";
+      trangThai = 200;
+    } else if (loaiCan != 0) {
+      trangThai = apDung(loaiCan, maCan, soThuTu, rfid, muTap, muNuoc, tsc, drc, id, loi);
+    } else {
+      // Giao dịch ghép: khoá của từng phần, áp dụng các phần còn thiếu như khi gửi từng phần
+      soPhanTuGhep_++;
+      std::vector<std::pair<int, std::pair<std::string, uint32_t>>> thieu;
+      size_t soPhan = 0;
+      for (JsonObject phan : item["CacPhan"].as<JsonArray>()) {
+        soPhan++;
+        std::pair<std::string, uint32_t> khoa(phan["MaCan"] | "", (uint32_t)(phan["SoThuTu"] | 0LL));
+        if (daXuLy_.count(khoa)) id = daXuLy_[khoa];
+        else thieu.push_back(std::make_pair(phan["LoaiCan"] | -1, khoa));
+      }
+      if (soPhan == 0) thieu.push_back(std::make_pair(1, std::make_pair(maCan, soThuTu)));
+      trangThai = 201;
+      if (thieu.size() < soPhan || soPhan == 0) {
+        for (size_t i = 0; i < thieu.size() && trangThai < 400; i++) {
+          int ma = apDung(thieu[i].first, thieu[i].second.first, thieu[i].second.second, rfid, muTap, muNuoc, tsc,
+                          drc, id, loi);
+          if (ma >= 400) trangThai = ma;
+        }
+      } else if (!(muTap > 0) || !(muNuoc > 0) || !(tsc > 0) || !(drc > 0)) {
+        loi = "KhoiLuongMuTap, KhoiLuongMuNuoc, TSC and DRC must be greater than 0";
+        trangThai = 422;
+      } else if (!khach_.count(rfid)) {
+        loi = "RFID not found";
+        trangThai = 400;
+      } else {
+        GiaoDich g = { (int)giaoDich_.size() + 1, rfid, homNay(), muTap, muNuoc, tsc, drc };
+        giaoDich_.push_back(g);
+        id = g.id;
+        for (const auto& p : thieu) daXuLy_[p.second] = id;
+      }
+    }
+
+    if (trangThai >= 400) soTuChoi_++;
+    JsonObject o = ketQua.add<JsonObject>();
+    o["ViTri"] = viTri++;
+    o["TrangThai"] = trangThai;
+    if (!loi.empty()) o["ChiTiet"] = loi;
+    if (trangThai < 400) o["IDGiaoDich"] = id;
+  }
+  serializeJson(ra, traVe);
+  return maTraVe;
+}
+
+// create_giaodich_mu_tap / update_giaodich_mu_nuoc / update_giaodich_tsc_drc
+int FakeApi::apDung(int loaiCan, const std::string& maCan, uint32_t soThuTu, const std::string& rfid, double muTap,
+                    double muNuoc, double tsc, double drc, int& id, std::string& chiTiet) {
+  std::pair<std::string, uint32_t> khoa(maCan, soThuTu);
+  auto daCo = daXuLy_.find(khoa);
+  if (daCo != daXuLy_.end()) {
+    id = daCo->second;
+    return 200;
+  }
+  double giaTri = loaiCan == 1 ? muTap : loaiCan == 2 ? muNuoc : tsc;
+  if (loaiCan < 1 || loaiCan > 3 || rfid.empty() || maCan.empty()) {
+    chiTiet = "LoaiCan, RFID, MaCan required";
+    return 422;
+  }
+  if (!(giaTri > 0) || (loaiCan == 3 && !(drc > 0))) {
+    chiTiet = "KhoiLuongMuTap, KhoiLuongMuNuoc, TSC and DRC must be greater than 0";
+    return 422;
+  }
+  if (!khach_.count(rfid)) {
+    chiTiet = "RFID not found";
+    return 400;
+  }
+  if (loaiCan == 1) {
+    GiaoDich g = { (int)giaoDich_.size() + 1, rfid, homNay(), muTap, 0, 0, 0 };
+    giaoDich_.push_back(g);
+    id = daXuLy_[khoa] = g.id;
+    return 201;
+  }
+  GiaoDich* g = moiNhatHomNay(rfid);
+  if (!g) {
+    chiTiet = "No GiaoDich found for today";
+    return 404;
+  }
+  if (loaiCan == 2) {
+    g->muNuoc = muNuoc;
+  } else {
+    g->tsc = tsc;
+    g->drc = drc;
+  }
+  id = daXuLy_[khoa] = g->id;
+  return 200;
+}
+
+FakeApi::GiaoDich* FakeApi::moiNhatHomNay(const std::string& rfid) {
+  long ngay = homNay();
+  for (auto it = giaoDich_.rbegin(); it != giaoDich_.rend(); ++it)
+    if (it->rfid == rfid && it->ngay == ngay) return &*it;
+  return nullptr;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// API cục bộ thu nhỏ cho mô phỏng (cùng quy tắc với API/crud.py): POST /giaodich/batch/ và
+// GET /khachhang/by-rfid/<RFID>. Giữ giao dịch theo khách hàng và ngày UTC, khoá chống trùng
+// (MaCan, SoThuTu) của từng lần cân đã áp dụng; lần cân gửi lại trả "Already applied".
+class FakeApi {
+public:
+  struct GiaoDich {
+    int id;
+    std::string rfid;
+    long ngay;  // ngày UTC (số ngày từ 1970)
+    double muTap, muNuoc, tsc, drc;
+  };
+
+  void themKhach(const std::string& rfid, const std::string& tenHienThi) { khach_[rfid] = tenHienThi; }
+  // soLan request lô tới trả ma mà không áp dụng gì (ma <= 0: lỗi kết nối, vd. -1); riêng -11 (hết
+  // giờ đọc) thì server đã áp dụng cả lô nhưng phản hồi không về tới gateway
+  void loiLanToi(int soLan, int ma) {
+    soLanLoi_ = soLan;
+    maLoi_ = ma;
+  }
+  // Server trước khi hỗ trợ giao dịch ghép: LoaiCan 0 làm cả request bị 422
+  void datServerCu(bool cu) { serverCu_ = cu; }
+
+  // Gắn vào mophong::datMayChuHttp
+  int xuLy(const std::string& phuongThuc, const std::string& url, const std::string& than, std::string& traVe);
+
+  const std::vector<GiaoDich>& giaoDich() const { return giaoDich_; }
+  uint32_t soRequestLo() const { return soRequestLo_; }
+  uint32_t soPhanTu() const { return soPhanTu_; }
+  uint32_t soPhanTuGhep() const { return soPhanTuGhep_; }
+  uint32_t soDaApDung() const { return soDaApDung_; }
+  uint32_t soTuChoi() const { return soTuChoi_; }
+  uint32_t soHoiTen() const { return soHoiTen_; }
+
+private:
+  int xuLyLo(const std::string& than, std::string& traVe);
+  int apDung(int loaiCan, const std::string& maCan, uint32_t soThuTu, const std::string& rfid, double muTap,
+             double muNuoc, double tsc, double drc, int& id, std::string& chiTiet);
+  GiaoDich* moiNhatHomNay(const std::string& rfid);
+
+  std::map<std::string, std::string> khach_;                   // RFID -> TenHienThi
+  std::vector<GiaoDich> giaoDich_;
+  std::map<std::pair<std::string, uint32_t>, int> daXuLy_;  // (MaCan, SoThuTu) -> IDGiaoDich
+  int soLanLoi_ = 0;
+  int maLoi_ = 0;
+  bool serverCu_ = false;
+  uint32_t soRequestLo_ = 0;
+  uint32_t soPhanTu_ = 0;
+  uint32_t soPhanTuGhep_ = 0;
+  uint32_t soDaApDung_ = 0;
+  uint32_t soTuChoi_ = 0;
+  uint32_t soHoiTen_ = 0;
+};
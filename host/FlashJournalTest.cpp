@@ -0,0 +1,104 @@
+#include <string.h>
+#include "FlashJournal.h"
+#include "LittleFS.h"
+#include "KiemTra.h"
+#include "MoPhong.h"
+
+// FlashJournal trên LittleFS của một nút mô phỏng (tệp trong RAM, dung lượng flash đặt được để ghi
+// dở một bản ghi). Mọi kiểm tra chạy trong setup() của nút.
+
+struct BanGhi {
+  uint32_t so;
+  uint8_t duLieu[20];
+};
+
+typedef FlashJournal<BanGhi> Journal;
+
+static mophong::Nut* nut;
+
+static BanGhi banGhi(uint32_t so) {
+  BanGhi b;
+  b.so = so;
+  memset(b.duLieu, (uint8_t)so, sizeof(b.duLieu));
+  return b;
+}
+
+// Đọc mọi bản ghi chưa xác nhận, so với danh sách số mong đợi
+static void kiemTraConLai(Journal& j, const uint32_t* mongDoi, size_t n) {
+  KIEM_TRA_BANG(j.pendingCount(), n);
+  BanGhi ra[8];
+  uint32_t soThuTu = j.commitSeq();
+  size_t soDaDoc = j.read(soThuTu, ra, 8);
+  KIEM_TRA_BANG(soDaDoc, n);
+  for (size_t i = 0; i < soDaDoc && i < n; i++) {
+    KIEM_TRA_BANG(ra[i].so, mongDoi[i]);
+    KIEM_TRA(ra[i].duLieu[sizeof(ra[i].duLieu) - 1] == (uint8_t)mongDoi[i]);
+  }
+}
+
+// Ghi dở: đầu bản ghi vào được flash, phần dữ liệu thì không. Các bản ghi ghi sau đó (kể cả sau khi
+// khởi động lại) vẫn phải đọc lại được.
+static void ghiDo() {
+  Journal j(LittleFS, "/ghi_do", 4096);
+  KIEM_TRA(j.begin());
+  KIEM_TRA(j.append(banGhi(1)));
+  KIEM_TRA(j.append(banGhi(2)));
+
+  mophong::datDungLuongFlash(nut, LittleFS.usedBytes() + sizeof(Journal::DauBanGhi) + sizeof(BanGhi) - 1);
+  KIEM_TRA(!j.append(banGhi(3)));
+  KIEM_TRA(!j.append(banGhi(3)));  // vẫn đầy: không nén được, không ghi sau phần rác
+  mophong::datDungLuongFlash(nut, 1024 * 1024);
+
+  uint32_t soThuTu = 0;
+  KIEM_TRA(j.append(banGhi(4), &soThuTu));
+  KIEM_TRA_BANG(soThuTu, 2);
+  KIEM_TRA(j.append(banGhi(5)));
+  const uint32_t mongDoi[] = { 1, 2, 4, 5 };
+  kiemTraConLai(j, mongDoi, 4);
+
+  // Khởi động lại: quét lúc begin() thấy đủ bốn bản ghi, không có gì bị nén mất
+  Journal sau(LittleFS, "/ghi_do", 4096);
+  KIEM_TRA(sau.begin());
+  kiemTraConLai(sau, mongDoi, 4);
+  KIEM_TRA(sau.commit(sau.commitSeq() + 2));
+  const uint32_t conLai[] = { 4, 5 };
+  kiemTraConLai(sau, conLai, 2);
+}
+
+// Ghi dở khi còn chỗ để nén ngay (chưa có bản ghi chờ gửi nên bản sao chỉ có đầu file): bản ghi
+// kế tiếp không phải nén nữa
+static void ghiDoNenNgay() {
+  Journal j(LittleFS, "/nen_ngay", 4096);
+  KIEM_TRA(j.begin());
+  KIEM_TRA(j.append(banGhi(1)));
+  KIEM_TRA(j.commit(j.endSeq()));
+
+  mophong::datDungLuongFlash(nut, LittleFS.usedBytes() + sizeof(Journal::DauBanGhi) + sizeof(BanGhi) - 1);
+  KIEM_TRA(!j.append(banGhi(2)));
+  mophong::datDungLuongFlash(nut, 1024 * 1024);
+  KIEM_TRA_BANG(j.compactionCount(), 1);
+
+  KIEM_TRA(j.append(banGhi(3)));
+  KIEM_TRA_BANG(j.compactionCount(), 1);
+  const uint32_t mongDoi[] = { 3 };
+  kiemTraConLai(j, mongDoi, 1);
+}
+
+static void chay() {
+  LittleFS.begin();
+  ghiDo();
+  ghiDoNenNgay();
+  mophong::ketThuc(ketQuaKiemTra());
+}
+
+static void lap() {}
+
+int main() {
+  mophong::khoiDong();
+  nut = mophong::taoNut("nut");
+  const mophong::Firmware fw = { "FlashJournalTest", chay, lap };
+  mophong::batNguon(nut, fw);
+  mophong::choDen(1000);
+  fprintf(stderr, "setup() không chạy xong\n");
+  mophong::ketThuc(1);
+}
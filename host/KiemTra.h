@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdio.h>
+
+// Kiểm tra tối giản cho test trên máy tính (không cần thư viện test): sai thì in file:dòng,
+// main() trả về ketQuaKiemTra() để ctest báo lỗi.
+static int soLanSai = 0;
+
+#define KIEM_TRA(dk)                                                   \
+  do {                                                                 \
+    if (!(dk)) {                                                       \
+      fprintf(stderr, "%s:%d: sai: %s\n", __FILE__, __LINE__, #dk);    \
+      soLanSai++;                                                      \
+    }                                                                  \
+  } while (0)
+
+#define KIEM_TRA_BANG(thuc, mongDoi)                                                          \
+  do {                                                                                         \
+    long long thuc_ = (long long)(thuc), mongDoi_ = (long long)(mongDoi);                     \
+    if (thuc_ != mongDoi_) {                                                                   \
+      fprintf(stderr, "%s:%d: %s = %lld, cần %lld\n", __FILE__, __LINE__, #thuc, thuc_, mongDoi_); \
+      soLanSai++;                                                                              \
+    }                                                                                          \
+  } while (0)
+
+inline int ketQuaKiemTra() {
+  if (soLanSai) fprintf(stderr, "%d kiểm tra sai\n", soLanSai);
+  else printf("OK\n");
+  return soLanSai ? 1 : 0;
+}
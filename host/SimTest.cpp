@@ -0,0 +1,278 @@
+// Mô phỏng cả hệ thống: gateway và ba trạm cân chạy firmware thật (Code_ESP32) trên phần cứng giả
+// (sim/), API cục bộ là FakeApi. Kịch bản replay gồm các dòng đầu cân và lần chạm thẻ ghi lại từ trạm
+// thật, sự cố (mất sóng, mất AP, server lỗi, mất điện) và các kiểm tra trên những gì tới được API.
+//
+//   SimTest replay/day_du.txt
+//
+// Mỗi dòng kịch bản: <ms> <đích> <lệnh> [tham số], thời điểm ảo tăng dần; dòng bắt đầu bằng '#' là
+// chú thích. Đích là một nút (gateway, tram1, tram2, tram3), "ap", "api" hoặc "kiem":
+//   <nút> bat | tat                  cấp/ngắt điện (gateway bật lại được một lần: bản firmware thứ hai)
+//   <nút> song bat | tat             radio trong/ngoài vùng sóng ESP-NOW
+//   <nút> the <UID hex> <giữ ms>     đặt thẻ lên đầu đọc, nhấc ra sau <giữ ms>
+//   <nút> uart <dòng>                đầu cân gửi một dòng (\xNN: byte bất kỳ)
+//   <nút> uart_lap <n> <ms> <dòng>   gửi <dòng> n lần, cách nhau <ms>
+//   ap tat | bat | kenh <k>
+//   api khach <UID> <tên>            khách hàng có thẻ UID
+//   api loi <n> <mã>                 n request lô tới trả <mã> (-11: đã áp dụng nhưng mất phản hồi)
+//   api cu                           server chưa hỗ trợ giao dịch ghép (LoaiCan 0)
+//   kiem giaodich <UID> <mủ tạp> <mủ nước> <TSC>   giao dịch mới nhất của thẻ
+//   kiem so_giaodich <n> | tu_choi <n> | da_ap_dung <n> | ghep <n>   bộ đếm của API
+//   kiem metric <tên> <giá trị>      dòng /metrics của gateway
+//   kiem man_hinh <nút> <chữ>        màn hình TFT của nút đang có <chữ>
+//   kiem log <nút> <chữ>             Serial của nút đã in một dòng có <chữ>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "FakeApi.h"
+#include "KiemTra.h"
+#include "MoPhong.h"
+#include "nut/CacNut.h"
+
+using namespace mophong;
+
+namespace {
+
+struct DongKichBan {
+  int so;  // số dòng trong tệp
+  uint64_t ms;
+  std::string dich, lenh, conLai;
+};
+
+const char* tepKichBan = "";
+FakeApi api;
+Nut* gateway;
+Nut* tram[3];
+int soLanBatGateway = 0;
+bool daBatTram[3];
+
+void sai(const DongKichBan& d, const std::string& loi) {
+  fprintf(stderr, "%s:%d: %s\n", tepKichBan, d.so, loi.c_str());
+  soLanSai++;
+}
+
+// Tách một từ ở đầu s (bỏ khoảng trắng), phần còn lại ở s
+std::string tachTu(std::string& s) {
+  size_t dau = s.find_first_not_of(" \t");
+  if (dau == std::string::npos) {
+    s.clear();
+    return std::string();
+  }
+  size_t cuoi = s.find_first_of(" \t", dau);
+  std::string tu = s.substr(dau, cuoi == std::string::npos ? std::string::npos : cuoi - dau);
+  s = cuoi == std::string::npos ? std::string() : s.substr(cuoi + 1);
+  return tu;
+}
+
+// \xNN và \\ trong dòng UART
+std::string giaiMa(const std::string& s) {
+  std::string ra;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '\\' && i + 3 < s.size() && s[i + 1] == 'x') {
+      ra += (char)strtoul(s.substr(i + 2, 2).c_str(), nullptr, 16);
+      i += 3;
+    } else if (s[i] == '\\' && i + 1 < s.size() && s[i + 1] == '\\') {
+      ra += '\\';
+      i++;
+    } else {
+      ra += s[i];
+    }
+  }
+  return ra;
+}
+
+bool docKichBan(const char* tep, std::vector<DongKichBan>& ra) {
+  std::ifstream vao(tep);
+  if (!vao) {
+    fprintf(stderr, "không mở được %s\n", tep);
+    return false;
+  }
+  std::string dong;
+  int so = 0;
+  uint64_t truoc = 0;
+  while (std::getline(vao, dong)) {
+    so++;
+    if (!dong.empty() && dong[dong.size() - 1] == '\r') dong.erase(dong.size() - 1);
+    std::string s = dong;
+    std::string thoiDiem = tachTu(s);
+    if (thoiDiem.empty() || thoiDiem[0] == '#') continue;
+    DongKichBan d;
+    d.so = so;
+    d.ms = strtoull(thoiDiem.c_str(), nullptr, 10);
+    d.dich = tachTu(s);
+    d.lenh = tachTu(s);
+    d.conLai = s;
+    if (d.ms < truoc || d.lenh.empty()) {
+      fprintf(stderr, "%s:%d: dòng không hợp lệ (thời điểm phải tăng dần)\n", tep, so);
+      return false;
+    }
+    truoc = d.ms;
+    ra.push_back(d);
+  }
+  return true;
+}
+
+Nut* nutTheoTen(const std::string& ten) {
+  if (ten == "gateway") return gateway;
+  for (Nut* n : tram)
+    if (ten == tenNut(n)) return n;
+  return nullptr;
+}
+
+void batNguonNut(const DongKichBan& d, Nut* n) {
+  if (n == gateway) {
+    // Biến toàn cục của firmware không khởi tạo lại: mỗi lần bật dùng một bản firmware riêng
+    const Firmware* ban[] = { &kGatewayLan1, &kGatewayLan2 };
+    if (soLanBatGateway >= 2) return sai(d, "gateway chỉ bật được hai lần");
+    batNguon(n, *ban[soLanBatGateway++]);
+    return;
+  }
+  const Firmware* fw[] = { &kTramTapChat, &kTramMuNuoc, &kTramTsc };
+  for (int i = 0; i < 3; i++) {
+    if (n != tram[i]) continue;
+    if (daBatTram[i]) return sai(d, "trạm cân chỉ bật được một lần");
+    daBatTram[i] = true;
+    batNguon(n, *fw[i]);
+  }
+}
+
+// Giá trị của một metric trên /metrics của gateway, -1 nếu không có
+long long docMetric(const std::string& ten) {
+  std::istringstream trang(layTrang(gateway, "/metrics"));
+  std::string dong;
+  while (std::getline(trang, dong)) {
+    if (dong.compare(0, ten.size() + 1, ten + " ") == 0) return atoll(dong.c_str() + ten.size() + 1);
+  }
+  return -1;
+}
+
+void kiemSo(const DongKichBan& d, const char* ten, long long thuc, long long mongDoi) {
+  if (thuc != mongDoi) sai(d, std::string(ten) + " = " + std::to_string(thuc) + ", cần " + std::to_string(mongDoi));
+}
+
+void kiem(const DongKichBan& d) {
+  std::string s = d.conLai;
+  const std::string& loai = d.lenh;
+  if (loai == "giaodich") {
+    std::string uid = tachTu(s);
+    double mongDoi[3];
+    for (double& v : mongDoi) v = atof(tachTu(s).c_str());
+    const FakeApi::GiaoDich* g = nullptr;
+    for (const FakeApi::GiaoDich& x : api.giaoDich())
+      if (x.rfid == uid) g = &x;
+    if (!g) return sai(d, "không có giao dịch của " + uid);
+    double thuc[3] = { g->muTap, g->muNuoc, g->tsc };
+    for (int i = 0; i < 3; i++) {
+      if (fabs(thuc[i] - mongDoi[i]) > 0.005) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "giao dịch %d của %s: %.3f %.3f %.3f, cần %.3f %.3f %.3f", g->id, uid.c_str(),
+                 thuc[0], thuc[1], thuc[2], mongDoi[0], mongDoi[1], mongDoi[2]);
+        return sai(d, buf);
+      }
+    }
+  } else if (loai == "so_giaodich") {
+    kiemSo(d, "số giao dịch", api.giaoDich().size(), atoll(s.c_str()));
+  } else if (loai == "tu_choi") {
+    kiemSo(d, "số phần tử bị từ chối", api.soTuChoi(), atoll(s.c_str()));
+  } else if (loai == "da_ap_dung") {
+    kiemSo(d, "số lần cân gửi lại đã áp dụng", api.soDaApDung(), atoll(s.c_str()));
+  } else if (loai == "ghep") {
+    kiemSo(d, "số phần tử ghép", api.soPhanTuGhep(), atoll(s.c_str()));
+  } else if (loai == "metric") {
+    std::string ten = tachTu(s);
+    kiemSo(d, ten.c_str(), docMetric(ten), atoll(s.c_str()));
+  } else if (loai == "man_hinh" || loai == "log") {
+    Nut* n = nutTheoTen(tachTu(s));
+    std::string chu = s;
+    if (!n) return sai(d, "không có nút này");
+    if (loai == "man_hinh") {
+      std::string mh = manHinh(n);
+      if (mh.find(chu) == std::string::npos) sai(d, "màn hình " + std::string(tenNut(n)) + " không có \"" + chu + "\":\n" + mh);
+      return;
+    }
+    for (const std::string& dong : nhatKy(n))
+      if (dong.find(chu) != std::string::npos) return;
+    sai(d, std::string(tenNut(n)) + " chưa in dòng nào có \"" + chu + "\"");
+  } else {
+    sai(d, "kiểm tra không rõ: " + loai);
+  }
+}
+
+void chay(const DongKichBan& d) {
+  std::string s = d.conLai;
+  if (d.dich == "kiem") return kiem(d);
+  if (d.dich == "ap") {
+    if (d.lenh == "bat" || d.lenh == "tat") datAp(d.lenh == "bat");
+    else if (d.lenh == "kenh") doiKenhAp(atoi(s.c_str()));
+    else sai(d, "lệnh AP không rõ: " + d.lenh);
+    return;
+  }
+  if (d.dich == "api") {
+    if (d.lenh == "khach") {
+      std::string uid = tachTu(s);
+      api.themKhach(uid, s);
+    } else if (d.lenh == "loi") {
+      int soLan = atoi(tachTu(s).c_str());
+      api.loiLanToi(soLan, atoi(s.c_str()));
+    } else if (d.lenh == "cu") {
+      api.datServerCu(true);
+    } else {
+      sai(d, "lệnh API không rõ: " + d.lenh);
+    }
+    return;
+  }
+
+  Nut* n = nutTheoTen(d.dich);
+  if (!n) return sai(d, "không có nút " + d.dich);
+  if (d.lenh == "bat") {
+    batNguonNut(d, n);
+  } else if (d.lenh == "tat") {
+    tatNguon(n);
+  } else if (d.lenh == "song") {
+    datSong(n, s != "tat");
+  } else if (d.lenh == "the") {
+    std::string uid = tachTu(s);
+    datThe(n, uid, atoi(s.c_str()));
+  } else if (d.lenh == "uart") {
+    guiUart(n, giaiMa(s));
+  } else if (d.lenh == "uart_lap") {
+    int soLan = atoi(tachTu(s).c_str());
+    int chuKy = atoi(tachTu(s).c_str());
+    std::string dong = giaiMa(s);
+    for (int i = 0; i < soLan; i++) guiUart(n, dong, i * chuKy);
+  } else {
+    sai(d, "lệnh không rõ: " + d.lenh);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "dùng: %s <kịch bản replay>\n", argv[0]);
+    return 2;
+  }
+  tepKichBan = argv[1];
+  std::vector<DongKichBan> kichBan;
+  if (!docKichBan(tepKichBan, kichBan)) return 2;
+
+  setvbuf(stdout, nullptr, _IOLBF, 0);  // dòng Serial và lỗi kiểm tra (stderr) không xen giữa dòng
+  khoiDong();
+  gateway = taoNut("gateway");
+  tram[0] = taoNut("tram1");
+  tram[1] = taoNut("tram2");
+  tram[2] = taoNut("tram3");
+  datMayChuHttp([](const std::string& phuongThuc, const std::string& url, const std::string& than, std::string& traVe) {
+    return api.xuLy(phuongThuc, url, than, traVe);
+  });
+
+  for (const DongKichBan& d : kichBan) {
+    choDen(d.ms);
+    chay(d);
+  }
+  ketThuc(ketQuaKiemTra());
+}
@@ -0,0 +1,100 @@
+#include <string.h>
+#include "StableWeightFilter.h"
+#include "KiemTra.h"
+
+static ket_qua_can mau(int32_t phanNghin, uint8_t onDinh = ON_DINH_KHONG_RO) {
+  ket_qua_can kq = { phanNghin, CAN_OK, DON_VI_KG, onDinh, 3 };
+  return kq;
+}
+
+// Đủ soMau mẫu có tải trong ngưỡng: trả trung vị ngay ở mẫu thứ soMau
+static void cuaSoOnDinh() {
+  StableWeightFilter loc(5, 20, 50, 1500);
+  int32_t ra = 0;
+  const int32_t day[] = { 12000, 12010, 11995, 12005 };
+  for (int i = 0; i < 4; i++) KIEM_TRA(!loc.push(mau(day[i]), 100 * i, ra));
+  KIEM_TRA(loc.push(mau(12002), 400, ra));
+  KIEM_TRA_BANG(ra, 12002);
+  KIEM_TRA_BANG(loc.lastSettleMs(), 400);
+  KIEM_TRA_BANG(loc.settleTime().count(), 1);
+}
+
+// Dao động quá ngưỡng: chờ tới khi cả cửa sổ nằm trong ngưỡng
+static void daoDong() {
+  StableWeightFilter loc(3, 20, 50, 1500);
+  int32_t ra = 0;
+  KIEM_TRA(!loc.push(mau(10000), 0, ra));
+  KIEM_TRA(!loc.push(mau(10100), 100, ra));
+  KIEM_TRA(!loc.push(mau(10105), 200, ra));  // cửa sổ 10000..10105: chênh 105
+  KIEM_TRA(loc.push(mau(10110), 300, ra));   // cửa sổ 10100..10110: chênh 10
+  KIEM_TRA_BANG(ra, 10105);
+  KIEM_TRA_BANG(loc.lastSettleMs(), 300);
+}
+
+// Tiền tố ST nhận ngay, US xoá cửa sổ
+static void tienToTrangThai() {
+  StableWeightFilter loc(5, 20, 50, 1500);
+  int32_t ra = 0;
+  KIEM_TRA(!loc.push(mau(8000), 0, ra));
+  KIEM_TRA(loc.push(mau(8040, ON_DINH), 250, ra));
+  KIEM_TRA_BANG(ra, 8040);
+  KIEM_TRA_BANG(loc.lastSettleMs(), 250);
+
+  for (int i = 0; i < 4; i++) KIEM_TRA(!loc.push(mau(5000), 1000 + i, ra));
+  KIEM_TRA(!loc.push(mau(5000, CHUA_ON_DINH), 1004, ra));
+  KIEM_TRA(!loc.push(mau(5000), 1005, ra));  // cửa sổ bắt đầu lại từ đây
+  for (int i = 0; i < 3; i++) KIEM_TRA(!loc.push(mau(5000), 1006 + i, ra));
+  KIEM_TRA(loc.push(mau(5000), 1009, ra));
+  KIEM_TRA_BANG(ra, 5000);
+  KIEM_TRA_BANG(loc.lastSettleMs(), 9);  // tính từ mẫu có tải đầu tiên, kể cả mẫu US
+}
+
+// Dưới ngưỡng có tải hoặc dòng lỗi: không bao giờ ra kết quả
+static void khongTai() {
+  StableWeightFilter loc(3, 20, 50, 1500);
+  int32_t ra = 0;
+  for (int i = 0; i < 10; i++) KIEM_TRA(!loc.push(mau(i % 2 ? 49 : -49), i, ra));
+  KIEM_TRA(!loc.idle(100000, ra));
+  ket_qua_can quaTai = { 0, CAN_QUA_TAI, DON_VI_KHONG_RO, ON_DINH_KHONG_RO, 0 };
+  KIEM_TRA(!loc.push(quaTai, 20, ra));
+  KIEM_TRA(!loc.push(mau(-3000), 30, ra));
+  KIEM_TRA(!loc.push(mau(-3000), 31, ra));
+  KIEM_TRA(loc.push(mau(-3000), 32, ra));  // tải âm (trừ bì) vẫn là có tải
+  KIEM_TRA_BANG(ra, -3000);
+}
+
+// Đầu cân in khi bấm nút: im lặng đủ lâu sau mẫu có tải thì idle() trả mẫu đó
+static void imLang() {
+  StableWeightFilter loc(5, 20, 50, 1500);
+  int32_t ra = 0;
+  KIEM_TRA(!loc.push(mau(12300), 6000, ra));
+  KIEM_TRA(!loc.idle(7000, ra));
+  KIEM_TRA(loc.idle(7500, ra));
+  KIEM_TRA_BANG(ra, 12300);
+  KIEM_TRA(!loc.idle(9000, ra));  // đã trả, reset()
+
+  // Mẫu cuối bị báo US: không trả
+  KIEM_TRA(!loc.push(mau(12300, CHUA_ON_DINH), 10000, ra));
+  KIEM_TRA(!loc.idle(20000, ra));
+
+  // Các mẫu còn trong cửa sổ chênh quá ngưỡng: không trả
+  loc.reset();
+  KIEM_TRA(!loc.push(mau(12000), 30000, ra));
+  KIEM_TRA(!loc.push(mau(12500), 30100, ra));
+  KIEM_TRA(!loc.idle(40000, ra));
+
+  // Mẫu cuối không tải: không trả
+  loc.reset();
+  KIEM_TRA(!loc.push(mau(12000), 50000, ra));
+  KIEM_TRA(!loc.push(mau(0), 50100, ra));
+  KIEM_TRA(!loc.idle(60000, ra));
+}
+
+int main() {
+  cuaSoOnDinh();
+  daoDong();
+  tienToTrangThai();
+  khongTai();
+  imLang();
+  return ketQuaKiemTra();
+}
@@ -0,0 +1,45 @@
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include "StableWeightFilter.h"
+
+// Đo tốc độ trên máy tính của các hàm chạy trên mỗi dòng đầu cân. Số tuyệt đối khác ESP32 nhiều lần,
+// dùng để so sánh trước/sau khi sửa. Chạy: WeightBench [số vòng]
+
+static volatile int32_t chongToiUu;
+
+template <class F>
+static void doTocDo(const char* ten, long soVong, F f) {
+  auto batDau = std::chrono::steady_clock::now();
+  for (long i = 0; i < soVong; i++) f(i);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - batDau).count();
+  printf("%-44s %8.1f ns/lần\n", ten, ns / soVong);
+}
+
+int main(int argc, char** argv) {
+  long soVong = argc > 1 ? atol(argv[1]) : 2000000;
+
+  const char* cacDong[] = { "  12.34 kg", "\x02 ST,GS,+0012.34kg\x03", "US,NT,  1.20 kg\r\n", "OVERLOAD" };
+  size_t doDai[4];
+  for (int i = 0; i < 4; i++) doDai[i] = strlen(cacDong[i]);
+  for (int i = 0; i < 4; i++) {
+    char ten[64];
+    snprintf(ten, sizeof(ten), "phanTichCan(\"%s\")", i == 1 ? "<STX> ST,GS,+0012.34kg<ETX>" : i == 2 ? "US,NT,  1.20 kg\\r\\n" : cacDong[i]);
+    doTocDo(ten, soVong, [&](long) { chongToiUu = phanTichCan(cacDong[i], doDai[i]).phanNghin; });
+  }
+
+  char buf[16];
+  doTocDo("dinhDangPhanNghin", soVong, [&](long n) { chongToiUu = dinhDangPhanNghin((int32_t)n * 7 - 1000000, buf, sizeof(buf)); });
+
+  StableWeightFilter loc(5, 20, 50, 1500);
+  doTocDo("StableWeightFilter::push (5 mẫu, dao động)", soVong, [&](long n) {
+    int32_t ra;
+    ket_qua_can kq = { 12000 + (int32_t)(n % 7) * 5, CAN_OK, DON_VI_KG, ON_DINH_KHONG_RO, 2 };
+    if (loc.push(kq, (uint32_t)n, ra)) chongToiUu = ra;
+  });
+  doTocDo("phanTichCan + push (dòng ổn định)", soVong, [&](long n) {
+    int32_t ra;
+    if (loc.push(phanTichCan(cacDong[0], doDai[0]), (uint32_t)n, ra)) chongToiUu = ra;
+  });
+  return 0;
+}
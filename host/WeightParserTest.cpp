@@ -0,0 +1,131 @@
+#include <string.h>
+#include <limits.h>
+#include "WeightParser.h"
+#include "KiemTra.h"
+
+static ket_qua_can phanTich(const char* dong) { return phanTichCan(dong, strlen(dong)); }
+
+static void kiemTraSo(const char* dong, int32_t phanNghin, uint8_t donVi, uint8_t onDinh) {
+  ket_qua_can kq = phanTich(dong);
+  if (kq.trangThai != CAN_OK || kq.phanNghin != phanNghin || kq.donVi != donVi || kq.onDinh != onDinh) {
+    fprintf(stderr, "phanTichCan(\"%s\") = {%d, trạng thái %u, đơn vị %u, ổn định %u}, cần {%d, 0, %u, %u}\n", dong,
+            kq.phanNghin, kq.trangThai, kq.donVi, kq.onDinh, phanNghin, donVi, onDinh);
+    soLanSai++;
+  }
+}
+
+static void cacDangDong() {
+  kiemTraSo("  12.34 kg", 12340, DON_VI_KG, ON_DINH_KHONG_RO);
+  kiemTraSo("-0.5g", -500, DON_VI_G, ON_DINH_KHONG_RO);
+  kiemTraSo("+0012.345", 12345, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("\x02 ST,GS,+0012.34kg\x03", 12340, DON_VI_KG, ON_DINH);
+  kiemTraSo("US,NT,  1.20 kg", 1200, DON_VI_KG, CHUA_ON_DINH);
+  kiemTraSo("st,gs, 7 KG\r\n", 7000, DON_VI_KG, ON_DINH);
+  kiemTraSo("-   12.5", -12500, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("3.5 lb", 3500, DON_VI_LB, ON_DINH_KHONG_RO);
+  kiemTraSo("5 kgs", 5000, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);  // "KG" phải là cả từ
+  // "OL"/"ST" giữa một từ không phải tiền tố
+  kiemTraSo("GOLD 5", 5000, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("TEST 2", 2000, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+
+  // Độ dài do nơi gọi truyền vào, không cần '\0'
+  ket_qua_can kq = phanTichCan("12.34kgXX", 7);
+  KIEM_TRA_BANG(kq.trangThai, CAN_OK);
+  KIEM_TRA_BANG(kq.phanNghin, 12340);
+  KIEM_TRA_BANG(kq.donVi, DON_VI_KG);
+  KIEM_TRA_BANG(kq.soChuSoLe, 2);
+}
+
+static void lamTronVaTran() {
+  kiemTraSo("1.2345", 1235, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("1.2344", 1234, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("1.23449", 1234, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);  // chỉ xét chữ số thứ tư
+  kiemTraSo("0.0005", 1, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("-0.0005", -1, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  KIEM_TRA_BANG(phanTich("1.23456").soChuSoLe, 5);
+
+  kiemTraSo("2147483.647", INT32_MAX, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  kiemTraSo("-2147483.648", INT32_MIN, DON_VI_KHONG_RO, ON_DINH_KHONG_RO);
+  KIEM_TRA_BANG(phanTich("2147483.648").trangThai, CAN_TRAN_SO);
+  KIEM_TRA_BANG(phanTich("2147483.6475").trangThai, CAN_TRAN_SO);
+  KIEM_TRA_BANG(phanTich("99999999999").trangThai, CAN_TRAN_SO);
+}
+
+static void dongKhongCoSo() {
+  KIEM_TRA_BANG(phanTich("").trangThai, CAN_RONG);
+  KIEM_TRA_BANG(phanTich("\r\n").trangThai, CAN_RONG);
+  KIEM_TRA_BANG(phanTich("\x02\x03").trangThai, CAN_RONG);
+  KIEM_TRA_BANG(phanTich("   \t").trangThai, CAN_RONG);
+  KIEM_TRA_BANG(phanTich("ST,GS,kg").trangThai, CAN_KHONG_CO_SO);
+  KIEM_TRA_BANG(phanTich("---").trangThai, CAN_KHONG_CO_SO);
+
+  KIEM_TRA_BANG(phanTich("OL").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("  ol\r\n").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("ST,OL,  kg").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("OVER").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("OVERLOAD").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("\x02US,Overflow\x03").trangThai, CAN_QUA_TAI);
+  KIEM_TRA_BANG(phanTich("COVER 5").trangThai, CAN_OK);
+}
+
+static void dinhDang() {
+  char buf[16];
+  KIEM_TRA_BANG(dinhDangPhanNghin(12345, buf, sizeof(buf)), 6);
+  KIEM_TRA(strcmp(buf, "12.345") == 0);
+  dinhDangPhanNghin(-500, buf, sizeof(buf));
+  KIEM_TRA(strcmp(buf, "-0.500") == 0);
+  dinhDangPhanNghin(0, buf, sizeof(buf));
+  KIEM_TRA(strcmp(buf, "0.000") == 0);
+  dinhDangPhanNghin(INT32_MIN, buf, sizeof(buf));
+  KIEM_TRA(strcmp(buf, "-2147483.648") == 0);
+  dinhDangPhanNghin(INT32_MAX, buf, sizeof(buf));
+  KIEM_TRA(strcmp(buf, "2147483.647") == 0);
+
+  // Như snprintf: cắt bớt nhưng vẫn trả độ dài đầy đủ
+  char ngan[4];
+  KIEM_TRA_BANG(dinhDangPhanNghin(12345, ngan, sizeof(ngan)), 6);
+  KIEM_TRA(strcmp(ngan, "12.") == 0);
+
+  // Đọc lại đúng giá trị đã ghi (block thẻ của trạm 2)
+  const int32_t giaTri[] = { 1, -1, 999, 1000, 25000, -7250, 123456789, INT32_MAX, INT32_MIN };
+  for (int32_t x : giaTri) {
+    dinhDangPhanNghin(x, buf, sizeof(buf));
+    ket_qua_can kq = phanTich(buf);
+    KIEM_TRA_BANG(kq.trangThai, CAN_OK);
+    KIEM_TRA_BANG(kq.phanNghin, x);
+  }
+}
+
+static void khoiLuongTrenThe() {
+  int32_t phanNghin = -1;
+  char khoi[16];
+  memset(khoi, 0, sizeof(khoi));
+  KIEM_TRA(!docKhoiLuongLan1(khoi, phanNghin));
+  KIEM_TRA(!docKhoiLuongLan1("0", phanNghin));
+  KIEM_TRA(!docKhoiLuongLan1("0.00", phanNghin));
+  memset(khoi, 0xFF, sizeof(khoi));  // block chưa ghi, không có '\0'
+  KIEM_TRA(!docKhoiLuongLan1(khoi, phanNghin));
+  KIEM_TRA_BANG(phanNghin, -1);
+
+  dinhDangPhanNghin(12500, khoi, sizeof(khoi));
+  KIEM_TRA(docKhoiLuongLan1(khoi, phanNghin));
+  KIEM_TRA_BANG(phanNghin, 12500);
+  memcpy(khoi, "0000000000012.5X", 16);  // đủ 16 byte, không có '\0'
+  KIEM_TRA(docKhoiLuongLan1(khoi, phanNghin));
+  KIEM_TRA_BANG(phanNghin, 12500);
+
+  KIEM_TRA_BANG(tinhTiLe(2000, 500), 250);
+  KIEM_TRA_BANG(tinhTiLe(3000, 1000), 333);
+  KIEM_TRA_BANG(tinhTiLe(3000, 2000), 667);
+  KIEM_TRA_BANG(tinhTiLe(0, 500), 0);
+  KIEM_TRA_BANG(tinhTiLe(-5, 500), 0);
+}
+
+int main() {
+  cacDangDong();
+  lamTronVaTran();
+  dongKhongCoSo();
+  dinhDang();
+  khoiLuongTrenThe();
+  return ketQuaKiemTra();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include "Arduino.h"
+
+#define INITR_GREENTAB 0x00
+#define INITR_REDTAB 0x01
+#define INITR_BLACKTAB 0x02
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+// TFT ST7735 của nút mô phỏng chỉ giữ chữ: mỗi ký tự nhớ theo toạ độ góc trên trái (font 6x8 nhân cỡ chữ),
+// fillScreen/fillRect xoá các ký tự nằm trong vùng tô. Kịch bản đọc lại bằng MoPhong.h (manHinh).
+// Mỗi lệnh vẽ tốn thời gian ảo như gửi qua SPI nên thời gian vẽ khung firmware đo được là có nghĩa.
+class Adafruit_ST7735 : public Print {
+public:
+  Adafruit_ST7735(int8_t cs, int8_t dc, int8_t rst) { (void)cs, (void)dc, (void)rst; }
+
+  void initR(uint8_t loai);
+  void setRotation(uint8_t) {}
+  void setTextSize(uint8_t c) { coChu_ = c ? c : 1; }
+  void setTextColor(uint16_t) {}
+  void setTextColor(uint16_t, uint16_t) {}
+  void setTextWrap(bool) {}
+  void setCursor(int16_t x, int16_t y) {
+    x_ = x;
+    y_ = y;
+  }
+  void fillScreen(uint16_t mau) {
+    fillRect(0, 0, 160, 128, mau);
+    chu_.clear();
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t mau);
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Các dòng chữ đang hiện, từ trên xuống (mỗi dòng: các ký tự cùng y, theo x)
+  std::string text() const;
+
+private:
+  struct o_chu {
+    char c;
+    uint8_t rong;  // pixel, theo cỡ chữ lúc in
+  };
+
+  std::map<std::pair<int16_t, int16_t>, o_chu> chu_;  // (y, x) góc trên trái -> ký tự
+  int16_t x_ = 0;
+  int16_t y_ = 0;
+  uint8_t coChu_ = 1;
+};
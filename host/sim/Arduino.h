@@ -0,0 +1,59 @@
+#pragma once
+
+// Arduino-ESP32 trên mô phỏng: thời gian là đồng hồ ảo của nút (board) đang chạy, Serial in ra stdout
+// kèm thời điểm và tên nút. Xem MoPhong.h.
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+
+typedef uint8_t byte;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+inline void yield() { vTaskDelay(0); }
+void pinMode(uint8_t chan, uint8_t cheDo);
+void digitalWrite(uint8_t chan, uint8_t giaTri);
+int digitalRead(uint8_t chan);
+uint32_t esp_random();
+// Giờ SNTP của nút (đồng bộ sau khi có WiFi), firmware gọi qua time() (xem các file nút)
+void configTime(long lechGmt, int lechMuaHe, const char* mayChu1, const char* mayChu2 = nullptr,
+                const char* mayChu3 = nullptr);
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+// glibc cũ không có strlcpy (newlib của ESP32 có)
+inline size_t strlcpy(char* dich, const char* nguon, size_t n) {
+  size_t doDai = strlen(nguon);
+  if (n) {
+    size_t chep = doDai < n - 1 ? doDai : n - 1;
+    memcpy(dich, nguon, chep);
+    dich[chep] = '\0';
+  }
+  return doDai;
+}
+#endif
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
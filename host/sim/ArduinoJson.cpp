@@ -0,0 +1,257 @@
+#include "ArduinoJson.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+using jsongia::ConTro;
+using jsongia::GiaTri;
+
+void vietChuoi(const std::string& s, std::string& ra) {
+  ra += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"': ra += "\\\""; break;
+      case '\\': ra += "\\\\"; break;
+      case '\n': ra += "\\n"; break;
+      case '\r': ra += "\\r"; break;
+      case '\t': ra += "\\t"; break;
+      default:
+        if (c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          ra += buf;
+        } else {
+          ra += (char)c;
+        }
+    }
+  }
+  ra += '"';
+}
+
+void viet(const ConTro& gt, std::string& ra) {
+  if (!gt) {
+    ra += "null";
+    return;
+  }
+  char buf[32];
+  switch (gt->loai) {
+    case GiaTri::RONG: ra += "null"; break;
+    case GiaTri::LOGIC: ra += gt->logic ? "true" : "false"; break;
+    case GiaTri::SO_NGUYEN:
+      snprintf(buf, sizeof(buf), "%lld", gt->soNguyen);
+      ra += buf;
+      break;
+    case GiaTri::SO_THUC:
+      if (!isfinite(gt->soThuc)) {
+        ra += "null";
+        break;
+      }
+      snprintf(buf, sizeof(buf), gt->laFloat ? "%.7g" : "%.9g", gt->soThuc);
+      ra += buf;
+      break;
+    case GiaTri::CHUOI: vietChuoi(gt->chuoi, ra); break;
+    case GiaTri::MANG:
+      ra += '[';
+      for (size_t i = 0; i < gt->mang.size(); i++) {
+        if (i) ra += ',';
+        viet(gt->mang[i], ra);
+      }
+      ra += ']';
+      break;
+    case GiaTri::DOI_TUONG:
+      ra += '{';
+      for (size_t i = 0; i < gt->doiTuong.size(); i++) {
+        if (i) ra += ',';
+        vietChuoi(gt->doiTuong[i].first, ra);
+        ra += ':';
+        viet(gt->doiTuong[i].second, ra);
+      }
+      ra += '}';
+      break;
+  }
+}
+
+// Bộ đọc đệ quy xuống, i_ là vị trí đang đọc
+class BoDoc {
+public:
+  BoDoc(const std::string& s) : s_(s) {}
+
+  DeserializationError::Code doc(ConTro& ra, int sau = 0) {
+    boTrang();
+    if (i_ >= s_.size()) return DeserializationError::IncompleteInput;
+    if (sau > 20) return DeserializationError::TooDeep;
+    ra = std::make_shared<GiaTri>();
+    char c = s_[i_];
+    if (c == '{') {
+      i_++;
+      ra->loai = GiaTri::DOI_TUONG;
+      boTrang();
+      if (i_ < s_.size() && s_[i_] == '}') {
+        i_++;
+        return DeserializationError::Ok;
+      }
+      for (;;) {
+        boTrang();
+        std::string khoa;
+        DeserializationError::Code ma = docChuoi(khoa);
+        if (ma) return ma;
+        boTrang();
+        if (i_ >= s_.size()) return DeserializationError::IncompleteInput;
+        if (s_[i_++] != ':') return DeserializationError::InvalidInput;
+        ConTro con;
+        ma = doc(con, sau + 1);
+        if (ma) return ma;
+        ra->doiTuong.push_back(std::make_pair(khoa, con));
+        boTrang();
+        if (i_ >= s_.size()) return DeserializationError::IncompleteInput;
+        c = s_[i_++];
+        if (c == '}') return DeserializationError::Ok;
+        if (c != ',') return DeserializationError::InvalidInput;
+      }
+    }
+    if (c == '[') {
+      i_++;
+      ra->loai = GiaTri::MANG;
+      boTrang();
+      if (i_ < s_.size() && s_[i_] == ']') {
+        i_++;
+        return DeserializationError::Ok;
+      }
+      for (;;) {
+        ConTro con;
+        DeserializationError::Code ma = doc(con, sau + 1);
+        if (ma) return ma;
+        ra->mang.push_back(con);
+        boTrang();
+        if (i_ >= s_.size()) return DeserializationError::IncompleteInput;
+        c = s_[i_++];
+        if (c == ']') return DeserializationError::Ok;
+        if (c != ',') return DeserializationError::InvalidInput;
+      }
+    }
+    if (c == '"') {
+      ra->loai = GiaTri::CHUOI;
+      return docChuoi(ra->chuoi);
+    }
+    if (tuKhoa("true")) {
+      ra->loai = GiaTri::LOGIC;
+      ra->logic = true;
+      return DeserializationError::Ok;
+    }
+    if (tuKhoa("false")) {
+      ra->loai = GiaTri::LOGIC;
+      return DeserializationError::Ok;
+    }
+    if (tuKhoa("null")) return DeserializationError::Ok;
+    return docSo(*ra);
+  }
+
+  bool conThua() {
+    boTrang();
+    return i_ < s_.size();
+  }
+
+private:
+  void boTrang() {
+    while (i_ < s_.size() && (s_[i_] == ' ' || s_[i_] == '\t' || s_[i_] == '\r' || s_[i_] == '\n')) i_++;
+  }
+
+  bool tuKhoa(const char* k) {
+    size_t n = strlen(k);
+    if (s_.compare(i_, n, k) != 0) return false;
+    i_ += n;
+    return true;
+  }
+
+  DeserializationError::Code docChuoi(std::string& ra) {
+    if (i_ >= s_.size()) return DeserializationError::IncompleteInput;
+    if (s_[i_++] != '"') return DeserializationError::InvalidInput;
+    while (i_ < s_.size()) {
+      char c = s_[i_++];
+      if (c == '"') return DeserializationError::Ok;
+      if (c != '\\') {
+        ra += c;
+        continue;
+      }
+      if (i_ >= s_.size()) break;
+      c = s_[i_++];
+      switch (c) {
+        case 'n': ra += '\n'; break;
+        case 'r': ra += '\r'; break;
+        case 't': ra += '\t'; break;
+        case 'b': ra += '\b'; break;
+        case 'f': ra += '\f'; break;
+        case 'u': {
+          if (i_ + 4 > s_.size()) return DeserializationError::IncompleteInput;
+          unsigned ma = strtoul(s_.substr(i_, 4).c_str(), nullptr, 16);
+          i_ += 4;
+          // UTF-8 của điểm mã BMP (đủ cho tên tiếng Việt)
+          if (ma < 0x80) {
+            ra += (char)ma;
+          } else if (ma < 0x800) {
+            ra += (char)(0xC0 | ma >> 6);
+            ra += (char)(0x80 | (ma & 0x3F));
+          } else {
+            ra += (char)(0xE0 | ma >> 12);
+            ra += (char)(0x80 | ((ma >> 6) & 0x3F));
+            ra += (char)(0x80 | (ma & 0x3F));
+          }
+          break;
+        }
+        default: ra += c; break;
+      }
+    }
+    return DeserializationError::IncompleteInput;
+  }
+
+  DeserializationError::Code docSo(GiaTri& ra) {
+    const char* dau = s_.c_str() + i_;
+    char* cuoi = nullptr;
+    bool laThuc = false;
+    for (const char* p = dau; *p && strchr("+-0123456789.eE", *p); p++)
+      if (*p == '.' || *p == 'e' || *p == 'E') laThuc = true;
+    if (laThuc) {
+      ra.soThuc = strtod(dau, &cuoi);
+      ra.loai = GiaTri::SO_THUC;
+    } else {
+      ra.soNguyen = strtoll(dau, &cuoi, 10);
+      ra.loai = GiaTri::SO_NGUYEN;
+    }
+    if (cuoi == dau) return DeserializationError::InvalidInput;
+    i_ += cuoi - dau;
+    return DeserializationError::Ok;
+  }
+
+  const std::string& s_;
+  size_t i_ = 0;
+};
+
+}  // namespace
+
+size_t serializeJson(const JsonDocument& doc, std::string& ra) {
+  ra.clear();
+  viet(doc.goc(), ra);
+  return ra.size();
+}
+
+size_t serializeJson(const JsonDocument& doc, String& ra) {
+  std::string s;
+  serializeJson(doc, s);
+  ra = String(s);
+  return s.size();
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const std::string& vao) {
+  doc.clear();
+  BoDoc bo(vao);
+  if (!bo.conThua()) return DeserializationError::EmptyInput;
+  ConTro goc;
+  DeserializationError::Code ma = bo.doc(goc);
+  if (ma) return ma;
+  doc.datGoc(goc);
+  return DeserializationError::Ok;
+}
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "WString.h"
+
+// Phần ArduinoJson 7 mà gateway và server giả (FakeApi) dùng: JsonDocument, JsonObject, JsonArray,
+// JsonVariant, serializeJson/deserializeJson. Cây giá trị dùng chung con trỏ nên JsonObject/JsonArray
+// chép được như tham chiếu, ghi qua chúng là ghi vào tài liệu. Thành viên giữ thứ tự thêm vào.
+namespace jsongia {
+
+struct GiaTri;
+typedef std::shared_ptr<GiaTri> ConTro;
+
+struct GiaTri {
+  enum Loai { RONG, LOGIC, SO_NGUYEN, SO_THUC, CHUOI, MANG, DOI_TUONG };
+
+  Loai loai = RONG;
+  bool logic = false;
+  long long soNguyen = 0;
+  double soThuc = 0;
+  bool laFloat = false;  // float in ít chữ số hơn double như ArduinoJson
+  std::string chuoi;
+  std::vector<ConTro> mang;
+  std::vector<std::pair<std::string, ConTro>> doiTuong;
+
+  ConTro thanhVien(const std::string& khoa) const {
+    if (loai != DOI_TUONG) return ConTro();
+    for (const auto& tv : doiTuong)
+      if (tv.first == khoa) return tv.second;
+    return ConTro();
+  }
+  void datRong(Loai l) {
+    loai = l;
+    mang.clear();
+    doiTuong.clear();
+    chuoi.clear();
+  }
+};
+
+}  // namespace jsongia
+
+class JsonArray;
+class JsonObject;
+
+// Một giá trị trong tài liệu, hoặc chỗ của thành viên chưa có: ghi vào thì thành viên mới được tạo
+class JsonVariant {
+public:
+  JsonVariant() {}
+  explicit JsonVariant(jsongia::ConTro gt) : gt_(gt) {}
+  JsonVariant(jsongia::ConTro cha, const std::string& khoa) : cha_(cha), khoa_(khoa) {}
+
+  JsonVariant operator[](const char* khoa) const {
+    jsongia::ConTro gt = doc();
+    return gt ? JsonVariant(gt, khoa) : JsonVariant(jsongia::ConTro());
+  }
+  JsonVariant operator[](size_t i) const {
+    jsongia::ConTro gt = doc();
+    return JsonVariant(gt && gt->loai == jsongia::GiaTri::MANG && i < gt->mang.size() ? gt->mang[i] : jsongia::ConTro());
+  }
+
+  bool isNull() const {
+    jsongia::ConTro gt = doc();
+    return !gt || gt->loai == jsongia::GiaTri::RONG;
+  }
+  bool isString() const { return laLoai(jsongia::GiaTri::CHUOI); }
+  bool isArray() const { return laLoai(jsongia::GiaTri::MANG); }
+  bool isObject() const { return laLoai(jsongia::GiaTri::DOI_TUONG); }
+  bool isNumber() const { return laLoai(jsongia::GiaTri::SO_NGUYEN) || laLoai(jsongia::GiaTri::SO_THUC); }
+  bool isInteger() const { return laLoai(jsongia::GiaTri::SO_NGUYEN); }
+
+  template <typename T>
+  T to();
+  template <typename T>
+  T as() const;
+
+  JsonVariant& operator=(bool v) {
+    jsongia::ConTro gt = tao();
+    gt->datRong(jsongia::GiaTri::LOGIC);
+    gt->logic = v;
+    return *this;
+  }
+  JsonVariant& operator=(signed char v) { return soNguyen(v); }
+  JsonVariant& operator=(unsigned char v) { return soNguyen(v); }
+  JsonVariant& operator=(short v) { return soNguyen(v); }
+  JsonVariant& operator=(unsigned short v) { return soNguyen(v); }
+  JsonVariant& operator=(int v) { return soNguyen(v); }
+  JsonVariant& operator=(unsigned v) { return soNguyen(v); }
+  JsonVariant& operator=(long v) { return soNguyen(v); }
+  JsonVariant& operator=(unsigned long v) { return soNguyen((long long)v); }
+  JsonVariant& operator=(long long v) { return soNguyen(v); }
+  JsonVariant& operator=(float v) { return soThuc(v, true); }
+  JsonVariant& operator=(double v) { return soThuc(v, false); }
+  JsonVariant& operator=(const char* v) { return chuoi(v ? v : ""); }
+  JsonVariant& operator=(const String& v) { return chuoi(v.str()); }
+  JsonVariant& operator=(const std::string& v) { return chuoi(v); }
+
+  // Giá trị nếu đúng kiểu, không thì macDinh (như ArduinoJson)
+  int operator|(int macDinh) const {
+    jsongia::ConTro gt = doc();
+    return gt && gt->loai == jsongia::GiaTri::SO_NGUYEN ? (int)gt->soNguyen : macDinh;
+  }
+  long long operator|(long long macDinh) const {
+    jsongia::ConTro gt = doc();
+    return gt && gt->loai == jsongia::GiaTri::SO_NGUYEN ? gt->soNguyen : macDinh;
+  }
+  double operator|(double macDinh) const {
+    jsongia::ConTro gt = doc();
+    if (gt && gt->loai == jsongia::GiaTri::SO_THUC) return gt->soThuc;
+    if (gt && gt->loai == jsongia::GiaTri::SO_NGUYEN) return (double)gt->soNguyen;
+    return macDinh;
+  }
+  const char* operator|(const char* macDinh) const {
+    jsongia::ConTro gt = doc();
+    return gt && gt->loai == jsongia::GiaTri::CHUOI ? gt->chuoi.c_str() : macDinh;
+  }
+
+  // Dùng nội bộ
+  jsongia::ConTro doc() const {
+    if (gt_) return gt_;
+    return cha_ ? cha_->thanhVien(khoa_) : jsongia::ConTro();
+  }
+  jsongia::ConTro tao() {
+    if (gt_) return gt_;
+    if (!cha_) {
+      gt_ = std::make_shared<jsongia::GiaTri>();
+      return gt_;
+    }
+    gt_ = cha_->thanhVien(khoa_);
+    if (gt_) return gt_;
+    if (cha_->loai != jsongia::GiaTri::DOI_TUONG) cha_->datRong(jsongia::GiaTri::DOI_TUONG);
+    gt_ = std::make_shared<jsongia::GiaTri>();
+    cha_->doiTuong.push_back(std::make_pair(khoa_, gt_));
+    return gt_;
+  }
+
+private:
+  bool laLoai(jsongia::GiaTri::Loai l) const {
+    jsongia::ConTro gt = doc();
+    return gt && gt->loai == l;
+  }
+  JsonVariant& soNguyen(long long v) {
+    jsongia::ConTro gt = tao();
+    gt->datRong(jsongia::GiaTri::SO_NGUYEN);
+    gt->soNguyen = v;
+    return *this;
+  }
+  JsonVariant& soThuc(double v, bool laFloat) {
+    jsongia::ConTro gt = tao();
+    gt->datRong(jsongia::GiaTri::SO_THUC);
+    gt->soThuc = v;
+    gt->laFloat = laFloat;
+    return *this;
+  }
+  JsonVariant& chuoi(const std::string& v) {
+    jsongia::ConTro gt = tao();
+    gt->datRong(jsongia::GiaTri::CHUOI);
+    gt->chuoi = v;
+    return *this;
+  }
+
+  jsongia::ConTro cha_;
+  std::string khoa_;
+  jsongia::ConTro gt_;
+};
+
+class JsonObject {
+public:
+  JsonObject() {}
+  explicit JsonObject(jsongia::ConTro gt) : gt_(gt) {}
+  JsonObject(const JsonVariant& v) : gt_(v.doc()) {
+    if (gt_ && gt_->loai != jsongia::GiaTri::DOI_TUONG) gt_.reset();
+  }
+
+  JsonVariant operator[](const char* khoa) const {
+    return gt_ ? JsonVariant(gt_, khoa) : JsonVariant(jsongia::ConTro());
+  }
+  bool isNull() const { return !gt_; }
+  bool containsKey(const char* khoa) const { return gt_ && gt_->thanhVien(khoa); }
+  size_t size() const { return gt_ ? gt_->doiTuong.size() : 0; }
+
+private:
+  jsongia::ConTro gt_;
+};
+
+class JsonArray {
+public:
+  class iterator {
+  public:
+    iterator(const std::vector<jsongia::ConTro>* mang, size_t i) : mang_(mang), i_(i) {}
+    JsonVariant operator*() const { return JsonVariant((*mang_)[i_]); }
+    iterator& operator++() {
+      i_++;
+      return *this;
+    }
+    bool operator!=(const iterator& khac) const { return i_ != khac.i_; }
+
+  private:
+    const std::vector<jsongia::ConTro>* mang_;
+    size_t i_;
+  };
+
+  JsonArray() {}
+  explicit JsonArray(jsongia::ConTro gt) : gt_(gt) {}
+  JsonArray(const JsonVariant& v) : gt_(v.doc()) {
+    if (gt_ && gt_->loai != jsongia::GiaTri::MANG) gt_.reset();
+  }
+
+  template <typename T>
+  T add();
+  template <typename T>
+  bool add(const T& v) {
+    if (!gt_) return false;
+    jsongia::ConTro moi = std::make_shared<jsongia::GiaTri>();
+    gt_->mang.push_back(moi);
+    JsonVariant bien(moi);
+    bien = v;
+    return true;
+  }
+
+  JsonVariant operator[](size_t i) const { return JsonVariant(gt_ && i < gt_->mang.size() ? gt_->mang[i] : jsongia::ConTro()); }
+  size_t size() const { return gt_ ? gt_->mang.size() : 0; }
+  bool isNull() const { return !gt_; }
+  iterator begin() const { return iterator(gt_ ? &gt_->mang : nullptr, 0); }
+  iterator end() const { return iterator(gt_ ? &gt_->mang : nullptr, size()); }
+
+private:
+  jsongia::ConTro gt_;
+};
+
+template <>
+inline JsonObject JsonArray::add<JsonObject>() {
+  if (!gt_) return JsonObject();
+  jsongia::ConTro moi = std::make_shared<jsongia::GiaTri>();
+  moi->loai = jsongia::GiaTri::DOI_TUONG;
+  gt_->mang.push_back(moi);
+  return JsonObject(moi);
+}
+
+template <>
+inline JsonArray JsonVariant::to<JsonArray>() {
+  jsongia::ConTro gt = tao();
+  gt->datRong(jsongia::GiaTri::MANG);
+  return JsonArray(gt);
+}
+
+template <>
+inline JsonObject JsonVariant::to<JsonObject>() {
+  jsongia::ConTro gt = tao();
+  gt->datRong(jsongia::GiaTri::DOI_TUONG);
+  return JsonObject(gt);
+}
+
+template <>
+inline JsonArray JsonVariant::as<JsonArray>() const { return JsonArray(*this); }
+template <>
+inline JsonObject JsonVariant::as<JsonObject>() const { return JsonObject(*this); }
+template <>
+inline int JsonVariant::as<int>() const { return *this | 0; }
+template <>
+inline long long JsonVariant::as<long long>() const { return *this | 0LL; }
+template <>
+inline double JsonVariant::as<double>() const { return *this | 0.0; }
+template <>
+inline float JsonVariant::as<float>() const { return (float)(*this | 0.0); }
+template <>
+inline const char* JsonVariant::as<const char*>() const { return *this | (const char*)nullptr; }
+template <>
+inline String JsonVariant::as<String>() const { return String(*this | ""); }
+
+class JsonDocument {
+public:
+  JsonDocument() : goc_(std::make_shared<jsongia::GiaTri>()) {}
+
+  JsonVariant operator[](const char* khoa) { return JsonVariant(goc_, khoa); }
+  JsonVariant operator[](const char* khoa) const { return JsonVariant(goc_, khoa); }
+  template <typename T>
+  T to() {
+    return JsonVariant(goc_).to<T>();
+  }
+  template <typename T>
+  T as() const {
+    return JsonVariant(goc_).as<T>();
+  }
+  bool isNull() const { return goc_->loai == jsongia::GiaTri::RONG; }
+  void clear() { goc_ = std::make_shared<jsongia::GiaTri>(); }
+
+  // Dùng nội bộ
+  jsongia::ConTro goc() const { return goc_; }
+  void datGoc(jsongia::ConTro g) { goc_ = g; }
+
+private:
+  jsongia::ConTro goc_;
+};
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+  DeserializationError(Code ma = Ok) : ma_(ma) {}
+  explicit operator bool() const { return ma_ != Ok; }
+  Code code() const { return ma_; }
+  const char* c_str() const {
+    static const char* ten[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep" };
+    return ten[ma_];
+  }
+
+private:
+  Code ma_;
+};
+
+size_t serializeJson(const JsonDocument& doc, std::string& ra);
+size_t serializeJson(const JsonDocument& doc, String& ra);
+DeserializationError deserializeJson(JsonDocument& doc, const std::string& vao);
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& vao) { return deserializeJson(doc, vao.str()); }
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* vao) {
+  return deserializeJson(doc, std::string(vao ? vao : ""));
+}
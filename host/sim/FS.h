@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WString.h"
+
+// Hệ tệp của nút mô phỏng: mỗi tệp là một mảng byte trong RAM, giữ nguyên qua các lần tắt/bật
+// nguồn của nút như flash thật. Tổng dung lượng có giới hạn (MoPhong.h: datDungLuongFlash) để thử
+// trường hợp flash đầy.
+namespace fs {
+
+class FS;
+
+class File {
+public:
+  File() {}
+
+  explicit operator bool() const { return (bool)duLieu_; }
+  size_t read(uint8_t* ra, size_t n);
+  int read();
+  size_t write(const uint8_t* p, size_t n);
+  size_t write(uint8_t c) { return write(&c, 1); }
+  bool seek(uint32_t viTri);
+  size_t position() const { return viTri_; }
+  size_t size() const { return duLieu_ ? duLieu_->size() : 0; }
+  int available() const { return duLieu_ ? (int)(duLieu_->size() - viTri_) : 0; }
+  void close() { duLieu_.reset(); }
+
+private:
+  friend class FS;
+  std::shared_ptr<std::vector<uint8_t>> duLieu_;
+  size_t viTri_ = 0;
+  bool choGhi_ = false;
+  bool noiTiep_ = false;
+  int nut_ = -1;  // nút mở tệp, để tính dung lượng flash đã dùng
+};
+
+class FS {
+public:
+  virtual ~FS() {}
+  File open(const String& duongDan, const char* cheDo = "r");
+  bool exists(const String& duongDan);
+  bool remove(const String& duongDan);
+  bool rename(const String& tu, const String& den);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
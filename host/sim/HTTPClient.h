@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include "Arduino.h"
+#include "WiFiClientSecure.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// HTTP(S) tới server của mô phỏng (MoPhong.h: datMayChuHttp). Request chặn task gọi theo thời gian ảo:
+// bắt tay TLS khi kết nối chưa mở, rồi thời gian một lượt request/phản hồi. Cần WiFi của nút đang kết nối.
+class HTTPClient {
+public:
+  bool begin(WiFiClient& client, const String& url) {
+    client_ = &client;
+    url_ = url.str();
+    return true;
+  }
+  bool begin(const String& url) { return begin(rieng_, url); }
+  void addHeader(const String&, const String&) {}
+  void setReuse(bool giu) { giuKetNoi_ = giu; }
+  void setTimeout(uint16_t) {}
+
+  int GET() { return guiYeuCau("GET", String()); }
+  int POST(const String& than) { return guiYeuCau("POST", than); }
+  String getString() { return traVe_; }
+  void end() {
+    if (client_ && !giuKetNoi_) client_->stop();
+  }
+
+private:
+  int guiYeuCau(const char* phuongThuc, const String& than);
+
+  WiFiClient* client_ = nullptr;
+  WiFiClient rieng_;
+  std::string url_;
+  String traVe_;
+  bool giuKetNoi_ = true;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+
+// Địa chỉ IPv4, byte đầu ở bit thấp như trên ESP32
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint32_t diaChi) : diaChi_(diaChi) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : diaChi_(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+
+  operator uint32_t() const { return diaChi_; }
+  uint8_t operator[](int i) const { return diaChi_ >> (8 * i); }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buf);
+  }
+
+private:
+  uint32_t diaChi_ = 0;
+};
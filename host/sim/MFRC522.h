@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Arduino.h"
+#include "SPI.h"
+
+// Đầu đọc MFRC522 của nút mô phỏng với thẻ MIFARE Classic 1K (MoPhong.h: datThe). Như thẻ thật: thẻ
+// đã PICC_HaltA() không được phát hiện lại cho tới khi nhấc ra đặt lại, đọc/ghi cần xác thực đúng
+// sector, thẻ nhấc ra giữa chừng thì mọi lệnh trả STATUS_TIMEOUT.
+class MFRC522 {
+public:
+  enum StatusCode : byte {
+    STATUS_OK,
+    STATUS_ERROR,
+    STATUS_COLLISION,
+    STATUS_TIMEOUT,
+    STATUS_NO_ROOM,
+    STATUS_INTERNAL_ERROR,
+    STATUS_INVALID,
+    STATUS_CRC_WRONG,
+    STATUS_MIFARE_NACK = 0xff
+  };
+  enum PICC_Command : byte { PICC_CMD_MF_AUTH_KEY_A = 0x60, PICC_CMD_MF_AUTH_KEY_B = 0x61 };
+
+  typedef struct {
+    byte size;
+    byte uidByte[10];
+    byte sak;
+  } Uid;
+  typedef struct {
+    byte keyByte[6];
+  } MIFARE_Key;
+
+  Uid uid;
+
+  MFRC522(byte chanSs, byte chanRst) { (void)chanSs, (void)chanRst; }
+  void PCD_Init() {}
+  bool PICC_IsNewCardPresent();
+  bool PICC_ReadCardSerial();
+  StatusCode PICC_HaltA();
+  void PCD_StopCrypto1();
+  StatusCode PCD_Authenticate(byte lenh, byte block, MIFARE_Key* khoa, Uid* uid);
+  StatusCode MIFARE_Read(byte block, byte* ra, byte* doDai);
+  StatusCode MIFARE_Write(byte block, byte* duLieu, byte doDai);
+  static const char* GetStatusCodeName(StatusCode ma);
+};
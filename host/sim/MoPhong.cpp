@@ -0,0 +1,500 @@
+#include "MoPhongNoiBo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "freertos/timers.h"
+
+using namespace mophong;
+
+namespace {
+
+enum { SAN_SANG, DANG_CHO, KET_THUC };
+
+}  // namespace
+
+// Task: một thread chỉ chạy khi duocChay (đang giữ lượt)
+struct tskTaskControlBlock {
+  std::string ten;
+  Nut* nut = nullptr;
+  std::condition_variable cv;
+  bool duocChay = false;
+  int trangThai = SAN_SANG;
+  const void* doiTuong = nullptr;  // đang chờ danhThuc(doiTuong)
+  uint64_t han = kKhongHan;        // us
+  bool hetGio = false;
+  uint32_t thongBao = 0;
+};
+
+// Hàng đợi, semaphore là hàng đợi phần tử 0 byte
+struct QueueDefinition {
+  size_t kichThuoc;
+  UBaseType_t toiDa;
+  std::deque<std::vector<uint8_t>> ds;
+};
+
+struct tmrTimerControl {
+  TickType_t chuKy;
+  bool lapLai;
+  void* id;
+  TimerCallbackFunction_t cb;
+  Nut* nut;
+  uint32_t lanBat = 0;  // tăng mỗi lần start/stop: lần hẹn cũ bị bỏ
+  bool dangChay = false;
+};
+
+namespace {
+
+typedef tskTaskControlBlock Tcb;
+
+// Chỉ task giữ lượt chạy; khoa chỉ bảo vệ lúc trao lượt và các bảng của bộ lập lịch
+std::mutex khoa;
+std::vector<Tcb*> tatCaTask;  // theo thứ tự tạo
+std::deque<Tcb*> sanSang;
+Tcb* hienTai = nullptr;
+uint64_t bayGio = 0;  // us
+
+struct SuKien {
+  Nut* nut;
+  uint32_t theHe;
+  std::function<void()> f;
+};
+std::map<std::pair<uint64_t, uint64_t>, SuKien> bangSuKien;  // (lúc, thứ tự hẹn)
+uint64_t soSuKien = 0;
+Tcb* taskSuKien = nullptr;
+const char doiTuongSuKien = 0;
+
+uint32_t hatNgauNhien = 2463534242u;
+
+const char* tenTrangThai(int tt) {
+  return tt == SAN_SANG ? "sẵn sàng" : tt == DANG_CHO ? "chờ" : "đã dừng";
+}
+
+// Mọi task đều chờ mà không có hạn: firmware kẹt (hoặc lỗi của mô phỏng)
+[[noreturn]] void baoKet() {
+  fflush(stdout);
+  fprintf(stderr, "mô phỏng kẹt lúc %llu ms, không task nào còn chạy được:\n", (unsigned long long)(bayGio / 1000));
+  for (Tcb* t : tatCaTask) {
+    if (t->trangThai == KET_THUC) continue;
+    fprintf(stderr, "  %s/%s: %s\n", t->nut ? t->nut->ten.c_str() : "-", t->ten.c_str(), tenTrangThai(t->trangThai));
+  }
+  fflush(stderr);
+  _Exit(2);
+}
+
+// Task chạy kế tiếp; hết task sẵn sàng thì đồng hồ nhảy tới hạn chờ gần nhất
+Tcb* chonKeTiep() {
+  for (;;) {
+    if (!sanSang.empty()) {
+      Tcb* t = sanSang.front();
+      sanSang.pop_front();
+      return t;
+    }
+    uint64_t som = kKhongHan;
+    for (Tcb* t : tatCaTask)
+      if (t->trangThai == DANG_CHO && t->han < som) som = t->han;
+    if (som == kKhongHan) baoKet();
+    if (som > bayGio) bayGio = som;
+    for (Tcb* t : tatCaTask) {
+      if (t->trangThai != DANG_CHO || t->han != som) continue;
+      t->trangThai = SAN_SANG;
+      t->hetGio = true;
+      t->doiTuong = nullptr;
+      t->han = kKhongHan;
+      sanSang.push_back(t);
+    }
+  }
+}
+
+// Trao lượt: task hiện tại đã đặt trạng thái của mình, trả về khi nó được chạy lại
+// (task đã dừng thì không bao giờ trả về)
+void traoLuot(std::unique_lock<std::mutex>& lk) {
+  Tcb* toi = hienTai;
+  Tcb* ke = chonKeTiep();
+  if (ke == toi) return;
+  toi->duocChay = false;
+  ke->duocChay = true;
+  hienTai = ke;
+  ke->cv.notify_one();
+  toi->cv.wait(lk, [toi] { return toi->duocChay; });
+}
+
+void danhThucKhoa(const void* doiTuong) {
+  for (Tcb* t : tatCaTask) {
+    if (t->trangThai != DANG_CHO || t->doiTuong != doiTuong) continue;
+    t->trangThai = SAN_SANG;
+    t->doiTuong = nullptr;
+    t->han = kKhongHan;
+    t->hetGio = false;
+    sanSang.push_back(t);
+  }
+}
+
+void boKhoiSanSang(Tcb* t) {
+  sanSang.erase(std::remove(sanSang.begin(), sanSang.end(), t), sanSang.end());
+}
+
+// Gọi khi giữ khoa; task mới chạy khi tới lượt
+Tcb* taoTask(Nut* n, const char* ten, std::function<void()> chay) {
+  Tcb* t = new Tcb;
+  t->ten = ten ? ten : "";
+  t->nut = n;
+  tatCaTask.push_back(t);
+  sanSang.push_back(t);
+  std::thread([t, chay] {
+    {
+      std::unique_lock<std::mutex> lk(khoa);
+      t->cv.wait(lk, [t] { return t->duocChay; });
+    }
+    chay();
+    std::unique_lock<std::mutex> lk(khoa);
+    t->trangThai = KET_THUC;
+    traoLuot(lk);
+  }).detach();
+  return t;
+}
+
+// Task sự kiện: callback ESP-NOW/WiFi, timer, byte UART tới... theo đúng thứ tự thời gian
+void chaySuKien() {
+  std::unique_lock<std::mutex> lk(khoa);
+  for (;;) {
+    if (bangSuKien.empty() || bangSuKien.begin()->first.first > bayGio) {
+      taskSuKien->trangThai = DANG_CHO;
+      taskSuKien->doiTuong = &doiTuongSuKien;
+      taskSuKien->han = bangSuKien.empty() ? kKhongHan : bangSuKien.begin()->first.first;
+      traoLuot(lk);
+      continue;
+    }
+    SuKien sk = bangSuKien.begin()->second;
+    bangSuKien.erase(bangSuKien.begin());
+    if (sk.nut && (sk.nut->theHe != sk.theHe || !sk.nut->dangChay)) continue;
+    taskSuKien->nut = sk.nut;
+    lk.unlock();
+    sk.f();
+    lk.lock();
+    taskSuKien->nut = nullptr;
+  }
+}
+
+void ketThucDong(Nut* n) {
+  uint64_t ms = bayGio / 1000;
+  printf("[%4llu.%03llu %s] %s\n", (unsigned long long)(ms / 1000), (unsigned long long)(ms % 1000), n->ten.c_str(),
+         n->dongDo.c_str());
+  n->nhatKy.push_back(n->dongDo);
+  n->dongDo.clear();
+}
+
+void henTimer(TimerHandle_t t) {
+  uint32_t lan = t->lanBat;
+  hen(t->nut, bayGio + (uint64_t)t->chuKy * 1000, [t, lan] {
+    if (t->lanBat != lan || !t->dangChay) return;
+    if (t->lapLai) {
+      t->lanBat++;
+      henTimer(t);
+    } else {
+      t->dangChay = false;
+    }
+    t->cb(t);
+  });
+}
+
+}  // namespace
+
+namespace mophong {
+
+std::vector<Nut*> tatCaNut;
+
+Nut* nutHienTai() { return hienTai ? hienTai->nut : nullptr; }
+
+uint64_t bayGioUs() { return bayGio; }
+
+unsigned long millisCua(const Nut* n) { return (bayGio - (n ? n->batNguonLuc : 0)) / 1000; }
+
+uint64_t hanCua(TickType_t cho) { return cho == portMAX_DELAY ? kKhongHan : bayGio + (uint64_t)cho * 1000; }
+
+bool cho(const void* doiTuong, uint64_t hanUs) {
+  std::unique_lock<std::mutex> lk(khoa);
+  Tcb* t = hienTai;
+  t->trangThai = DANG_CHO;
+  t->doiTuong = doiTuong;
+  t->han = hanUs < bayGio ? bayGio : hanUs;
+  t->hetGio = false;
+  traoLuot(lk);
+  return !t->hetGio;
+}
+
+void danhThuc(const void* doiTuong) {
+  std::lock_guard<std::mutex> lk(khoa);
+  danhThucKhoa(doiTuong);
+}
+
+void nguUs(uint64_t us) {
+  if (us) {
+    cho(nullptr, bayGio + us);
+    return;
+  }
+  std::unique_lock<std::mutex> lk(khoa);
+  sanSang.push_back(hienTai);
+  traoLuot(lk);
+}
+
+void hen(Nut* n, uint64_t lucUs, std::function<void()> f) {
+  std::lock_guard<std::mutex> lk(khoa);
+  SuKien sk = { n, n ? n->theHe : 0, f };
+  bangSuKien[std::make_pair(lucUs, soSuKien++)] = sk;
+  danhThucKhoa(&doiTuongSuKien);
+}
+
+void khoiDong() {
+  std::lock_guard<std::mutex> lk(khoa);
+  Tcb* t = new Tcb;
+  t->ten = "kichban";
+  t->duocChay = true;
+  tatCaTask.push_back(t);
+  hienTai = t;
+  taskSuKien = taoTask(nullptr, "sukien", chaySuKien);
+}
+
+void ketThuc(int ma) {
+  fflush(stdout);
+  fflush(stderr);
+  _Exit(ma);
+}
+
+Nut* taoNut(const char* ten) {
+  Nut* n = new Nut;
+  n->ten = ten;
+  n->chiSo = tatCaNut.size();
+  const uint8_t mac[6] = { 0x24, 0x6F, 0x28, 0x10, 0x00, (uint8_t)(n->chiSo + 1) };
+  memcpy(n->mac, mac, 6);
+  tatCaNut.push_back(n);
+  return n;
+}
+
+const char* tenNut(const Nut* n) { return n->ten.c_str(); }
+
+void batNguon(Nut* n, const Firmware& fw) {
+  if (n->dangChay) tatNguon(n);
+  std::lock_guard<std::mutex> lk(khoa);
+  n->tb = ThietBi();
+  n->trangThaiThe = THE_CHO;
+  n->dangChay = true;
+  n->theHe++;
+  n->batNguonLuc = bayGio;
+  void (*setup)() = fw.setup;
+  void (*loop)() = fw.loop;
+  taoTask(n, "loopTask", [setup, loop] {
+    setup();
+    for (;;) loop();
+  });
+}
+
+void tatNguon(Nut* n) {
+  std::lock_guard<std::mutex> lk(khoa);
+  for (Tcb* t : tatCaTask) {
+    if (t->nut != n || t->trangThai == KET_THUC) continue;
+    t->trangThai = KET_THUC;
+    boKhoiSanSang(t);
+  }
+  n->dangChay = false;
+  n->theHe++;
+  n->tb.wifiKetNoi = false;
+  if (!n->dongDo.empty()) ketThucDong(n);
+}
+
+bool dangChay(const Nut* n) { return n->dangChay; }
+
+void choDen(uint64_t ms) {
+  if (ms * 1000 > bayGio) cho(nullptr, ms * 1000);
+}
+
+uint64_t bayGioMs() { return bayGio / 1000; }
+
+time_t gioThuc() { return kGioBatDau + bayGio / 1000000; }
+
+void datDungLuongFlash(Nut* n, size_t byte) { n->dungLuongFlash = byte; }
+
+void datSong(Nut* n, bool coSong) { n->coSong = coSong; }
+
+const std::vector<std::string>& nhatKy(const Nut* n) { return n->nhatKy; }
+
+}  // namespace mophong
+
+// FreeRTOS
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t ham, const char* ten, uint32_t, void* thamSo, UBaseType_t,
+                                   TaskHandle_t* ra, BaseType_t) {
+  std::lock_guard<std::mutex> lk(khoa);
+  Tcb* t = taoTask(hienTai->nut, ten, [ham, thamSo] { ham(thamSo); });
+  if (ra) *ra = t;
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  std::unique_lock<std::mutex> lk(khoa);
+  Tcb* t = task ? task : hienTai;
+  t->trangThai = KET_THUC;
+  boKhoiSanSang(t);
+  if (t == hienTai) traoLuot(lk);
+}
+
+void vTaskDelay(TickType_t cho) { nguUs((uint64_t)cho * 1000); }
+
+void vTaskDelayUntil(TickType_t* lanTruoc, TickType_t chuKy) {
+  *lanTruoc += chuKy;
+  const Nut* n = nutHienTai();
+  uint64_t luc = (n ? n->batNguonLuc : 0) + (uint64_t)*lanTruoc * 1000;
+  if (luc > bayGio) cho(nullptr, luc);
+}
+
+TickType_t xTaskGetTickCount() { return millisCua(nutHienTai()); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return hienTai; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lk(khoa);
+  task->thongBao++;
+  danhThucKhoa(task);
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xoa, TickType_t cho) {
+  Tcb* t = hienTai;
+  uint64_t han = hanCua(cho);
+  for (;;) {
+    if (t->thongBao) {
+      uint32_t v = t->thongBao;
+      t->thongBao = xoa ? 0 : v - 1;
+      return v;
+    }
+    if (cho == 0 || bayGio >= han) return 0;
+    mophong::cho(t, han);
+  }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t soPhanTu, UBaseType_t kichThuoc) {
+  QueueHandle_t q = new QueueDefinition;
+  q->kichThuoc = kichThuoc;
+  q->toiDa = soPhanTu;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* phanTu, TickType_t cho) {
+  uint64_t han = hanCua(cho);
+  for (;;) {
+    if (q->ds.size() < q->toiDa) {
+      const uint8_t* p = static_cast<const uint8_t*>(phanTu);
+      q->ds.push_back(std::vector<uint8_t>(p, p + q->kichThuoc));
+      danhThuc(q);
+      return pdTRUE;
+    }
+    if (cho == 0 || bayGio >= han) return pdFALSE;
+    mophong::cho(q, han);
+  }
+}
+
+static BaseType_t docHangDoi(QueueHandle_t q, void* ra, TickType_t cho, bool lay) {
+  uint64_t han = hanCua(cho);
+  for (;;) {
+    if (!q->ds.empty()) {
+      if (q->kichThuoc) memcpy(ra, q->ds.front().data(), q->kichThuoc);
+      if (lay) {
+        q->ds.pop_front();
+        danhThuc(q);
+      }
+      return pdTRUE;
+    }
+    if (cho == 0 || bayGio >= han) return pdFALSE;
+    mophong::cho(q, han);
+  }
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* ra, TickType_t cho) { return docHangDoi(q, ra, cho, true); }
+
+BaseType_t xQueuePeek(QueueHandle_t q, void* ra, TickType_t cho) { return docHangDoi(q, ra, cho, false); }
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  q->ds.clear();
+  danhThuc(q);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return q->ds.size(); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t toiDa, UBaseType_t banDau) {
+  QueueHandle_t q = xQueueCreate(toiDa, 0);
+  for (UBaseType_t i = 0; i < banDau; i++) q->ds.push_back(std::vector<uint8_t>());
+  return q;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t cho) { return xQueueReceive(s, nullptr, cho); }
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return xQueueSend(s, nullptr, 0); }
+
+TimerHandle_t xTimerCreate(const char*, TickType_t chuKy, UBaseType_t lapLai, void* id, TimerCallbackFunction_t cb) {
+  TimerHandle_t t = new tmrTimerControl;
+  t->chuKy = chuKy;
+  t->lapLai = lapLai;
+  t->id = id;
+  t->cb = cb;
+  t->nut = nutHienTai();
+  return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t) {
+  t->lanBat++;
+  t->dangChay = true;
+  henTimer(t);
+  return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t) {
+  t->lanBat++;
+  t->dangChay = false;
+  return pdPASS;
+}
+
+void* pvTimerGetTimerID(TimerHandle_t t) { return t->id; }
+
+// Arduino
+
+unsigned long millis() { return millisCua(nutHienTai()); }
+
+unsigned long micros() {
+  const Nut* n = nutHienTai();
+  return bayGio - (n ? n->batNguonLuc : 0);
+}
+
+void delay(uint32_t ms) { vTaskDelay(ms); }
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t chan, uint8_t giaTri) { nutHienTai()->tb.chan[chan] = giaTri; }
+
+int digitalRead(uint8_t chan) { return nutHienTai()->tb.chan[chan]; }
+
+// xorshift32: dãy ngẫu nhiên giống nhau giữa các lần chạy
+uint32_t esp_random() {
+  hatNgauNhien ^= hatNgauNhien << 13;
+  hatNgauNhien ^= hatNgauNhien >> 17;
+  hatNgauNhien ^= hatNgauNhien << 5;
+  return hatNgauNhien;
+}
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) {
+  Nut* n = nutHienTai();
+  if (!n) {
+    fputc(c, stdout);
+    return 1;
+  }
+  if (c == '\n') ketThucDong(n);
+  else if (c != '\r') n->dongDo += (char)c;
+  return 1;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Mô phỏng nhiều board ESP32 trong một tiến trình Linux để chạy firmware thật (Code_ESP32) với
+// phần cứng giả: đầu cân UART, đầu đọc thẻ MFRC522, TFT, ESP-NOW, WiFi/AP và server HTTP.
+//
+// Mỗi task FreeRTOS là một thread nhưng chỉ một thread chạy tại một thời điểm (truyền lượt), thời gian
+// là đồng hồ ảo chỉ tiến khi mọi task đều đang chờ: kết quả lặp lại y hệt giữa các lần chạy và vài phút
+// thời gian ảo chạy trong chưa tới một giây. Thread gọi khoiDong() trở thành task kịch bản; các hàm dưới
+// đây chỉ gọi từ task đó.
+//
+// Mỗi nút (board) có NVS và flash riêng giữ qua các lần tắt/bật nguồn; biến toàn cục của firmware nằm
+// trong namespace của từng bản firmware (xem các file nut/*.cpp).
+namespace mophong {
+
+struct Nut;
+
+// Một bản firmware đã biên dịch: setup()/loop() trong namespace riêng
+struct Firmware {
+  const char* ten;
+  void (*setup)();
+  void (*loop)();
+};
+
+// Giờ UTC của server (và của nút sau khi đồng bộ SNTP) lúc bắt đầu mô phỏng
+const time_t kGioBatDau = 1792216800;  // 2026-10-17 06:00:00 UTC
+
+void khoiDong();
+// Kết thúc tiến trình ngay (các thread task còn đang chờ lượt, không huỷ đối tượng toàn cục)
+[[noreturn]] void ketThuc(int ma);
+Nut* taoNut(const char* ten);
+const char* tenNut(const Nut* n);
+
+// Cấp điện: chạy setup() rồi loop() trong task "loopTask" như Arduino-ESP32
+void batNguon(Nut* n, const Firmware& fw);
+// Mất điện: mọi task của nút dừng ngay, NVS và tệp trên flash giữ nguyên
+void tatNguon(Nut* n);
+bool dangChay(const Nut* n);
+
+// Task kịch bản chờ tới thời điểm ảo (ms từ lúc bắt đầu); các nút chạy trong lúc chờ
+void choDen(uint64_t ms);
+uint64_t bayGioMs();
+// Giờ UTC của server theo đồng hồ ảo
+time_t gioThuc();
+// time() của nút đang chạy: giờ UTC sau khi có WiFi và đã configTime() (SNTP), trước đó là số giây
+// từ lúc bật nguồn như ESP32 chưa đồng bộ giờ
+time_t gioNut();
+
+// Dung lượng flash cho tệp của nút (LittleFS), mặc định 1 MB
+void datDungLuongFlash(Nut* n, size_t byte);
+
+// Radio của nút: tắt thì không gửi/nhận được khung ESP-NOW nào (ra khỏi vùng sóng)
+void datSong(Nut* n, bool coSong);
+
+// AP WiFi duy nhất của mô phỏng (SSID "DoAnTotNghiep", kênh 6). Tắt hay đổi kênh thì các nút đang
+// kết nối mất kết nối ngay, sự kiện mất kết nối tới sau ~1 s như mất beacon.
+void datAp(bool bat);
+void doiKenhAp(uint8_t kenh);
+
+// Đặt thẻ (UID hex, tạo thẻ trắng nếu chưa có) lên đầu đọc của nút, nhấc ra sau giuMs
+void datThe(Nut* n, const std::string& uidHex, uint32_t giuMs);
+// Ghi sẵn một block của thẻ (vd. tên ở block 2)
+void ghiKhoiThe(const std::string& uidHex, uint8_t block, const uint8_t duLieu[16]);
+
+// Đầu cân gửi một dòng (thêm CR LF) vào UART của nút, bắt đầu sau treMs; các dòng nối đuôi nhau theo
+// tốc độ 9600 baud
+void guiUart(Nut* n, const std::string& dong, uint32_t treMs = 0);
+
+// Server HTTP(S) mà HTTPClient của mọi nút gọi tới. ma <= 0 là lỗi kết nối (HTTPC_ERROR_*).
+typedef std::function<int(const std::string& phuongThuc, const std::string& url, const std::string& than,
+                          std::string& traVe)>
+  MayChuHttp;
+void datMayChuHttp(MayChuHttp mayChu);
+
+// GET tới WebServer của nút (vd. "/metrics"), chờ tối đa 2 s; rỗng nếu không có trả lời
+std::string layTrang(Nut* n, const std::string& duongDan);
+// Chữ đang hiện trên TFT của nút, mỗi dòng màn hình một dòng
+std::string manHinh(const Nut* n);
+// Các dòng Serial nút đã in (kể cả các lần bật nguồn trước)
+const std::vector<std::string>& nhatKy(const Nut* n);
+
+}  // namespace mophong
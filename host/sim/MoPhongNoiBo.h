@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MoPhong.h"
+#include "Arduino.h"
+#include "WiFi.h"
+#include "esp_now.h"
+
+class Adafruit_ST7735;
+class WebServer;
+
+// Phần dùng chung giữa bộ lập lịch (MoPhong.cpp) và phần cứng giả (ThietBiGia.cpp), không dùng
+// trong kịch bản. Mọi hàm ở đây chỉ gọi từ task đang giữ lượt chạy.
+namespace mophong {
+
+const uint64_t kKhongHan = UINT64_MAX;
+
+// Thẻ MIFARE Classic 1K: 64 block 16 byte
+struct TheMifare {
+  uint8_t doDaiUid;
+  uint8_t uid[10];
+  uint8_t khoi[64][16];
+};
+
+enum TrangThaiThe { THE_CHO, THE_DANG_DOC, THE_NGU };
+
+// Trạng thái phần cứng mất khi tắt nguồn, đặt lại mỗi lần batNguon()
+struct ThietBi {
+  // ESP-NOW
+  uint8_t kenh = 1;
+  bool espNow = false;
+  esp_now_recv_cb_t nhanCb = nullptr;
+  esp_now_send_cb_t guiCb = nullptr;
+  std::vector<std::array<uint8_t, 6>> peer;
+
+  // WiFi STA
+  int cheDo = 0;
+  bool wifiKetNoi = false;
+  uint32_t lanThu = 0;     // tăng mỗi lần begin()/disconnect(): lần thử cũ đang chờ bị huỷ
+  bool tuNoiLai = true;    // setAutoReconnect(): thư viện tự begin() lại khi mất AP như Arduino-ESP32
+  std::string ssid, pass;  // của lần begin() cuối, dùng khi tự kết nối lại
+  uint32_t phienWifi = 0;  // khác nhau giữa mọi lần kết nối (của mọi nút), WiFiClient so để biết mất kết nối
+  std::vector<std::pair<WiFiEventFuncCb, arduino_event_id_t>> suKienWifi;
+  uint32_t ipTinh[4] = {};  // ip, gateway, mask, dns; ip = 0 là DHCP
+  uint32_t ip = 0;
+  uint8_t bssid[6] = {};
+  bool ntp = false;
+  bool dongBoGio = false;
+  int soKetQuaQuet = 0;
+  uint8_t kenhQuet = 0;
+
+  // UART đầu cân
+  QueueHandle_t uartSuKien = NULL;
+  std::deque<uint8_t> uartRing;
+  size_t uartRingMax = 0;
+
+  // MFRC522: sector đã xác thực, -1 nếu chưa
+  int sectorXacThuc = -1;
+
+  std::map<uint8_t, uint8_t> chan;  // GPIO
+  Adafruit_ST7735* tft = nullptr;
+  WebServer* web = nullptr;
+  std::deque<std::string> yeuCauWeb;
+  bool coPhanHoiWeb = false;
+  std::string phanHoiWeb;
+};
+
+struct Nut {
+  std::string ten;
+  int chiSo = 0;
+  uint8_t mac[6] = {};
+  bool dangChay = false;
+  uint32_t theHe = 0;        // tăng mỗi lần bật/tắt nguồn: sự kiện hẹn cho lần chạy cũ bị bỏ
+  uint64_t batNguonLuc = 0;  // us
+
+  std::string dongDo;  // dòng Serial đang in dở
+  std::vector<std::string> nhatKy;
+
+  // Giữ qua tắt nguồn như flash thật
+  std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> tep;
+  size_t dungLuongFlash = 1024 * 1024;
+
+  bool coSong = true;
+  uint64_t uartRanhLuc = 0;  // us, lúc byte cuối đang gửi tới UART xong
+
+  // Thẻ đang đặt trên đầu đọc (vật lý, không phụ thuộc nguồn)
+  TheMifare* the = nullptr;
+  TrangThaiThe trangThaiThe = THE_CHO;
+  uint32_t lanDatThe = 0;
+
+  ThietBi tb;
+};
+
+extern std::vector<Nut*> tatCaNut;
+
+// Nút của task đang chạy (task sự kiện: nút của sự kiện đang xử lý), nullptr với task kịch bản
+Nut* nutHienTai();
+uint64_t bayGioUs();
+unsigned long millisCua(const Nut* n);
+// Thời điểm hết hạn (us) của một lần chờ cho tick
+uint64_t hanCua(TickType_t cho);
+
+// Chờ tới khi danhThuc(doiTuong) hoặc tới hanUs; false nếu hết hạn
+bool cho(const void* doiTuong, uint64_t hanUs);
+void danhThuc(const void* doiTuong);
+void nguUs(uint64_t us);
+
+// Hẹn f chạy trong task sự kiện lúc lucUs với nút n (bỏ nếu n đã tắt/bật lại nguồn từ lúc hẹn;
+// n = nullptr: không gắn với nút nào)
+void hen(Nut* n, uint64_t lucUs, std::function<void()> f);
+
+// Phần cứng giả (ThietBiGia.cpp)
+void suKienWifi(Nut* n, arduino_event_id_t suKien, uint8_t lyDo);
+int goiMayChuHttp(const std::string& phuongThuc, const std::string& url, const std::string& than, std::string& traVe);
+
+}  // namespace mophong
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "WString.h"
+
+// NVS của nút mô phỏng: namespace -> khoá -> giá trị (byte thô), giữ qua các lần tắt/bật nguồn.
+// Đọc sai kiểu (độ dài khác) thì trả giá trị mặc định như NVS thật.
+class Preferences {
+public:
+  bool begin(const char* ten, bool chiDoc = false, const char* phanVung = nullptr);
+  void end() { moi_ = false; }
+  bool clear();
+  bool remove(const char* khoa);
+  bool isKey(const char* khoa);
+
+  size_t putBytes(const char* khoa, const void* giaTri, size_t n);
+  size_t getBytes(const char* khoa, void* ra, size_t n);
+  size_t getBytesLength(const char* khoa);
+  size_t putUChar(const char* khoa, uint8_t v) { return putBytes(khoa, &v, sizeof(v)); }
+  uint8_t getUChar(const char* khoa, uint8_t macDinh = 0) { return docKieu(khoa, macDinh); }
+  size_t putUShort(const char* khoa, uint16_t v) { return putBytes(khoa, &v, sizeof(v)); }
+  uint16_t getUShort(const char* khoa, uint16_t macDinh = 0) { return docKieu(khoa, macDinh); }
+  size_t putUInt(const char* khoa, uint32_t v) { return putBytes(khoa, &v, sizeof(v)); }
+  uint32_t getUInt(const char* khoa, uint32_t macDinh = 0) { return docKieu(khoa, macDinh); }
+  size_t putBool(const char* khoa, bool v) { return putUChar(khoa, v); }
+  bool getBool(const char* khoa, bool macDinh = false) { return getUChar(khoa, macDinh); }
+
+private:
+  template <typename T>
+  T docKieu(const char* khoa, T macDinh) {
+    T v;
+    return getBytesLength(khoa) == sizeof(T) && getBytes(khoa, &v, sizeof(T)) == sizeof(T) ? v : macDinh;
+  }
+
+  std::string ten_;
+  bool chiDoc_ = false;
+  bool moi_ = false;
+};
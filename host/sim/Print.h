@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* p, size_t n) {
+    size_t da = 0;
+    while (n--) da += write(*p++);
+    return da;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int coSo = DEC) { return print((unsigned long)v, coSo); }
+  size_t print(int v, int coSo = DEC) { return print((long)v, coSo); }
+  size_t print(unsigned v, int coSo = DEC) { return print((unsigned long)v, coSo); }
+  size_t print(long v, int coSo = DEC) {
+    if (coSo != DEC) return print((unsigned long)v, coSo);
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", v);
+    return write(buf);
+  }
+  size_t print(unsigned long v, int coSo = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), coSo == HEX ? "%lX" : "%lu", v);
+    return write(buf);
+  }
+  size_t print(double v, int chuSo = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", chuSo, v);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& v, int kieu) {
+    size_t n = print(v, kieu);
+    return n + println();
+  }
+
+  __attribute__((format(printf, 2, 3))) size_t printf(const char* dinhDang, ...) {
+    char buf[512];
+    va_list ds;
+    va_start(ds, dinhDang);
+    int n = vsnprintf(buf, sizeof(buf), dinhDang, ds);
+    va_end(ds);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
@@ -0,0 +1,829 @@
+#include "MoPhongNoiBo.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "Adafruit_ST7735.h"
+#include "FS.h"
+#include "HTTPClient.h"
+#include "LittleFS.h"
+#include "MFRC522.h"
+#include "Preferences.h"
+#include "SPI.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "driver/uart.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+using namespace mophong;
+
+// Phần cứng giả của các nút: mọi hàm ở đây chạy trong task đang giữ lượt (của firmware hoặc task sự
+// kiện), nutHienTai() là board đang gọi.
+namespace {
+
+// AP WiFi duy nhất
+struct Ap {
+  std::string ssid = "DoAnTotNghiep";
+  std::string pass = "12345678";
+  uint8_t kenh = 6;
+  uint8_t bssid[6] = { 0x9C, 0x53, 0x22, 0x41, 0x7A, 0x01 };
+  bool bat = true;
+} ap;
+
+// Thời gian kết nối WiFi (us): biết kênh + BSSID thì chỉ nghe một kênh, không thì quét cả 13 kênh
+const uint64_t kNoiNhanh = 400000;
+const uint64_t kNoiDayDu = 2500000;
+const uint64_t kKhongThayNhanh = 1500000;
+const uint64_t kKhongThayDayDu = 3000000;
+const uint64_t kMatBeacon = 1000000;
+const uint64_t kQuet = 2000000;
+// HTTPS: bắt tay TLS khi mở kết nối, mỗi chiều của một request
+const uint64_t kBatTayTls = 300000;
+const uint64_t kMotChieuHttp = 30000;
+const uint64_t kChoDocHttp = 5000000;
+const unsigned long kNghiToiDaMs = 60000;
+// 9600 baud, 10 bit mỗi byte
+const uint64_t kMotByteUart = 1042;
+// TFT trên SPI 27 MHz (ns): mỗi lệnh vẽ đặt cửa sổ địa chỉ rồi gửi 16 bit mỗi điểm ảnh; Adafruit_GFX
+// vẽ chữ từng điểm một (ô 5x8, mỗi điểm một fillRect cỡ chữ x cỡ chữ)
+const uint64_t kNsMotLenhVe = 8000;
+const uint64_t kNsMotDiemAnh = 600;
+
+uint32_t demPhienWifi = 0;
+MayChuHttp mayChu;
+std::map<std::string, TheMifare> bangThe;  // UID hex -> thẻ
+
+Nut* nut() { return nutHienTai(); }
+
+bool cungMac(const uint8_t* a, const uint8_t* b) { return memcmp(a, b, 6) == 0; }
+
+bool laQuangBa(const uint8_t* mac) {
+  static const uint8_t kQuangBa[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  return cungMac(mac, kQuangBa);
+}
+
+// Thẻ theo UID hex (4, 7 hoặc 10 byte), tạo thẻ trắng với khoá mặc định FF..FF nếu chưa có
+TheMifare& layThe(const std::string& uidHex) {
+  auto it = bangThe.find(uidHex);
+  if (it != bangThe.end()) return it->second;
+  TheMifare& t = bangThe[uidHex];
+  memset(&t, 0, sizeof(t));
+  t.doDaiUid = std::min<size_t>(uidHex.size() / 2, sizeof(t.uid));
+  for (uint8_t i = 0; i < t.doDaiUid; i++) t.uid[i] = strtoul(uidHex.substr(2 * i, 2).c_str(), nullptr, 16);
+  memcpy(t.khoi[0], t.uid, t.doDaiUid);
+  static const uint8_t kTrailer[16] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07,
+                                        0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  for (int b = 3; b < 64; b += 4) memcpy(t.khoi[b], kTrailer, 16);
+  return t;
+}
+
+size_t daDungFlash(const Nut* n) {
+  size_t tong = 0;
+  for (const auto& t : n->tep) tong += t.second->size();
+  return tong;
+}
+
+// Nút đang kết nối AP mất kết nối ngay (AP tắt/đổi kênh), firmware biết khi hết beacon
+void matAp() {
+  uint64_t luc = bayGioUs() + kMatBeacon;
+  for (Nut* n : tatCaNut) {
+    if (!n->dangChay || !n->tb.wifiKetNoi) continue;
+    n->tb.wifiKetNoi = false;
+    n->tb.lanThu++;
+    hen(n, luc, [n] { suKienWifi(n, ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_BEACON_TIMEOUT); });
+  }
+}
+
+bool theDangDoc(const Nut* n) { return n->the && n->trangThaiThe == THE_DANG_DOC; }
+
+// Một lần thử kết nối AP với ssid/pass đã lưu; kết quả (GOT_IP hoặc DISCONNECTED) tới sau thời gian
+// kết nối. kenh > 0 và bssid: đường nhanh, chỉ nghe một kênh.
+void noiWifi(Nut* n, int32_t kenh, const uint8_t* bssid) {
+  ThietBi& tb = n->tb;
+  uint32_t lan = tb.lanThu;
+  std::string s = tb.ssid, p = tb.pass;
+  bool nhanh = kenh > 0 && bssid;
+  std::array<uint8_t, 6> b = {};
+  if (bssid) memcpy(b.data(), bssid, 6);
+  // Tìm thấy AP không: quét đủ thì chỉ cần đúng SSID, nhanh thì phải đúng kênh và BSSID đã nhớ
+  auto thayAp = [s, nhanh, kenh, b] {
+    return ap.bat && s == ap.ssid && (!nhanh || (kenh == ap.kenh && cungMac(b.data(), ap.bssid)));
+  };
+  bool seDuoc = thayAp() && p == ap.pass;
+  uint64_t tre = seDuoc ? (nhanh ? kNoiNhanh : kNoiDayDu) : (nhanh ? kKhongThayNhanh : kKhongThayDayDu);
+  hen(n, bayGioUs() + tre, [n, lan, p, thayAp] {
+    ThietBi& tb = n->tb;
+    if (tb.lanThu != lan) return;
+    bool thay = thayAp();
+    if (!thay || p != ap.pass) {
+      suKienWifi(n, ARDUINO_EVENT_WIFI_STA_DISCONNECTED, thay ? WIFI_REASON_AUTH_FAIL : WIFI_REASON_NO_AP_FOUND);
+      return;
+    }
+    tb.wifiKetNoi = true;
+    tb.kenh = ap.kenh;
+    tb.phienWifi = ++demPhienWifi;
+    memcpy(tb.bssid, ap.bssid, 6);
+    tb.ip = tb.ipTinh[0] ? tb.ipTinh[0] : (uint32_t)IPAddress(192, 168, 1, 100 + n->chiSo);
+    if (tb.ntp) tb.dongBoGio = true;
+    suKienWifi(n, ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+  });
+}
+
+}  // namespace
+
+namespace mophong {
+
+time_t gioNut() {
+  Nut* n = nut();
+  if (n && n->tb.dongBoGio) return gioThuc();
+  return millisCua(n) / 1000;
+}
+
+void suKienWifi(Nut* n, arduino_event_id_t suKien, uint8_t lyDo) {
+  arduino_event_info_t thongTin;
+  memset(&thongTin, 0, sizeof(thongTin));
+  if (suKien == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    thongTin.wifi_sta_disconnected.reason = lyDo;
+    memcpy(thongTin.wifi_sta_disconnected.ssid, ap.ssid.c_str(), ap.ssid.size());
+    thongTin.wifi_sta_disconnected.ssid_len = ap.ssid.size();
+  }
+  // Chép danh sách: callback có thể đăng ký thêm
+  std::vector<std::pair<WiFiEventFuncCb, arduino_event_id_t>> ds = n->tb.suKienWifi;
+  for (const auto& cb : ds)
+    if (cb.second == suKien || cb.second == ARDUINO_EVENT_MAX) cb.first(suKien, thongTin);
+  // Thư viện Arduino-ESP32: mất beacon hay không thấy AP thì tự begin() lại (quét đủ) nếu setAutoReconnect
+  ThietBi& tb = n->tb;
+  bool thuLai = lyDo >= WIFI_REASON_BEACON_TIMEOUT && lyDo != WIFI_REASON_AUTH_FAIL;
+  if (suKien == ARDUINO_EVENT_WIFI_STA_DISCONNECTED && tb.tuNoiLai && thuLai && !tb.wifiKetNoi && !tb.ssid.empty()) {
+    tb.lanThu++;
+    noiWifi(n, 0, nullptr);
+  }
+}
+
+int goiMayChuHttp(const std::string& phuongThuc, const std::string& url, const std::string& than, std::string& traVe) {
+  if (!mayChu) return HTTPC_ERROR_CONNECTION_REFUSED;
+  return mayChu(phuongThuc, url, than, traVe);
+}
+
+void datAp(bool bat) {
+  if (!bat && ap.bat) matAp();
+  ap.bat = bat;
+}
+
+void doiKenhAp(uint8_t kenh) {
+  if (kenh == ap.kenh) return;
+  ap.kenh = kenh;
+  matAp();
+}
+
+void datThe(Nut* n, const std::string& uidHex, uint32_t giuMs) {
+  n->the = &layThe(uidHex);
+  n->trangThaiThe = THE_CHO;
+  uint32_t lan = ++n->lanDatThe;
+  hen(nullptr, bayGioUs() + (uint64_t)giuMs * 1000, [n, lan] {
+    if (n->lanDatThe == lan) n->the = nullptr;
+  });
+}
+
+void ghiKhoiThe(const std::string& uidHex, uint8_t block, const uint8_t duLieu[16]) {
+  if (block > 0 && block < 64) memcpy(layThe(uidHex).khoi[block], duLieu, 16);
+}
+
+void guiUart(Nut* n, const std::string& dong, uint32_t treMs) {
+  std::string byteGui = dong + "\r\n";
+  uint64_t batDau = std::max(bayGioUs() + (uint64_t)treMs * 1000, n->uartRanhLuc);
+  uint64_t xong = batDau + byteGui.size() * kMotByteUart;
+  n->uartRanhLuc = xong;
+  // Cả dòng tới một lần (ngắt UART_DATA sau khi dòng nghỉ) là đủ cho bộ đọc dòng của firmware
+  hen(n, xong, [n, byteGui] {
+    ThietBi& tb = n->tb;
+    if (!tb.uartSuKien) return;  // driver chưa cài: byte mất như trên chân RX thật
+    size_t vao = 0;
+    for (char c : byteGui) {
+      if (tb.uartRing.size() >= tb.uartRingMax) break;
+      tb.uartRing.push_back(c);
+      vao++;
+    }
+    uart_event_t sk;
+    memset(&sk, 0, sizeof(sk));
+    sk.type = vao < byteGui.size() ? UART_BUFFER_FULL : UART_DATA;
+    sk.size = vao;
+    xQueueSend(tb.uartSuKien, &sk, 0);
+  });
+}
+
+void datMayChuHttp(MayChuHttp may) { mayChu = may; }
+
+std::string layTrang(Nut* n, const std::string& duongDan) {
+  if (!n->dangChay || !n->tb.web) return std::string();
+  n->tb.coPhanHoiWeb = false;
+  n->tb.yeuCauWeb.push_back(duongDan);
+  for (int i = 0; i < 200 && !n->tb.coPhanHoiWeb; i++) nguUs(10000);
+  return n->tb.coPhanHoiWeb ? n->tb.phanHoiWeb : std::string();
+}
+
+std::string manHinh(const Nut* n) { return n->dangChay && n->tb.tft ? n->tb.tft->text() : std::string(); }
+
+}  // namespace mophong
+
+// LittleFS
+
+namespace fs {
+
+size_t File::read(uint8_t* ra, size_t n) {
+  if (!duLieu_ || viTri_ >= duLieu_->size()) return 0;
+  size_t co = std::min(n, duLieu_->size() - viTri_);
+  memcpy(ra, duLieu_->data() + viTri_, co);
+  viTri_ += co;
+  return co;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::write(const uint8_t* p, size_t n) {
+  if (!duLieu_ || !choGhi_) return 0;
+  if (noiTiep_) viTri_ = duLieu_->size();
+  size_t cuoi = viTri_ + n;
+  if (cuoi > duLieu_->size()) {
+    // Flash đầy: không ghi byte nào (LittleFS cấp theo block, ghi dở cũng mất)
+    const Nut* chu = tatCaNut[nut_];
+    if (daDungFlash(chu) + (cuoi - duLieu_->size()) > chu->dungLuongFlash) return 0;
+    duLieu_->resize(cuoi);
+  }
+  memcpy(duLieu_->data() + viTri_, p, n);
+  viTri_ = cuoi;
+  return n;
+}
+
+bool File::seek(uint32_t viTri) {
+  if (!duLieu_ || viTri > duLieu_->size()) return false;
+  viTri_ = viTri;
+  return true;
+}
+
+File FS::open(const String& duongDan, const char* cheDo) {
+  Nut* n = nut();
+  File f;
+  auto it = n->tep.find(duongDan.str());
+  if (cheDo[0] == 'r') {
+    if (it == n->tep.end()) return f;
+  } else {
+    if (it == n->tep.end())
+      it = n->tep.insert(std::make_pair(duongDan.str(), std::make_shared<std::vector<uint8_t>>())).first;
+    else if (cheDo[0] == 'w')
+      it->second->clear();
+    f.choGhi_ = true;
+    f.noiTiep_ = cheDo[0] == 'a';
+  }
+  f.duLieu_ = it->second;
+  f.viTri_ = f.noiTiep_ ? f.duLieu_->size() : 0;
+  f.nut_ = n->chiSo;
+  return f;
+}
+
+bool FS::exists(const String& duongDan) { return nut()->tep.count(duongDan.str()) > 0; }
+
+bool FS::remove(const String& duongDan) { return nut()->tep.erase(duongDan.str()) > 0; }
+
+bool FS::rename(const String& tu, const String& den) {
+  Nut* n = nut();
+  auto it = n->tep.find(tu.str());
+  if (it == n->tep.end()) return false;
+  std::shared_ptr<std::vector<uint8_t>> duLieu = it->second;
+  n->tep.erase(it);
+  n->tep[den.str()] = duLieu;
+  return true;
+}
+
+}  // namespace fs
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) { return true; }
+
+size_t LittleFSFS::totalBytes() { return nutHienTai()->dungLuongFlash; }
+
+size_t LittleFSFS::usedBytes() { return daDungFlash(nutHienTai()); }
+
+LittleFSFS LittleFS;
+
+// NVS
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>>* bangNvs(const std::string& ten, bool tao) {
+  Nut* n = nutHienTai();
+  auto it = n->nvs.find(ten);
+  if (it != n->nvs.end()) return &it->second;
+  return tao ? &n->nvs[ten] : nullptr;
+}
+
+}  // namespace
+
+bool Preferences::begin(const char* ten, bool chiDoc, const char*) {
+  ten_ = ten;
+  chiDoc_ = chiDoc;
+  // Namespace chưa có thì mở chỉ đọc thất bại như NVS thật
+  moi_ = bangNvs(ten_, !chiDoc) != nullptr;
+  return moi_;
+}
+
+bool Preferences::clear() {
+  if (!moi_ || chiDoc_) return false;
+  bangNvs(ten_, true)->clear();
+  return true;
+}
+
+bool Preferences::remove(const char* khoa) {
+  if (!moi_ || chiDoc_) return false;
+  return bangNvs(ten_, true)->erase(khoa) > 0;
+}
+
+bool Preferences::isKey(const char* khoa) {
+  std::map<std::string, std::vector<uint8_t>>* b = moi_ ? bangNvs(ten_, false) : nullptr;
+  return b && b->count(khoa);
+}
+
+size_t Preferences::putBytes(const char* khoa, const void* giaTri, size_t n) {
+  if (!moi_ || chiDoc_ || !khoa) return 0;
+  const uint8_t* p = (const uint8_t*)giaTri;
+  (*bangNvs(ten_, true))[khoa].assign(p, p + n);
+  return n;
+}
+
+size_t Preferences::getBytes(const char* khoa, void* ra, size_t n) {
+  std::map<std::string, std::vector<uint8_t>>* b = moi_ ? bangNvs(ten_, false) : nullptr;
+  if (!b) return 0;
+  auto it = b->find(khoa);
+  if (it == b->end() || it->second.size() > n) return 0;
+  memcpy(ra, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* khoa) {
+  std::map<std::string, std::vector<uint8_t>>* b = moi_ ? bangNvs(ten_, false) : nullptr;
+  if (!b) return 0;
+  auto it = b->find(khoa);
+  return it == b->end() ? 0 : it->second.size();
+}
+
+// ESP-NOW
+
+namespace {
+
+bool coPeer(const Nut* n, const uint8_t* mac) {
+  for (const auto& p : n->tb.peer)
+    if (cungMac(p.data(), mac)) return true;
+  return false;
+}
+
+// Khung từ a tới được b: cả hai trong vùng sóng, b đang chạy ESP-NOW trên cùng kênh
+bool toiDuoc(const Nut* a, const Nut* b) {
+  return a->coSong && b->coSong && b->dangChay && b->tb.espNow && a->tb.kenh == b->tb.kenh;
+}
+
+}  // namespace
+
+esp_err_t esp_now_init() {
+  nutHienTai()->tb.espNow = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit() {
+  ThietBi& tb = nutHienTai()->tb;
+  tb.espNow = false;
+  tb.nhanCb = nullptr;
+  tb.guiCb = nullptr;
+  tb.peer.clear();
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  ThietBi& tb = nutHienTai()->tb;
+  if (!tb.espNow) return ESP_ERR_ESPNOW_NOT_INIT;
+  tb.nhanCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  ThietBi& tb = nutHienTai()->tb;
+  if (!tb.espNow) return ESP_ERR_ESPNOW_NOT_INIT;
+  tb.guiCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+  Nut* n = nutHienTai();
+  if (!n->tb.espNow) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (!peer) return ESP_ERR_ESPNOW_ARG;
+  if (coPeer(n, peer->peer_addr)) return ESP_ERR_ESPNOW_EXIST;
+  if (n->tb.peer.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) return ESP_ERR_ESPNOW_FULL;
+  std::array<uint8_t, 6> mac;
+  memcpy(mac.data(), peer->peer_addr, 6);
+  n->tb.peer.push_back(mac);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* mac) {
+  ThietBi& tb = nutHienTai()->tb;
+  if (!tb.espNow) return ESP_ERR_ESPNOW_NOT_INIT;
+  for (auto it = tb.peer.begin(); it != tb.peer.end(); ++it) {
+    if (!cungMac(it->data(), mac)) continue;
+    tb.peer.erase(it);
+    return ESP_OK;
+  }
+  return ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* mac) { return coPeer(nutHienTai(), mac); }
+
+esp_err_t esp_now_send(const uint8_t* mac, const uint8_t* data, size_t len) {
+  Nut* a = nutHienTai();
+  if (!a->tb.espNow) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (!mac || !data || len == 0 || len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_ESPNOW_ARG;
+  if (!coPeer(a, mac)) return ESP_ERR_ESPNOW_NOT_FOUND;
+
+  std::vector<uint8_t> goi(data, data + len);
+  std::array<uint8_t, 6> nguon, dich;
+  memcpy(nguon.data(), a->mac, 6);
+  memcpy(dich.data(), mac, 6);
+  bool quangBa = laQuangBa(mac);
+  bool coNutNhan = false;
+  for (Nut* b : tatCaNut) {
+    if (b == a || (!quangBa && !cungMac(b->mac, mac)) || !toiDuoc(a, b)) continue;
+    coNutNhan = true;
+    hen(b, bayGioUs() + 1000, [b, nguon, goi] {
+      if (b->tb.espNow && b->tb.nhanCb) b->tb.nhanCb(nguon.data(), goi.data(), goi.size());
+    });
+  }
+  // Unicast không ai ACK: MAC thử lại vài lần rồi mới báo FAIL
+  bool thanhCong = quangBa || coNutNhan;
+  hen(a, bayGioUs() + (thanhCong ? 1000 : 5000), [a, dich, thanhCong] {
+    if (a->tb.guiCb) a->tb.guiCb(dich.data(), thanhCong ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t kenh, wifi_second_chan_t) {
+  ThietBi& tb = nutHienTai()->tb;
+  if (kenh < 1 || kenh > 13) return ESP_ERR_INVALID_ARG;
+  // Đang kết nối AP thì radio phải theo kênh AP
+  if (tb.wifiKetNoi) return ESP_FAIL;
+  tb.kenh = kenh;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* kenh, wifi_second_chan_t* phu) {
+  if (kenh) *kenh = nutHienTai()->tb.kenh;
+  if (phu) *phu = WIFI_SECOND_CHAN_NONE;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t, uint8_t mac[6]) {
+  memcpy(mac, nutHienTai()->mac, 6);
+  return ESP_OK;
+}
+
+// WiFi
+
+bool WiFiClass::mode(wifi_mode_t cheDo) {
+  nutHienTai()->tb.cheDo = cheDo;
+  return true;
+}
+
+wifi_mode_t WiFiClass::getMode() { return (wifi_mode_t)nutHienTai()->tb.cheDo; }
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass, int32_t kenh, const uint8_t* bssid, bool ketNoi) {
+  Nut* n = nutHienTai();
+  ThietBi& tb = n->tb;
+  if (tb.wifiKetNoi) {
+    tb.wifiKetNoi = false;
+    hen(n, bayGioUs() + 1000, [n] { suKienWifi(n, ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE); });
+  }
+  tb.lanThu++;
+  tb.ssid = ssid ? ssid : "";
+  tb.pass = pass ? pass : "";
+  if (ketNoi) noiWifi(n, kenh, bssid);
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool, bool) {
+  Nut* n = nutHienTai();
+  ThietBi& tb = n->tb;
+  tb.lanThu++;
+  if (tb.wifiKetNoi) {
+    tb.wifiKetNoi = false;
+    hen(n, bayGioUs() + 1000, [n] { suKienWifi(n, ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE); });
+  }
+  return true;
+}
+
+bool WiFiClass::config(IPAddress ip, IPAddress gateway, IPAddress mask, IPAddress dns1, IPAddress) {
+  uint32_t* tinh = nutHienTai()->tb.ipTinh;
+  tinh[0] = ip;
+  tinh[1] = gateway;
+  tinh[2] = mask;
+  tinh[3] = dns1;
+  return true;
+}
+
+WiFiEventId_t WiFiClass::onEvent(WiFiEventFuncCb cb, arduino_event_id_t suKien) {
+  ThietBi& tb = nutHienTai()->tb;
+  tb.suKienWifi.push_back(std::make_pair(cb, suKien));
+  return tb.suKienWifi.size() - 1;
+}
+
+bool WiFiClass::setAutoReconnect(bool bat) {
+  nutHienTai()->tb.tuNoiLai = bat;
+  return true;
+}
+
+bool WiFiClass::getAutoReconnect() { return nutHienTai()->tb.tuNoiLai; }
+
+bool WiFiClass::isConnected() { return nutHienTai()->tb.wifiKetNoi; }
+
+wl_status_t WiFiClass::status() { return isConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+
+int16_t WiFiClass::scanNetworks() {
+  nguUs(kQuet);
+  ThietBi& tb = nutHienTai()->tb;
+  tb.soKetQuaQuet = ap.bat ? 1 : 0;
+  tb.kenhQuet = ap.kenh;
+  return tb.soKetQuaQuet;
+}
+
+String WiFiClass::SSID(uint8_t i) { return i < nutHienTai()->tb.soKetQuaQuet ? String(ap.ssid) : String(); }
+
+int32_t WiFiClass::channel(uint8_t i) {
+  ThietBi& tb = nutHienTai()->tb;
+  return i < tb.soKetQuaQuet ? tb.kenhQuet : 0;
+}
+
+String WiFiClass::SSID() { return isConnected() ? String(ap.ssid) : String(); }
+
+int32_t WiFiClass::channel() { return nutHienTai()->tb.kenh; }
+
+uint8_t* WiFiClass::BSSID() { return nutHienTai()->tb.bssid; }
+
+IPAddress WiFiClass::localIP() { return isConnected() ? IPAddress(nutHienTai()->tb.ip) : IPAddress(); }
+
+IPAddress WiFiClass::gatewayIP() {
+  if (!isConnected()) return IPAddress();
+  uint32_t tinh = nutHienTai()->tb.ipTinh[1];
+  return tinh ? IPAddress(tinh) : IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() { return isConnected() ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+
+IPAddress WiFiClass::dnsIP(uint8_t) { return gatewayIP(); }
+
+String WiFiClass::macAddress() {
+  const uint8_t* m = nutHienTai()->mac;
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+  return String(buf);
+}
+
+WiFiClass WiFi;
+
+void configTime(long, int, const char*, const char*, const char*) {
+  ThietBi& tb = nutHienTai()->tb;
+  tb.ntp = true;
+  if (tb.wifiKetNoi) tb.dongBoGio = true;
+}
+
+// HTTP
+
+bool WiFiClient::connected() {
+  if (!mo_ || nut_ < 0) return false;
+  const Nut* n = tatCaNut[nut_];
+  if (!n->dangChay || !n->tb.wifiKetNoi || n->tb.phienWifi != phienWifi_) return false;
+  return millisCua(n) - dungLuc_ < kNghiToiDaMs;
+}
+
+int HTTPClient::guiYeuCau(const char* phuongThuc, const String& than) {
+  Nut* n = nutHienTai();
+  traVe_ = String();
+  if (!client_) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!n->tb.wifiKetNoi) {
+    client_->stop();
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  if (!client_->connected()) {
+    client_->stop();
+    nguUs(kBatTayTls);
+    if (!n->tb.wifiKetNoi) return HTTPC_ERROR_CONNECTION_REFUSED;
+    client_->moKetNoi(n->chiSo, n->tb.phienWifi, millis());
+  }
+  nguUs(kMotChieuHttp);
+  if (!client_->connected()) {
+    client_->stop();
+    return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+  }
+  std::string ra;
+  int ma = goiMayChuHttp(phuongThuc, url_, than.str(), ra);
+  if (ma == HTTPC_ERROR_READ_TIMEOUT) nguUs(kChoDocHttp);
+  nguUs(kMotChieuHttp);
+  // Server đã xử lý nhưng phản hồi không về tới nút
+  if (!client_->connected()) {
+    client_->stop();
+    return HTTPC_ERROR_CONNECTION_LOST;
+  }
+  if (ma <= 0) {
+    client_->stop();
+    return ma;
+  }
+  client_->daDung(millis());
+  traVe_ = String(ra);
+  return ma;
+}
+
+// Web server
+
+void WebServer::begin() { nutHienTai()->tb.web = this; }
+
+void WebServer::handleClient() {
+  ThietBi& tb = nutHienTai()->tb;
+  if (tb.web != this || tb.yeuCauWeb.empty()) return;
+  std::string duongDan = tb.yeuCauWeb.front();
+  tb.yeuCauWeb.pop_front();
+  auto it = xuLy_.find(duongDan);
+  if (it == xuLy_.end())
+    send(404, "text/plain", "Not found");
+  else
+    it->second();
+}
+
+void WebServer::send(int ma, const char*, const String& noiDung) {
+  ThietBi& tb = nutHienTai()->tb;
+  tb.phanHoiWeb = ma == 200 ? noiDung.str() : std::string();
+  tb.coPhanHoiWeb = true;
+}
+
+SPIClass SPI;
+
+// MFRC522
+
+bool MFRC522::PICC_IsNewCardPresent() {
+  const Nut* n = nutHienTai();
+  return n->the && n->trangThaiThe == THE_CHO;
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+  Nut* n = nutHienTai();
+  if (!n->the || n->trangThaiThe != THE_CHO) return false;
+  uid.size = n->the->doDaiUid;
+  memcpy(uid.uidByte, n->the->uid, sizeof(uid.uidByte));
+  uid.sak = 0x08;
+  n->trangThaiThe = THE_DANG_DOC;
+  n->tb.sectorXacThuc = -1;
+  return true;
+}
+
+MFRC522::StatusCode MFRC522::PICC_HaltA() {
+  Nut* n = nutHienTai();
+  if (theDangDoc(n)) n->trangThaiThe = THE_NGU;
+  n->tb.sectorXacThuc = -1;
+  return STATUS_OK;
+}
+
+void MFRC522::PCD_StopCrypto1() { nutHienTai()->tb.sectorXacThuc = -1; }
+
+MFRC522::StatusCode MFRC522::PCD_Authenticate(byte, byte block, MIFARE_Key* khoa, Uid*) {
+  Nut* n = nutHienTai();
+  n->tb.sectorXacThuc = -1;
+  if (!theDangDoc(n)) return STATUS_TIMEOUT;
+  if (block >= 64 || !khoa) return STATUS_INVALID;
+  // Thẻ trắng: khoá A/B đều FF..FF
+  for (int i = 0; i < 6; i++)
+    if (khoa->keyByte[i] != 0xFF) return STATUS_TIMEOUT;
+  n->tb.sectorXacThuc = block / 4;
+  return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Read(byte block, byte* ra, byte* doDai) {
+  Nut* n = nutHienTai();
+  if (!theDangDoc(n)) return STATUS_TIMEOUT;
+  if (!ra || !doDai || *doDai < 18) return STATUS_NO_ROOM;
+  if (block >= 64 || block / 4 != n->tb.sectorXacThuc) return STATUS_ERROR;
+  memcpy(ra, n->the->khoi[block], 16);
+  ra[16] = ra[17] = 0;  // CRC_A, firmware không kiểm
+  *doDai = 18;
+  return STATUS_OK;
+}
+
+MFRC522::StatusCode MFRC522::MIFARE_Write(byte block, byte* duLieu, byte doDai) {
+  Nut* n = nutHienTai();
+  if (!theDangDoc(n)) return STATUS_TIMEOUT;
+  if (!duLieu || doDai < 16) return STATUS_INVALID;
+  if (block >= 64 || block / 4 != n->tb.sectorXacThuc) return STATUS_ERROR;
+  if (block == 0) return STATUS_MIFARE_NACK;  // block nhà sản xuất chỉ đọc
+  memcpy(n->the->khoi[block], duLieu, 16);
+  return STATUS_OK;
+}
+
+const char* MFRC522::GetStatusCodeName(StatusCode ma) {
+  switch (ma) {
+    case STATUS_OK: return "Success.";
+    case STATUS_ERROR: return "Error in communication.";
+    case STATUS_COLLISION: return "Collision detected.";
+    case STATUS_TIMEOUT: return "Timeout in communication.";
+    case STATUS_NO_ROOM: return "A buffer is not big enough.";
+    case STATUS_INTERNAL_ERROR: return "Internal error in the code. Should not happen.";
+    case STATUS_INVALID: return "Invalid argument.";
+    case STATUS_CRC_WRONG: return "The CRC_A does not match.";
+    case STATUS_MIFARE_NACK: return "A MIFARE PICC responded with NAK.";
+    default: return "Unknown error";
+  }
+}
+
+// TFT
+
+void Adafruit_ST7735::initR(uint8_t) {
+  nutHienTai()->tb.tft = this;
+  chu_.clear();
+}
+
+void Adafruit_ST7735::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t) {
+  if (w > 0 && h > 0) nguUs((kNsMotLenhVe + (uint64_t)w * h * kNsMotDiemAnh) / 1000);
+  for (auto it = chu_.begin(); it != chu_.end();) {
+    int16_t cy = it->first.first, cx = it->first.second;
+    if (cy >= y && cy < y + h && cx >= x && cx < x + w)
+      it = chu_.erase(it);
+    else
+      ++it;
+  }
+}
+
+void Adafruit_ST7735::drawRect(int16_t, int16_t, int16_t w, int16_t h, uint16_t) {
+  // Bốn đường thẳng, không xoá chữ bên trong
+  if (w > 0 && h > 0) nguUs((4 * kNsMotLenhVe + 2 * (uint64_t)(w + h) * kNsMotDiemAnh) / 1000);
+}
+
+size_t Adafruit_ST7735::write(uint8_t c) {
+  if (c == '\n') {
+    x_ = 0;
+    y_ += 8 * coChu_;
+    return 1;
+  }
+  if (c == '\r') return 1;
+  nguUs(5 * 8 * (kNsMotLenhVe + (uint64_t)coChu_ * coChu_ * kNsMotDiemAnh) / 1000);
+  o_chu o = { (char)c, (uint8_t)(6 * coChu_) };
+  chu_[std::make_pair(y_, x_)] = o;
+  x_ += 6 * coChu_;
+  return 1;
+}
+
+std::string Adafruit_ST7735::text() const {
+  std::string ra;
+  bool coDong = false;
+  int16_t yDong = 0, xCuoi = 0;
+  for (const auto& o : chu_) {
+    int16_t y = o.first.first, x = o.first.second;
+    if (!coDong || y != yDong) {
+      if (coDong) ra += '\n';
+      coDong = true;
+      yDong = y;
+    } else if (x >= xCuoi + o.second.rong / 2) {
+      // Khoảng trống giữa hai trường cùng dòng: một dấu cách mỗi ô chữ
+      ra.append(std::max(1, (x - xCuoi + o.second.rong / 2) / o.second.rong), ' ');
+    }
+    ra += o.second.c;
+    xCuoi = x + o.second.rong;
+  }
+  return ra;
+}
+
+// Driver UART
+
+esp_err_t uart_driver_install(uart_port_t, int ringRx, int, int soSuKien, QueueHandle_t* suKien, int) {
+  ThietBi& tb = nutHienTai()->tb;
+  if (tb.uartSuKien) return ESP_FAIL;
+  tb.uartSuKien = xQueueCreate(soSuKien, sizeof(uart_event_t));
+  tb.uartRingMax = ringRx;
+  tb.uartRing.clear();
+  if (suKien) *suKien = tb.uartSuKien;
+  return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t, const uart_config_t*) { return ESP_OK; }
+
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int) { return ESP_OK; }
+
+int uart_read_bytes(uart_port_t, void* ra, uint32_t n, TickType_t) {
+  ThietBi& tb = nutHienTai()->tb;
+  uint8_t* p = (uint8_t*)ra;
+  uint32_t doc = 0;
+  while (doc < n && !tb.uartRing.empty()) {
+    p[doc++] = tb.uartRing.front();
+    tb.uartRing.pop_front();
+  }
+  return doc;
+}
+
+esp_err_t uart_flush_input(uart_port_t) {
+  nutHienTai()->tb.uartRing.clear();
+  return ESP_OK;
+}
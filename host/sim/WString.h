@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// String của Arduino trên std::string, đủ cho những gì firmware dùng
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(unsigned char v) : s_(std::to_string((unsigned)v)) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned v) : s_(std::to_string(v)) {}
+  explicit String(long v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+  explicit String(float v, unsigned chuSo = 2) { soThuc(v, chuSo); }
+  explicit String(double v, unsigned chuSo = 2) { soThuc(v, chuSo); }
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(unsigned n) {
+    s_.reserve(n);
+    return true;
+  }
+  char operator[](unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+  int indexOf(const char* s) const {
+    size_t i = s_.find(s);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned tu, unsigned den) const { return tu < s_.size() ? String(s_.substr(tu, den - tu)) : String(); }
+  String substring(unsigned tu) const { return tu < s_.size() ? String(s_.substr(tu)) : String(); }
+  long toInt() const { return atol(s_.c_str()); }
+  const std::string& str() const { return s_; }
+
+  String& operator+=(const String& s) { s_ += s.s_; return *this; }
+  String& operator+=(const char* s) { if (s) s_ += s; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(unsigned char v) { s_ += std::to_string((unsigned)v); return *this; }
+  String& operator+=(int v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(unsigned v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(long v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(long long v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(unsigned long long v) { s_ += std::to_string(v); return *this; }
+  String& operator+=(double v) { return *this += String(v); }
+  bool concat(const String& s) { s_ += s.s_; return true; }
+
+  bool operator==(const String& s) const { return s_ == s.s_; }
+  bool operator==(const char* s) const { return s_ == (s ? s : ""); }
+  bool operator!=(const String& s) const { return s_ != s.s_; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+  bool operator<(const String& s) const { return s_ < s.s_; }
+
+private:
+  void soThuc(double v, unsigned chuSo) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)chuSo, v);
+    s_ = buf;
+  }
+
+  std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "Arduino.h"
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS } HTTPMethod;
+
+// Web server của nút mô phỏng: kịch bản gửi GET qua MoPhong.h (layTrang), handleClient() của firmware
+// phục vụ trong task của nó như thật
+class WebServer {
+public:
+  typedef void (*THandlerFunction)();
+
+  explicit WebServer(int cong = 80) { (void)cong; }
+  void on(const String& duongDan, HTTPMethod, THandlerFunction xuLy) { xuLy_[duongDan.str()] = xuLy; }
+  void on(const String& duongDan, THandlerFunction xuLy) { on(duongDan, HTTP_ANY, xuLy); }
+  void begin();
+  void handleClient();
+  void send(int ma, const char* kieu, const String& noiDung);
+
+private:
+  std::map<std::string, THandlerFunction> xuLy_;
+};
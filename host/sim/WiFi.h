@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+// WiFi STA của nút mô phỏng với một AP duy nhất (MoPhong.h: datAp): kết nối xong sau vài trăm ms
+// (biết kênh + BSSID) hoặc vài giây (quét mọi kênh), sự kiện tới qua onEvent() trong task sự kiện.
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef struct {
+  uint8_t ssid[33];
+  uint8_t ssid_len;
+  uint8_t bssid[6];
+  uint8_t reason;
+  int8_t rssi;
+} wifi_event_sta_disconnected_t;
+
+typedef union {
+  wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef void (*WiFiEventFuncCb)(arduino_event_id_t suKien, arduino_event_info_t thongTin);
+typedef int WiFiEventId_t;
+
+// Lý do mất kết nối hay gặp (wifi_err_reason_t)
+#define WIFI_REASON_ASSOC_LEAVE 8
+#define WIFI_REASON_BEACON_TIMEOUT 200
+#define WIFI_REASON_NO_AP_FOUND 201
+#define WIFI_REASON_AUTH_FAIL 202
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t cheDo);
+  wifi_mode_t getMode();
+  wl_status_t begin(const char* ssid, const char* pass = nullptr, int32_t kenh = 0, const uint8_t* bssid = nullptr,
+                    bool ketNoi = true);
+  bool disconnect(bool tatWifi = false, bool xoaAp = false);
+  bool config(IPAddress ip, IPAddress gateway, IPAddress mask, IPAddress dns1 = (uint32_t)0,
+              IPAddress dns2 = (uint32_t)0);
+  bool persistent(bool) { return true; }
+  bool setAutoReconnect(bool bat);
+  bool getAutoReconnect();
+  WiFiEventId_t onEvent(WiFiEventFuncCb cb, arduino_event_id_t suKien = ARDUINO_EVENT_MAX);
+  bool isConnected();
+  wl_status_t status();
+
+  // Quét chặn ~2 s, chỉ thấy AP của mô phỏng (nếu đang bật)
+  int16_t scanNetworks();
+  String SSID(uint8_t i);
+  int32_t channel(uint8_t i);
+  String SSID();
+  int32_t channel();
+  uint8_t* BSSID();
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t i = 0);
+  String macAddress();
+  int8_t RSSI() { return isConnected() ? -60 : 0; }
+};
+
+extern WiFiClass WiFi;
+
+// Kết nối TCP tới server của mô phỏng (HTTPClient dùng). Server đóng kết nối nghỉ quá 60 s và mọi
+// kết nối mất khi WiFi của nút mất.
+class WiFiClient {
+public:
+  virtual ~WiFiClient() {}
+  bool connected();
+  void stop() { mo_ = false; }
+
+  // Dùng nội bộ bởi HTTPClient của mô phỏng
+  void moKetNoi(int nut, uint32_t phienWifi, unsigned long luc) {
+    mo_ = true;
+    nut_ = nut;
+    phienWifi_ = phienWifi;
+    dungLuc_ = luc;
+  }
+  void daDung(unsigned long luc) { dungLuc_ = luc; }
+
+private:
+  bool mo_ = false;
+  int nut_ = -1;
+  uint32_t phienWifi_ = 0;
+  unsigned long dungLuc_ = 0;
+};
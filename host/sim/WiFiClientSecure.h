@@ -0,0 +1,10 @@
+#pragma once
+
+#include "WiFi.h"
+
+// TLS chỉ khác TCP ở thời gian bắt tay (xem HTTPClient.h)
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setInsecure() {}
+  void setCACert(const char*) {}
+};
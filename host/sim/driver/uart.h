@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../Arduino.h"
+
+// Driver UART của nút mô phỏng: kịch bản đẩy dòng đầu cân vào (MoPhong.h: guiUart), byte vào ring buffer
+// của driver theo tốc độ 9600 baud và báo UART_DATA qua hàng đợi sự kiện như ISR thật; ring đầy thì
+// bỏ byte và báo UART_BUFFER_FULL.
+typedef int uart_port_t;
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef enum {
+  UART_DATA,
+  UART_BREAK,
+  UART_BUFFER_FULL,
+  UART_FIFO_OVF,
+  UART_FRAME_ERR,
+  UART_PARITY_ERR,
+  UART_DATA_BREAK,
+  UART_PATTERN_DET,
+  UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+  uart_event_type_t type;
+  size_t size;
+  bool timeout_flag;
+} uart_event_t;
+
+typedef enum { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5 = 2, UART_STOP_BITS_2 = 3 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE = 0 } uart_hw_flowcontrol_t;
+typedef enum { UART_SCLK_APB = 0, UART_SCLK_DEFAULT = 0 } uart_sclk_t;
+
+typedef struct {
+  int baud_rate;
+  uart_word_length_t data_bits;
+  uart_parity_t parity;
+  uart_stop_bits_t stop_bits;
+  uart_hw_flowcontrol_t flow_ctrl;
+  uint8_t rx_flow_ctrl_thresh;
+  uart_sclk_t source_clk;
+} uart_config_t;
+
+esp_err_t uart_driver_install(uart_port_t cong, int ringRx, int ringTx, int soSuKien, QueueHandle_t* suKien, int coNgat);
+esp_err_t uart_param_config(uart_port_t cong, const uart_config_t* cauHinh);
+esp_err_t uart_set_pin(uart_port_t cong, int tx, int rx, int rts, int cts);
+int uart_read_bytes(uart_port_t cong, void* ra, uint32_t n, TickType_t cho);
+esp_err_t uart_flush_input(uart_port_t cong);
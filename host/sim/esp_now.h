@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// ESP-NOW giữa các nút mô phỏng: khung tới nút cùng kênh có radio đang bật sau ~1 ms, callback nhận
+// và callback gửi chạy trong task sự kiện (vai task WiFi). Gửi unicast báo SUCCESS khi nút đích nhận
+// được (ACK lớp MAC), quảng bá luôn SUCCESS.
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_KEY_LEN 16
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_NOW_MAX_TOTAL_PEER_NUM 20
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+
+typedef struct {
+  uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+  uint8_t lmk[ESP_NOW_KEY_LEN];
+  uint8_t channel;
+  int ifidx;
+  bool encrypt;
+  void* priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int len);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t trangThai);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_deinit();
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* mac);
+bool esp_now_is_peer_exist(const uint8_t* mac);
+esp_err_t esp_now_send(const uint8_t* mac, const uint8_t* data, size_t len);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { WIFI_SECOND_CHAN_NONE = 0, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+
+// Kênh radio của nút: ESP-NOW chỉ tới được nút cùng kênh. Đang kết nối AP thì radio theo kênh AP.
+esp_err_t esp_wifi_set_channel(uint8_t kenh, wifi_second_chan_t phu);
+esp_err_t esp_wifi_get_channel(uint8_t* kenh, wifi_second_chan_t* phu);
+esp_err_t esp_wifi_get_mac(wifi_interface_t giaoDien, uint8_t mac[6]);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FreeRTOS của ESP-IDF trên bộ lập lịch mô phỏng (MoPhong.cpp): tick 1 ms theo đồng hồ ảo,
+// mỗi lúc chỉ một task chạy nên thứ tự chạy và kết quả lặp lại y hệt giữa các lần chạy.
+// Chỉ có các hàm firmware dùng; ưu tiên và core bị bỏ qua (task sẵn sàng chạy theo thứ tự tới lượt).
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef struct QueueDefinition* QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef struct tmrTimerControl* TimerHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define tskIDLE_PRIORITY 0
+
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
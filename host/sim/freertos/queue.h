@@ -0,0 +1,12 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t soPhanTu, UBaseType_t kichThuoc);
+void vQueueDelete(QueueHandle_t q);
+BaseType_t xQueueSend(QueueHandle_t q, const void* phanTu, TickType_t cho);
+inline BaseType_t xQueueSendToBack(QueueHandle_t q, const void* phanTu, TickType_t cho) { return xQueueSend(q, phanTu, cho); }
+BaseType_t xQueueReceive(QueueHandle_t q, void* ra, TickType_t cho);
+BaseType_t xQueuePeek(QueueHandle_t q, void* ra, TickType_t cho);
+BaseType_t xQueueReset(QueueHandle_t q);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Semaphore là hàng đợi phần tử 0 byte như FreeRTOS; mutex không có kế thừa ưu tiên (không cần khi
+// chỉ một task chạy mỗi lúc)
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t toiDa, UBaseType_t banDau);
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t cho);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
+inline void vSemaphoreDelete(SemaphoreHandle_t s) { vQueueDelete(s); }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t ham, const char* ten, uint32_t stack, void* thamSo,
+                                   UBaseType_t uuTien, TaskHandle_t* ra, BaseType_t core);
+inline BaseType_t xTaskCreate(TaskFunction_t ham, const char* ten, uint32_t stack, void* thamSo, UBaseType_t uuTien,
+                              TaskHandle_t* ra) {
+  return xTaskCreatePinnedToCore(ham, ten, stack, thamSo, uuTien, ra, 0);
+}
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t cho);
+void vTaskDelayUntil(TickType_t* lanTruoc, TickType_t chuKy);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t xoa, TickType_t cho);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Callback timer chạy trong task sự kiện của mô phỏng (thay cho task timer của FreeRTOS)
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t xTimerCreate(const char* ten, TickType_t chuKy, UBaseType_t lapLai, void* id, TimerCallbackFunction_t cb);
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t cho);
+BaseType_t xTimerStop(TimerHandle_t t, TickType_t cho);
+inline BaseType_t xTimerReset(TimerHandle_t t, TickType_t cho) { return xTimerStart(t, cho); }
+void* pvTimerGetTimerID(TimerHandle_t t);
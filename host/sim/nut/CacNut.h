@@ -0,0 +1,11 @@
+#pragma once
+
+#include "MoPhong.h"
+
+// Các bản firmware biên dịch cho mô phỏng. Biến toàn cục của firmware chỉ khởi tạo một lần khi
+// tiến trình bắt đầu, nên mỗi bản chỉ bật nguồn một lần; gateway có hai bản để thử khởi động lại.
+extern const mophong::Firmware kTramTapChat;
+extern const mophong::Firmware kTramMuNuoc;
+extern const mophong::Firmware kTramTsc;
+extern const mophong::Firmware kGatewayLan1;
+extern const mophong::Firmware kGatewayLan2;
@@ -0,0 +1,28 @@
+#include "TatCaThuVien.h"
+#include "CacNut.h"
+
+// Biên dịch hai lần với SIM_BAN=1 và 2 (CMakeLists.txt): mỗi bản một bộ biến toàn cục
+#if SIM_BAN == 1
+#define SIM_NAMESPACE gateway_lan1
+#else
+#define SIM_NAMESPACE gateway_lan2
+#endif
+
+namespace SIM_NAMESPACE {
+
+// time() của ESP32: giờ SNTP sau khi đồng bộ, trước đó tính từ lúc khởi động
+inline time_t time(time_t* ra) {
+  time_t t = mophong::gioNut();
+  if (ra) *ra = t;
+  return t;
+}
+
+#include "Gateway.cpp"
+
+}  // namespace SIM_NAMESPACE
+
+#if SIM_BAN == 1
+const mophong::Firmware kGatewayLan1 = { "Gateway", gateway_lan1::setup, gateway_lan1::loop };
+#else
+const mophong::Firmware kGatewayLan2 = { "Gateway", gateway_lan2::setup, gateway_lan2::loop };
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+// Include trước, ngoài namespace, mọi header hệ thống và thư viện giả mà firmware dùng: khi firmware
+// được include trong namespace của nút (xem các file nut/*.cpp), các dòng #include của nó không còn
+// tác dụng (#pragma once / include guard) và chỉ code của firmware vào namespace.
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "Adafruit_ST7735.h"
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "FS.h"
+#include "HTTPClient.h"
+#include "LittleFS.h"
+#include "MFRC522.h"
+#include "MoPhong.h"
+#include "Preferences.h"
+#include "SPI.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "WiFiClientSecure.h"
+#include "driver/uart.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
@@ -0,0 +1,8 @@
+#include "TatCaThuVien.h"
+#include "CacNut.h"
+
+namespace tram_mu_nuoc {
+#include "Scale_2.cpp"
+}  // namespace tram_mu_nuoc
+
+const mophong::Firmware kTramMuNuoc = { "Scale_2", tram_mu_nuoc::setup, tram_mu_nuoc::loop };
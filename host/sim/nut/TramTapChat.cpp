@@ -0,0 +1,8 @@
+#include "TatCaThuVien.h"
+#include "CacNut.h"
+
+namespace tram_tap_chat {
+#include "Scale_1.cpp"
+}  // namespace tram_tap_chat
+
+const mophong::Firmware kTramTapChat = { "Scale_1", tram_tap_chat::setup, tram_tap_chat::loop };
@@ -0,0 +1,8 @@
+#include "TatCaThuVien.h"
+#include "CacNut.h"
+
+namespace tram_tsc {
+#include "Scale_3.cpp"
+}  // namespace tram_tsc
+
+const mophong::Firmware kTramTsc = { "Scale_3", tram_tsc::setup, tram_tsc::loop };
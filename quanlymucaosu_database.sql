@@ -98,6 +98,18 @@ CREATE TABLE TriggerLog (
     LogTime DATETIME DEFAULT CURRENT_TIMESTAMP
 );
 
+-- Tạo bảng YeuCauDaXuLy: khoá chống trùng (MAC trạm cân, số thứ tự) của các lần cân đã áp dụng,
+-- ghi cùng transaction với GiaoDich nên gửi lại cùng một lần cân không cộng dồn ThanhToan
+CREATE TABLE YeuCauDaXuLy (
+    MaCan VARCHAR(17) NOT NULL,
+    SoThuTu INT UNSIGNED NOT NULL,
+    LoaiCan TINYINT NOT NULL,
+    IDGiaoDich INT NOT NULL,
+    ThoiGianXuLy DATETIME DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (MaCan, SoThuTu),
+    FOREIGN KEY (IDGiaoDich) REFERENCES GiaoDich(IDGiaoDich) ON DELETE CASCADE
+);
+
 DELIMITER //
 
 -- Trigger để tự động thêm giá mủ cho ngày mới và gán giá mủ cho giao dịch